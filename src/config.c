@@ -12,14 +12,14 @@
  *		on Windows XP, possibly Vista and several UNIX systems.
  *		Use the -DANSI_CFG for use on these systems.
  *
- * Version:	@(#)config.c	1.0.56	2021/03/23
+ * Version:	@(#)config.c	1.0.58	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		David Simunic, <simunic.david@outlook.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -419,6 +419,7 @@ load_machine(config_t *cfg, const char *cat)
     cfg->cpu_type = config_get_int(cat, "cpu", 0);
     cfg->cpu_waitstates = config_get_int(cat, "cpu_waitstates", 0);
     cfg->cpu_use_dynarec = !!config_get_int(cat, "cpu_use_dynarec", 0);
+    cfg->dynarec_cache = config_get_int(cat, "dynarec_cache", 0);
     cfg->enable_ext_fpu = !!config_get_int(cat, "cpu_enable_fpu", 0);
 
     cfg->mem_size = config_get_int(cat, "mem_size", 4096);
@@ -456,6 +457,11 @@ save_machine(const config_t *cfg, const char *cat)
 
     config_set_int(cat, "cpu_use_dynarec", cfg->cpu_use_dynarec);
 
+    if (cfg->dynarec_cache == 0)
+	config_delete_var(cat, "dynarec_cache");
+    else
+	config_set_int(cat, "dynarec_cache", cfg->dynarec_cache);
+
     if (cfg->enable_ext_fpu == 0)
 	config_delete_var(cat, "cpu_enable_fpu");
     else
@@ -639,6 +645,9 @@ load_sound(config_t *cfg, const char *cat)
     cfg->midi_device = midi_device_get_from_internal_name(p);
 
     cfg->mpu401_standalone_enable = !!config_get_int(cat, "mpu401_standalone", 0);
+
+    p = config_get_string(cat, "sound_output", "openal");
+    cfg->sound_sink = sound_sink_get_from_internal_name(p);
 }
 
 
@@ -668,6 +677,12 @@ save_sound(const config_t *cfg, const char *cat)
     else
 	config_set_int(cat, "mpu401_standalone", cfg->mpu401_standalone_enable);
 
+    if (cfg->sound_sink == 0)
+	config_delete_var(cat, "sound_output");
+    else
+	config_set_string(cat, "sound_output",
+			  sound_sink_get_internal_name(cfg->sound_sink));
+
     delete_section_if_empty(cat);
 }
 
@@ -2102,6 +2117,7 @@ config_init(config_t *cfg)
     cfg->cpu_manuf = 0;				// cpu manufacturer
     cfg->cpu_type = 3;				// cpu type
     cfg->cpu_use_dynarec = 0,			// cpu uses/needs Dyna
+    cfg->dynarec_cache = 0;			// Dyna code cache, in MB
     cfg->enable_ext_fpu = 0;			// enable external FPU
     cfg->mem_size = 256;			// memory size
     cfg->time_sync = TIME_SYNC_DISABLED;	// enable time sync
@@ -2131,6 +2147,7 @@ config_init(config_t *cfg)
     cfg->sound_card = SOUND_NONE;		// selected sound card
     cfg->mpu401_standalone_enable = 0;		// sound option
     cfg->midi_device = 0;			// selected midi device
+    cfg->sound_sink = 0;			// selected audio output
 
     cfg->game_enabled = 0;			// enable game port
 
@@ -8,13 +8,13 @@
  *
  *		Configuration file handler header.
  *
- * Version:	@(#)config.h	1.0.9	2021/03/20
+ * Version:	@(#)config.h	1.0.11	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -68,6 +68,7 @@ typedef struct {
     int		cpu_manuf,			/* cpu manufacturer */
 		cpu_type,			/* cpu type */
 		cpu_use_dynarec,		/* cpu uses/needs Dyna */
+		dynarec_cache,			/* Dyna code cache, in MB */
 		cpu_waitstates,
 		enable_ext_fpu;			/* enable external FPU */
 
@@ -99,7 +100,8 @@ typedef struct {
 		sound_gain,			/* sound volume gain */
 		sound_card,			/* selected sound card */
 		mpu401_standalone_enable,	/* sound option */
-		midi_device;			/* selected midi device */
+		midi_device,			/* selected midi device */
+		sound_sink;			/* selected audio output */
 
     int		game_enabled,			/* enable game port */
 		serial_enabled[SERIAL_MAX],	/* enable serial ports */
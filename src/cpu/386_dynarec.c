@@ -8,13 +8,13 @@
  *
  *		Implementation of the CPU's dynamic recompiler.
  *
- * Version:	@(#)386_dynarec.c	1.0.15	2021/11/02
+ * Version:	@(#)386_dynarec.c	1.0.16	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2018-2021 Fred N. van Kempen.
+ *		Copyright 2018-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2020 Sarah Walker.
  *
@@ -82,6 +82,7 @@ uint32_t	cpu_cur_status = 0;
 int		cpu_reps, cpu_reps_latched;
 int		cpu_notreps, cpu_notreps_latched;
 int		cpu_recomp_blocks, cpu_recomp_full_ins, cpu_new_blocks;
+int		cpu_recomp_blocks_latched;
 int		cpu_new_blocks_latched;
 
 int		inrecomp = 0;
@@ -539,6 +540,13 @@ int dontprint=0;
 #ifdef USE_DYNAREC
 static int cycles_main = 0;
 
+codeblock_t *codegen_chain_from = NULL;
+int codegen_chain_break = 0;
+
+codeblock_t *codeblock_index[CODEBLOCK_INDEX_SETS * CODEBLOCK_INDEX_WAYS];
+int codeblock_index_depth[CODEBLOCK_INDEX_WAYS + 1],
+    codeblock_index_depth_latched[CODEBLOCK_INDEX_WAYS + 1];
+
 void exec386_dynarec(int cycs)
 {
         uint8_t temp;
@@ -547,6 +555,7 @@ void exec386_dynarec(int cycs)
         int cycdiff;
         int oldcyc;
 	uint32_t start_pc = 0;
+        codeblock_t *chain_from;
 
         int cyc_period = cycs / 2000; /*5us*/
 
@@ -568,6 +577,11 @@ void exec386_dynarec(int cycs)
 
                 cycdiff=0;
                 oldcyc=cycles;
+
+                /*Block that ran last, if it is a candidate for linking*/
+                chain_from = codegen_chain_from;
+                codegen_chain_from = NULL;
+
                 if (!CACHE_ON()) {/*Interpret block*/
                         cpu_block_end = 0;
                         x86_was_reset = 0;
@@ -659,8 +673,8 @@ void exec386_dynarec(int cycs)
                                 
                                 if (page->code_present_mask[(phys_addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] & mask)
                                 {
-                                        /*Walk page tree to see if we find the correct block*/
-                                        codeblock_t *new_block = codeblock_tree_find(phys_addr, cs);
+                                        /*Look the block up in the index*/
+                                        codeblock_t *new_block = codeblock_index_find(phys_addr, cs);
                                         if (new_block) {
                                                 valid_block = (new_block->pc == cs + cpu_state.pc) && (new_block->_cs == cs) &&
                                                                 (new_block->phys == phys_addr) && !((new_block->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) &&
@@ -711,6 +725,11 @@ void exec386_dynarec(int cycs)
                         void (*code)() = (void (*)())&block->data[BLOCK_START];
 
                         codeblock_hash[hash] = block;
+                        block->used = 1;
+
+                        /*Let the previous block jump straight here next time*/
+                        codegen_chain_link(chain_from, block);
+                        codegen_chain_break = 0;
 
 			inrecomp=1;
 			code();
@@ -719,6 +738,7 @@ void exec386_dynarec(int cycs)
 			inrecomp=0;
                         if (!use32) cpu_state.pc &= 0xffff;
                         cpu_recomp_blocks++;
+                        ins += block->ins;
                 }
                 else if (valid_block && !cpu_state.abrt) {
                         start_pc = cpu_state.pc;
@@ -928,4 +948,39 @@ void exec386_dynarec(int cycs)
                 cycles_main -= (cycles_start - cycles);
         }
 }
+
+
+/* Latch the code cache counters, called once a second. */
+void codegen_stats_latch(void)
+{
+        int c;
+
+        cpu_recomp_blocks_latched = cpu_recomp_blocks;
+        cpu_recomp_misses_latched = cpu_recomp_misses;
+        cpu_recomp_chained_latched = cpu_recomp_chained;
+        cpu_new_blocks_latched = cpu_new_blocks;
+        cpu_recomp_reuse_latched = cpu_recomp_reuse;
+        cpu_recomp_evicted_latched = cpu_recomp_evicted;
+
+        DBGLOG(1, "CODEGEN: %i hits, %i misses, %i compiled, %i replaced, %i flushed, %i linked\n",
+               cpu_recomp_blocks_latched, cpu_recomp_misses_latched,
+               cpu_new_blocks_latched, cpu_recomp_reuse_latched,
+               cpu_recomp_evicted_latched, cpu_recomp_chained_latched);
+
+        for (c = 0; c <= CODEBLOCK_INDEX_WAYS; c++)
+        {
+                codeblock_index_depth_latched[c] = codeblock_index_depth[c];
+                codeblock_index_depth[c] = 0;
+        }
+        DBGLOG(1, "CODEGEN: index lookups: %i missed, %i/%i/%i/%i/%i/%i/%i/%i hit in way 1-8\n",
+               codeblock_index_depth_latched[0],
+               codeblock_index_depth_latched[1], codeblock_index_depth_latched[2],
+               codeblock_index_depth_latched[3], codeblock_index_depth_latched[4],
+               codeblock_index_depth_latched[5], codeblock_index_depth_latched[6],
+               codeblock_index_depth_latched[7], codeblock_index_depth_latched[8]);
+
+        cpu_recomp_blocks = cpu_recomp_misses = cpu_new_blocks = 0;
+        cpu_recomp_chained = 0;
+        cpu_recomp_reuse = cpu_recomp_evicted = 0;
+}
 #endif
@@ -8,13 +8,13 @@
  *
  *		808x CPU emulation.
  *
- * Version:	@(#)808x.c	1.0.25	2021/10/21
+ * Version:	@(#)808x.c	1.0.26	2026/10/17
  *
  * Authors:	Miran Grca, <mgrca8@gmail.com>
  *		Andrew Jenner (reenigne), <andrew@reenigne.org>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2016-2021 Fred N. van Kempen.
+ *		Copyright 2016-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2015-2018 Andrew Jenner.
  *		Copyright 2008-2018 Sarah Walker.
@@ -52,6 +52,7 @@
 #include "../mem.h"
 #include "../rom.h"
 #include "../timer.h"
+#include "../state.h"
 #include "../plat.h"
 
 
@@ -1460,7 +1461,7 @@ execx86(int cycs)
 
 opcodestart:
 	if (halt) {
-		cpu_wait(2, 0);
+		cpu_wait(cpu_idle(2), 0);
 		goto on_halt;
 	}
 
@@ -2777,6 +2778,23 @@ on_halt:
 }
 
 
+/* Save or load the state local to this core. */
+void
+x86_serialize(state_t *s)
+{
+    state_var(s, oldcs);
+    state_var(s, trap);
+    state_var(s, halt);
+    state_var(s, in_lock);
+    state_var(s, takeint);
+    state_var(s, noint);
+
+    /* Let the prefetch queue re-fill from the restored CS:IP. */
+    if (! state_saving(s))
+	pfq_clear();
+}
+
+
 /* Memory refresh read - called by reads and writes on DMA channel 0. */
 void
 refreshread(void)
@@ -8,7 +8,7 @@
  *
  *		Definitions for the code generator.
  *
- * Version:	@(#)codegen.h	1.0.9	2021/11/02
+ * Version:	@(#)codegen.h	1.0.10	2026/10/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -86,7 +86,6 @@ typedef struct codeblock_t
 {
         uint64_t page_mask, page_mask2;
         uint64_t *dirty_mask, *dirty_mask2;
-        uint64_t cmp;
         
         /*Previous and next pointers, for the codeblock list associated with
           each physical page. Two sets of pointers, as a codeblock can be
@@ -94,14 +93,14 @@ typedef struct codeblock_t
         struct codeblock_t *prev, *next;
         struct codeblock_t *prev_2, *next_2;
         
-        /*Pointers for codeblock tree, used to search for blocks when hash lookup
-          fails.*/
-        struct codeblock_t *parent, *left, *right;
+        /*Position in codeblock_index, or -1 if not in it*/
+        int index_slot;
         
         int pnt;
         int ins;
 
 	int valid;
+        int used; /*Executed since the eviction hand last passed it*/
 
         int was_recompiled;
         int TOP;
@@ -113,7 +112,22 @@ typedef struct codeblock_t
         uint32_t status;
         uint32_t flags;
 
+#ifdef CODEGEN_X86_64_H
+        /*Host code, in the code arena allocated by codegen_init()*/
+        uint8_t *data;
+
+        /*Direct links to successor blocks, patched into the exit code by
+          codegen_chain_link(). Each block also keeps a list of the links
+          pointing into it, so they can be undone when it is deleted.*/
+        struct codeblock_t *chain_to[BLOCK_CHAIN_SLOTS];
+        struct codeblock_t *chain_in_next[BLOCK_CHAIN_SLOTS];
+        int chain_in_next_slot[BLOCK_CHAIN_SLOTS];
+        struct codeblock_t *chain_in;
+        int chain_in_slot;
+        int chain_victim;
+#else
         uint8_t data[2048];
+#endif
 } codeblock_t;
 
 typedef struct
@@ -153,13 +167,21 @@ extern int		codegen_reg_loaded[8];
 
 extern int		codegen_block_cycles;
 
+/*Last block to leave compiled code through its exit path, and a flag set
+  when address translation changes, which stops chained execution*/
+extern codeblock_t	*codegen_chain_from;
+extern int		codegen_chain_break;
+
 extern int		cpu_new_blocks, cpu_new_blocks_latched,
+			cpu_recomp_blocks, cpu_recomp_blocks_latched,
 			cpu_reps, cpu_reps_latched,
 			cpu_notreps, cpu_notreps_latched;
 
 extern int      	cpu_recomp_evicted, cpu_recomp_evicted_latched,
 			cpu_recomp_reuse, cpu_recomp_reuse_latched,
-			cpu_recomp_removed, cpu_recomp_removed_latched;
+			cpu_recomp_removed, cpu_recomp_removed_latched,
+			cpu_recomp_misses, cpu_recomp_misses_latched,
+			cpu_recomp_chained, cpu_recomp_chained_latched;
 
 extern codegen_timing_t	codegen_timing_pentium;
 extern codegen_timing_t	codegen_timing_p6;
@@ -187,175 +209,99 @@ extern uint32_t	op_old_pc;
 /*Code block is always entered with the same FPU top-of-stack*/
 #define CODEBLOCK_STATIC_TOP 2
 
-static inline codeblock_t *codeblock_tree_find(uint32_t phys, uint32_t __cs)
-{
-        codeblock_t *block = pages[phys >> 12].head;
-        uint64_t a = __cs | ((uint64_t)phys << 32);
-        
-        while (block)
-        {
-                if (a == block->cmp)
-                {
-                        if (!((block->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) &&
-                             ((block->status & cpu_cur_status & CPU_STATUS_MASK) == (cpu_cur_status & CPU_STATUS_MASK)))
-                                break;
-                }
-                if (a < block->cmp)
-                        block = block->left;
-                else
-                        block = block->right;
-        }
-        
-        return block;
-}
+/*Set-associative index of all code blocks, searched when the direct-mapped
+  codeblock_hash misses. Blocks are keyed on physical address, code segment
+  base and the part of the CPU status that has to match exactly, so a lookup
+  probes at most CODEBLOCK_INDEX_WAYS entries, however many blocks share a
+  page. Each set is packed, and kept in most-recently-used order.*/
+#define CODEBLOCK_INDEX_SETS 0x4000
+#define CODEBLOCK_INDEX_BITS 14
+#define CODEBLOCK_INDEX_WAYS 8
+
+extern codeblock_t	*codeblock_index[CODEBLOCK_INDEX_SETS * CODEBLOCK_INDEX_WAYS];
+
+/*Lookup depth histogram. Entry 0 counts misses, entry n hits in way n-1*/
+extern int		codeblock_index_depth[CODEBLOCK_INDEX_WAYS + 1],
+			codeblock_index_depth_latched[CODEBLOCK_INDEX_WAYS + 1];
 
-static inline void codeblock_tree_add(codeblock_t *new_block)
+static inline codeblock_t **codeblock_index_set(uint32_t phys, uint32_t __cs, uint32_t status)
 {
-        codeblock_t *block = pages[new_block->phys >> 12].head;
-        uint64_t a = new_block->_cs | ((uint64_t)new_block->phys << 32);
-        new_block->cmp = a;
-                
-        if (!block)
-        {
-                pages[new_block->phys >> 12].head = new_block;
-                new_block->parent = new_block->left = new_block->right = NULL;
-        }
-        else
-        {
-                codeblock_t *old_block = NULL;
-                
-                while (block)
-                {
-                        old_block = block;
-                        if (a < old_block->cmp)
-                                block = block->left;
-                        else
-                                block = block->right;
-                }
-                
-                if (a < old_block->cmp)
-                        old_block->left = new_block;
-                else
-                        old_block->right = new_block;
-                
-                new_block->parent = old_block;
-                new_block->left = new_block->right = NULL;
-        }
+        uint32_t h = (phys * 0x9e3779b1) ^ (__cs * 0x85ebca6b) ^ ((status & CPU_STATUS_FLAGS) * 0xc2b2ae35);
+
+        return &codeblock_index[(h >> (32 - CODEBLOCK_INDEX_BITS)) * CODEBLOCK_INDEX_WAYS];
 }
 
-static inline void codeblock_tree_delete(codeblock_t *block)
+static inline codeblock_t *codeblock_index_find(uint32_t phys, uint32_t __cs)
 {
-        codeblock_t *parent = block->parent;
+        codeblock_t **set = codeblock_index_set(phys, __cs, cpu_cur_status);
+        codeblock_t *block;
+        int c, d;
 
-        if (!block->left && !block->right)
+        for (c = 0; c < CODEBLOCK_INDEX_WAYS; c++)
         {
-                /*Easy case - remove from parent*/
-                if (!parent)
-                        pages[block->phys >> 12].head = NULL;
-                else
+                block = set[c];
+                if (!block)
+                        break;
+                if (block->phys == phys && block->_cs == __cs &&
+                    !((block->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) &&
+                    ((block->status & cpu_cur_status & CPU_STATUS_MASK) == (cpu_cur_status & CPU_STATUS_MASK)))
                 {
-                        if (parent->left == block)
-                                parent->left = NULL;
-                        if (parent->right == block)
-                                parent->right = NULL;
-                }
-                return;
-        }
-        else if (!block->left)
-        {
-                /*Only right node*/
-                if (!parent)
-                {
-                        pages[block->phys >> 12].head = block->right;
-                        pages[block->phys >> 12].head->parent = NULL;
-                }
-                else
-                {
-                        if (parent->left == block)
-                        {
-                                parent->left = block->right;
-                                parent->left->parent = parent;
-                        }
-                        if (parent->right == block)
+                        codeblock_index_depth[c + 1]++;
+
+                        /*Move to front*/
+                        for (d = c; d > 0; d--)
                         {
-                                parent->right = block->right;
-                                parent->right->parent = parent;
+                                set[d] = set[d - 1];
+                                set[d]->index_slot++;
                         }
+                        set[0] = block;
+                        block->index_slot -= c;
+
+                        return block;
                 }
-                return;
         }
-        else if (!block->right)
+
+        codeblock_index_depth[0]++;
+        return NULL;
+}
+
+static inline void codeblock_index_add(codeblock_t *new_block)
+{
+        codeblock_t **set = codeblock_index_set(new_block->phys, new_block->_cs, new_block->status);
+        int d;
+
+        /*If the set is full, the least recently used block drops out. It
+          stays valid, but can only be found through codeblock_hash now*/
+        if (set[CODEBLOCK_INDEX_WAYS - 1])
+                set[CODEBLOCK_INDEX_WAYS - 1]->index_slot = -1;
+
+        for (d = CODEBLOCK_INDEX_WAYS - 1; d > 0; d--)
         {
-                /*Only left node*/
-                if (!parent)
-                {
-                        pages[block->phys >> 12].head = block->left;
-                        pages[block->phys >> 12].head->parent = NULL;
-                }
-                else
-                {
-                        if (parent->left == block)
-                        {
-                                parent->left = block->left;
-                                parent->left->parent = parent;
-                        }
-                        if (parent->right == block)
-                        {
-                                parent->right = block->left;
-                                parent->right->parent = parent;
-                        }
-                }
-                return;
+                set[d] = set[d - 1];
+                if (set[d])
+                        set[d]->index_slot++;
         }
-        else
-        {
-                /*Difficult case - node has two children. Walk right child to find lowest node*/
-                codeblock_t *lowest = block->right, *highest;
-                codeblock_t *old_parent;
-                        
-                while (lowest->left)
-                        lowest = lowest->left;
-
-                old_parent = lowest->parent;
-
-                /*Replace deleted node with lowest node*/
-                if (!parent)
-                        pages[block->phys >> 12].head = lowest;
-                else
-                {
-                        if (parent->left == block)
-                                parent->left = lowest;
-                        if (parent->right == block)
-                                parent->right = lowest;
-                }
-
-                lowest->parent = parent;
-                lowest->left = block->left;
-                if (lowest->left)
-                        lowest->left->parent = lowest;
+        set[0] = new_block;
+        new_block->index_slot = (int)(set - codeblock_index);
+}
 
-                old_parent->left = NULL;
-                                
-                highest = lowest->right;
-                if (!highest)
-                {
-                        if (lowest != block->right)
-                        {
-                                lowest->right = block->right;
-                                block->right->parent = lowest;
-                        }
-                        return;
-                }
+static inline void codeblock_index_delete(codeblock_t *block)
+{
+        codeblock_t **set;
+        int c;
 
-                while (highest->right)
-                        highest = highest->right;
+        if (block->index_slot < 0)
+                return;
 
-                if (block->right && block->right != lowest)
-                {
-                        highest->right = block->right;
-                        block->right->parent = highest;
-                }
+        set = &codeblock_index[block->index_slot & ~(CODEBLOCK_INDEX_WAYS - 1)];
+        for (c = block->index_slot & (CODEBLOCK_INDEX_WAYS - 1); c < CODEBLOCK_INDEX_WAYS - 1; c++)
+        {
+                set[c] = set[c + 1];
+                if (set[c])
+                        set[c]->index_slot--;
         }
+        set[CODEBLOCK_INDEX_WAYS - 1] = NULL;
+        block->index_slot = -1;
 }
 
 #define CPU_BLOCK_END() cpu_block_end = 1
@@ -410,6 +356,7 @@ void codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t
 void codegen_generate_seg_restore(void);
 void codegen_set_op32(void);
 void codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr);
+void codegen_chain_link(codeblock_t *from, codeblock_t *to);
 #endif
 
 
@@ -418,6 +365,7 @@ void codegen_reset(void);
 void codegen_block_init(uint32_t phys_addr);
 void codegen_block_remove(void);
 void codegen_flush(void);
+void codegen_stats_latch(void);
 
 
 #endif	/*CPU_CODEGEN_H*/
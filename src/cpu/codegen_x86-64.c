@@ -8,7 +8,7 @@
  *
  *		Dynamic Recompiler for Intel x64 systems.
  *
- * Version:	@(#)codegen_x86-64.c	1.0.5	2021/11/02
+ * Version:	@(#)codegen_x86-64.c	1.0.7	2026/10/17
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -47,6 +47,9 @@
 #include "x86_ops.h"
 #include "x87.h"
 #include "../mem.h"
+#include "../config.h"
+#include "../devices/system/nmi.h"
+#include "../devices/system/pic.h"
 
 #include "386_common.h"
 
@@ -84,9 +87,22 @@ int block_current = 0;
 static int block_num;
 int block_pos;
 
+/*Number of blocks in the cache, and the code arena*/
+static int block_total;
+static uint8_t *block_data;
+
+/*Layout of the exit code, which is the same for all blocks. Each link slot
+  starts with a two-byte gate, which is a short jump over the slot while it
+  is unused, and a two-byte NOP once it has been linked*/
+#define CHAIN_SLOT_SIZE 104
+static int chain_slot_offset[BLOCK_CHAIN_SLOTS];
+static int chain_entry_offset;
+
 int cpu_recomp_evicted, cpu_recomp_evicted_latched;
 int cpu_recomp_reuse, cpu_recomp_reuse_latched;
 int cpu_recomp_removed, cpu_recomp_removed_latched;
+int cpu_recomp_misses, cpu_recomp_misses_latched;
+int cpu_recomp_chained, cpu_recomp_chained_latched;
 
 uint32_t codegen_endpc;
 
@@ -98,51 +114,62 @@ static uint32_t last_op32;
 static x86seg *last_ea_seg;
 static int last_ssegs;
 
-void codegen_init()
+/*Clear all block metadata, and hand each block its slice of the arena*/
+static void codegen_blocks_clear(void)
 {
         int c;
 
-#if defined(__linux__) || defined(__APPLE__)
-	void *start;
-	size_t len;
-	long pagesize = sysconf(_SC_PAGESIZE);
-	long pagemask = ~(pagesize - 1);
-#endif
-        
-#if WIN64
-        codeblock = VirtualAlloc(NULL, BLOCK_SIZE * sizeof(codeblock_t), MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-#else
-        codeblock = mem_alloc(BLOCK_SIZE * sizeof(codeblock_t));
-#endif
-        codeblock_hash = mem_alloc(HASH_SIZE * sizeof(codeblock_t *));
-
-        memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
+        memset(codeblock, 0, block_total * sizeof(codeblock_t));
         memset(codeblock_hash, 0, HASH_SIZE * sizeof(codeblock_t *));
+        memset(codeblock_index, 0, sizeof(codeblock_index));
 
-        for (c = 0; c < BLOCK_SIZE; c++)
+        for (c = 0; c < block_total; c++)
+        {
                 codeblock[c].valid = 0;
+                codeblock[c].data = &block_data[c * BLOCK_DATA_SIZE];
+        }
+        block_current = 0;
+}
 
-#if defined(__linux__) || defined(__APPLE__)
-	start = (void *)((long)codeblock & pagemask);
-	len = ((BLOCK_SIZE * sizeof(codeblock_t)) + pagesize) & pagemask;
-	if (mprotect(start, len, PROT_READ | PROT_WRITE | PROT_EXEC) != 0)
-	{
-		perror("mprotect");
-		exit(-1);
-	}
+void codegen_init()
+{
+        size_t len;
+        int mb;
+
+        /*Size the cache from the configured arena size, in MB*/
+        mb = config.dynarec_cache ? config.dynarec_cache : BLOCK_CACHE_DEF;
+        if (mb < BLOCK_CACHE_MIN)
+                mb = BLOCK_CACHE_MIN;
+        if (mb > BLOCK_CACHE_MAX)
+                mb = BLOCK_CACHE_MAX;
+        block_total = (int)(((size_t)mb << 20) / BLOCK_DATA_SIZE);
+        len = (size_t)block_total * BLOCK_DATA_SIZE;
+
+        INFO("CODEGEN: %i blocks, %i KB code cache\n", block_total, (int)(len >> 10));
+
+        /*Only the code arena has to be executable*/
+#if WIN64
+        block_data = VirtualAlloc(NULL, len, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+#elif defined(__linux__) || defined(__APPLE__)
+        block_data = mmap(NULL, len, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (block_data == MAP_FAILED)
+        {
+                perror("mmap");
+                exit(-1);
+        }
+#else
+        block_data = mem_alloc(len);
 #endif
+        codeblock = mem_alloc(block_total * sizeof(codeblock_t));
+        codeblock_hash = mem_alloc(HASH_SIZE * sizeof(codeblock_t *));
+
+        codegen_blocks_clear();
 }
 
 void codegen_reset()
 {
-        int c;
-        
-        memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
-        memset(codeblock_hash, 0, HASH_SIZE * sizeof(codeblock_t *));
+        codegen_blocks_clear();
         mem_reset_page_blocks();
-
-        for (c = 0; c < BLOCK_SIZE; c++)
-                codeblock[c].valid = 0;
 }
 
 void dump_block()
@@ -234,6 +261,54 @@ static void remove_from_block_list(codeblock_t *block, uint32_t pc)
         }
 }
 
+/*Undo the link held in one of the slots of a block*/
+static void chain_unlink_slot(codeblock_t *from, int slot)
+{
+        codeblock_t *to = from->chain_to[slot];
+        codeblock_t **pp;
+        int *ps;
+
+        if (to == NULL)
+                return;
+
+        /*Find it in the list of links into the target*/
+        pp = &to->chain_in;
+        ps = &to->chain_in_slot;
+        while (*pp != NULL)
+        {
+                codeblock_t *b = *pp;
+                int s = *ps;
+
+                if (b == from && s == slot)
+                {
+                        *pp = from->chain_in_next[slot];
+                        *ps = from->chain_in_next_slot[slot];
+                        break;
+                }
+                pp = &b->chain_in_next[s];
+                ps = &b->chain_in_next_slot[s];
+        }
+
+        from->chain_to[slot] = NULL;
+        from->chain_in_next[slot] = NULL;
+
+        /*Close the gate, so the slot is skipped again*/
+        from->data[chain_slot_offset[slot]] = 0xeb; /*JMP over slot*/
+        from->data[chain_slot_offset[slot] + 1] = CHAIN_SLOT_SIZE - 2;
+}
+
+/*Undo all links out of, and into, a block*/
+static void chain_unlink(codeblock_t *block)
+{
+        int c;
+
+        for (c = 0; c < BLOCK_CHAIN_SLOTS; c++)
+                chain_unlink_slot(block, c);
+
+        while (block->chain_in != NULL)
+                chain_unlink_slot(block->chain_in, block->chain_in_slot);
+}
+
 static void delete_block(codeblock_t *block)
 {
         uint32_t old_pc = block->pc;
@@ -245,7 +320,8 @@ static void delete_block(codeblock_t *block)
                 fatal("Deleting deleted block\n");
         block->valid = 0;
 
-        codeblock_tree_delete(block);
+        chain_unlink(block);
+        codeblock_index_delete(block);
         remove_from_block_list(block, old_pc);
 }
 
@@ -284,12 +360,25 @@ void codegen_block_init(uint32_t phys_addr)
 {
         codeblock_t *block;
         page_t *page = &pages[phys_addr >> 12];
+        int c;
         
         if (!page->block[(phys_addr >> 10) & 3])
                 mem_flush_write_page(phys_addr, cs+cpu_state.pc);
 
-        block_current = (block_current + 1) & BLOCK_MASK;
-        block = &codeblock[block_current];
+        cpu_recomp_misses++;
+
+        /*Second-chance replacement: step over blocks that have run since
+          the hand last passed them, clearing their flag on the way. If all
+          of them have, we end up taking the block we started from.*/
+        for (c = 0; c < block_total; c++)
+        {
+                if (++block_current == block_total)
+                        block_current = 0;
+                block = &codeblock[block_current];
+                if (!block->valid || !block->used)
+                        break;
+                block->used = 0;
+        }
 
         if (block->valid != 0)
         {
@@ -300,6 +389,7 @@ void codegen_block_init(uint32_t phys_addr)
         codeblock_hash[block_num] = &codeblock[block_current];
 
 	block->valid = 1;
+        block->used = 0;
         block->ins = 0;
         block->pc = cs + cpu_state.pc;
         block->_cs = cs;
@@ -317,7 +407,298 @@ void codegen_block_init(uint32_t phys_addr)
 
         recomp_page = block->phys & ~0xfff;
         
-        codeblock_tree_add(block);
+        codeblock_index_add(block);
+}
+
+/*Emit the exit code at BLOCK_EXIT_OFFSET. All exits from a block come
+  through here. Unless the dispatcher has something to do between blocks (the
+  timeslice ran out, an exception, trap, interrupt or NMI is pending, address
+  translation changed or the cache got disabled), the exit does the per-block
+  bookkeeping of the dispatcher (oldcs, oldpc and op32, which a fault in the
+  next block rolls back to), and the link slots compare the guest state
+  against what their target block was compiled for, and jump straight into
+  its body. Otherwise, the block records itself as the last one to exit, so
+  the dispatcher can link it to the next block it runs.*/
+static void codegen_chain_exit(codeblock_t *block)
+{
+        int out_pos[8];
+        int nr_out = 0;
+        int c;
+
+        block_pos = BLOCK_EXIT_OFFSET;
+
+        addbyte(0x83); /*CMP $0,cycles*/
+        addbyte(0x7d);
+        addbyte((uint8_t)cpu_state_offset(_cycles));
+        addbyte(0);
+        addbyte(0x0f); /*JLE out*/
+        addbyte(0x8e);
+        out_pos[nr_out++] = block_pos;
+        addlong(0);
+
+        addbyte(0x80); /*CMPB $0,abrt*/
+        addbyte(0x7d);
+        addbyte((uint8_t)cpu_state_offset(abrt));
+        addbyte(0);
+        addbyte(0x0f); /*JNZ out*/
+        addbyte(0x85);
+        out_pos[nr_out++] = block_pos;
+        addlong(0);
+
+        addbyte(0x66); /*TESTW $T_FLAG,flags*/
+        addbyte(0xf7);
+        addbyte(0x45);
+        addbyte((uint8_t)cpu_state_offset(flags));
+        addword(T_FLAG);
+        addbyte(0x0f); /*JNZ out*/
+        addbyte(0x85);
+        out_pos[nr_out++] = block_pos;
+        addlong(0);
+
+        addbyte(0x48); /*MOV RAX, &pic_pending*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&pic_pending);
+        addbyte(0x83); /*CMPL $0,(RAX)*/
+        addbyte(0x38);
+        addbyte(0);
+        addbyte(0x0f); /*JNZ out*/
+        addbyte(0x85);
+        out_pos[nr_out++] = block_pos;
+        addlong(0);
+
+        addbyte(0x48); /*MOV RAX, &nmi*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&nmi);
+        addbyte(0x83); /*CMPL $0,(RAX)*/
+        addbyte(0x38);
+        addbyte(0);
+        addbyte(0x0f); /*JNZ out*/
+        addbyte(0x85);
+        out_pos[nr_out++] = block_pos;
+        addlong(0);
+
+        addbyte(0x48); /*MOV RAX, &codegen_chain_break*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&codegen_chain_break);
+        addbyte(0x83); /*CMPL $0,(RAX)*/
+        addbyte(0x38);
+        addbyte(0);
+        addbyte(0x0f); /*JNZ out*/
+        addbyte(0x85);
+        out_pos[nr_out++] = block_pos;
+        addlong(0);
+
+        addbyte(0x48); /*MOV RAX, &cr0*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&cr0);
+        addbyte(0xf7); /*TESTL $CD,(RAX)*/
+        addbyte(0x00);
+        addlong(1 << 30);
+        addbyte(0x0f); /*JNZ out*/
+        addbyte(0x85);
+        out_pos[nr_out++] = block_pos;
+        addlong(0);
+
+        addbyte(0x48); /*MOV RAX, &cpu_cur_status*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&cpu_cur_status);
+        addbyte(0x8b); /*MOVL (RAX),EAX*/
+        addbyte(0x00);
+
+        addbyte(0x0f); /*MOVZWL seg_cs.seg,ECX*/
+        addbyte(0xb7);
+        addbyte(0x8d);
+        addlong((uint32_t)((uintptr_t)&cpu_state.seg_cs.seg - ((uintptr_t)&cpu_state + 128)));
+        addbyte(0x48); /*MOV RDX, &oldcs*/
+        addbyte(0xba);
+        addquad((uintptr_t)&oldcs);
+        addbyte(0x66); /*MOVW CX,(RDX)*/
+        addbyte(0x89);
+        addbyte(0x0a);
+        addbyte(0x8b); /*MOVL pc,ECX*/
+        addbyte(0x4d);
+        addbyte((uint8_t)cpu_state_offset(pc));
+        addbyte(0x89); /*MOVL ECX,oldpc*/
+        addbyte(0x4d);
+        addbyte((uint8_t)cpu_state_offset(oldpc));
+        addbyte(0x48); /*MOV RDX, &use32*/
+        addbyte(0xba);
+        addquad((uintptr_t)&use32);
+        addbyte(0x8b); /*MOVL (RDX),ECX*/
+        addbyte(0x0a);
+        addbyte(0x89); /*MOVL ECX,op32*/
+        addbyte(0x4d);
+        addbyte((uint8_t)cpu_state_offset(op32));
+
+        /*Link slots, filled in by codegen_chain_link()*/
+        for (c = 0; c < BLOCK_CHAIN_SLOTS; c++)
+        {
+                int d;
+
+                chain_slot_offset[c] = block_pos;
+                addbyte(0xeb); /*JMP over slot*/
+                addbyte(CHAIN_SLOT_SIZE - 2);
+                for (d = 2; d < CHAIN_SLOT_SIZE; d++)
+                        addbyte(0xcc); /*INT3*/
+        }
+
+        /*out:*/
+        for (c = 0; c < nr_out; c++)
+                *(uint32_t *)&block->data[out_pos[c]] = block_pos - (out_pos[c] + 4);
+
+        addbyte(0x48); /*MOV RAX, block*/
+        addbyte(0xb8);
+        addquad((uintptr_t)block);
+        addbyte(0x48); /*MOV RCX, &codegen_chain_from*/
+        addbyte(0xb9);
+        addquad((uintptr_t)&codegen_chain_from);
+        addbyte(0x48); /*MOV RAX,(RCX)*/
+        addbyte(0x89);
+        addbyte(0x01);
+        addbyte(0x48); /*ADDL $40,%rsp*/
+        addbyte(0x83);
+        addbyte(0xC4);
+        addbyte(0x28);
+        addbyte(0x41); /*POP R15*/
+        addbyte(0x5f);
+        addbyte(0x41); /*POP R14*/
+        addbyte(0x5e);
+        addbyte(0x41); /*POP R13*/
+        addbyte(0x5d);
+        addbyte(0x41); /*POP R12*/
+        addbyte(0x5c);
+        addbyte(0x5f); /*POP RDI*/
+        addbyte(0x5e); /*POP RSI*/
+        addbyte(0x5d); /*POP RBP*/
+        addbyte(0x5b); /*POP RDX*/
+        addbyte(0xC3); /*RET*/
+
+        if (block_pos > BLOCK_DATA_SIZE)
+                fatal("Exit code over limit!\n");
+}
+
+/*Link a block to the block the dispatcher is about to run after it. Only
+  blocks on the same page (both linear and physical) are linked, as the
+  mapping of that page was checked when the dispatcher entered the first
+  block of a chain, and any change to it breaks the chain. Targets spanning
+  two pages, or relying on a fixed FPU top-of-stack, need the checks done by
+  the dispatcher, and are never linked to. The slot does the accounting of
+  the dispatcher too, including the used flag the eviction hand looks at.*/
+void codegen_chain_link(codeblock_t *from, codeblock_t *to)
+{
+        uint8_t *p, *end;
+        intptr_t rel;
+        int slot;
+
+        if (from == NULL || !from->valid || !from->was_recompiled || !to->was_recompiled)
+                return;
+        if (((from->pc ^ to->pc) & ~0xfff) || ((from->phys ^ to->phys) & ~0xfff))
+                return;
+        if (to->page_mask2 || (to->flags & CODEBLOCK_STATIC_TOP))
+                return;
+
+        for (slot = 0; slot < BLOCK_CHAIN_SLOTS; slot++)
+        {
+                if (from->chain_to[slot] == to)
+                        return;
+        }
+        for (slot = 0; slot < BLOCK_CHAIN_SLOTS; slot++)
+        {
+                if (from->chain_to[slot] == NULL)
+                        break;
+        }
+        if (slot == BLOCK_CHAIN_SLOTS)
+        {
+                /*All slots taken, replace them in turn*/
+                slot = from->chain_victim;
+                from->chain_victim = (slot + 1) % BLOCK_CHAIN_SLOTS;
+                chain_unlink_slot(from, slot);
+        }
+
+        p = &from->data[chain_slot_offset[slot]];
+        end = p + CHAIN_SLOT_SIZE;
+        rel = (intptr_t)&to->data[chain_entry_offset] - (intptr_t)end;
+        if (rel != (int32_t)rel)
+                return;
+
+        p += 2;
+        *p++ = 0x81; /*CMPL $pc,pc*/
+        *p++ = 0x7d;
+        *p++ = (uint8_t)cpu_state_offset(pc);
+        *(uint32_t *)p = to->pc - to->_cs;
+        p += 4;
+        *p++ = 0x75; /*JNZ next*/
+        *p = (uint8_t)(end - (p + 1));
+        p++;
+        *p++ = 0x81; /*CMPL $_cs,seg_cs.base*/
+        *p++ = 0xbd;
+        *(uint32_t *)p = (uint32_t)((uintptr_t)&cpu_state.seg_cs.base - ((uintptr_t)&cpu_state + 128));
+        p += 4;
+        *(uint32_t *)p = to->_cs;
+        p += 4;
+        *p++ = 0x75; /*JNZ next*/
+        *p = (uint8_t)(end - (p + 1));
+        p++;
+        *p++ = 0x3d; /*CMPL $status,EAX*/
+        *(uint32_t *)p = to->status;
+        p += 4;
+        *p++ = 0x75; /*JNZ next*/
+        *p = (uint8_t)(end - (p + 1));
+        p++;
+        *p++ = 0x48; /*MOV RCX, dirty_mask*/
+        *p++ = 0xb9;
+        *(uint64_t *)p = (uintptr_t)to->dirty_mask;
+        p += 8;
+        *p++ = 0x48; /*MOV RDX, page_mask*/
+        *p++ = 0xba;
+        *(uint64_t *)p = to->page_mask;
+        p += 8;
+        *p++ = 0x48; /*TEST RDX,(RCX)*/
+        *p++ = 0x85;
+        *p++ = 0x11;
+        *p++ = 0x75; /*JNZ next*/
+        *p = (uint8_t)(end - (p + 1));
+        p++;
+        *p++ = 0x48; /*MOV RCX, &ins*/
+        *p++ = 0xb9;
+        *(uint64_t *)p = (uintptr_t)&ins;
+        p += 8;
+        *p++ = 0x81; /*ADDL $ins,(RCX)*/
+        *p++ = 0x01;
+        *(uint32_t *)p = to->ins;
+        p += 4;
+        *p++ = 0x48; /*MOV RCX, &cpu_recomp_blocks*/
+        *p++ = 0xb9;
+        *(uint64_t *)p = (uintptr_t)&cpu_recomp_blocks;
+        p += 8;
+        *p++ = 0xff; /*INCL (RCX)*/
+        *p++ = 0x01;
+        *p++ = 0x48; /*MOV RCX, &to->used*/
+        *p++ = 0xb9;
+        *(uint64_t *)p = (uintptr_t)&to->used;
+        p += 8;
+        *p++ = 0xc7; /*MOVL $1,(RCX)*/
+        *p++ = 0x01;
+        *(uint32_t *)p = 1;
+        p += 4;
+        *p++ = 0xe9; /*JMP to+chain_entry_offset*/
+        *(uint32_t *)p = (uint32_t)rel;
+        p += 4;
+        if (p != end)
+                fatal("Bad chain slot size\n");
+
+        /*Add it to the list of links into the target*/
+        from->chain_to[slot] = to;
+        from->chain_in_next[slot] = to->chain_in;
+        from->chain_in_next_slot[slot] = to->chain_in_slot;
+        to->chain_in = from;
+        to->chain_in_slot = slot;
+
+        /*Open the gate*/
+        from->data[chain_slot_offset[slot]] = 0x66; /*NOP*/
+        from->data[chain_slot_offset[slot] + 1] = 0x90;
+
+        cpu_recomp_chained++;
 }
 
 void codegen_block_start_recompile(codeblock_t *block)
@@ -333,6 +714,8 @@ void codegen_block_start_recompile(codeblock_t *block)
         if (block->pc != cs + cpu_state.pc || block->was_recompiled)
                 fatal("Recompile to used block!\n");
 
+        chain_unlink(block);
+
         block->status = cpu_cur_status;
         
         block_pos = BLOCK_GPF_OFFSET;
@@ -363,24 +746,7 @@ void codegen_block_start_recompile(codeblock_t *block)
 	addbyte(0x67);	/* mov [&(abrt_error)],eax */
 	addbyte(0xa3);
 	addlong((uint32_t) (uintptr_t) &(abrt_error));
-        block_pos = BLOCK_EXIT_OFFSET; /*Exit code*/
-        addbyte(0x48); /*ADDL $40,%rsp*/
-        addbyte(0x83);
-        addbyte(0xC4);
-        addbyte(0x28);
-        addbyte(0x41); /*POP R15*/
-        addbyte(0x5f);
-        addbyte(0x41); /*POP R14*/
-        addbyte(0x5e);
-        addbyte(0x41); /*POP R13*/
-        addbyte(0x5d);
-        addbyte(0x41); /*POP R12*/
-        addbyte(0x5c);
-        addbyte(0x5f); /*POP RDI*/
-        addbyte(0x5e); /*POP RSI*/
-        addbyte(0x5d); /*POP RBP*/
-        addbyte(0x5b); /*POP RDX*/
-        addbyte(0xC3); /*RET*/
+        codegen_chain_exit(block);
         cpu_block_end = 0;
         block_pos = 0; /*Entry code*/
         addbyte(0x53); /*PUSH RBX*/
@@ -402,6 +768,7 @@ void codegen_block_start_recompile(codeblock_t *block)
         addbyte(0x48); /*MOVL RBP, &cpu_state*/
         addbyte(0xBD);
         addquad(((uintptr_t)&cpu_state) + 128);
+        chain_entry_offset = block_pos;
 
         last_op32 = -1;
         last_ea_seg = NULL;
@@ -528,23 +895,8 @@ void codegen_block_end_recompile(codeblock_t *block)
                 addlong(codegen_block_full_ins);
         }
 #endif
-        addbyte(0x48); /*ADDL $40,%rsp*/
-        addbyte(0x83);
-        addbyte(0xC4);
-        addbyte(0x28);
-        addbyte(0x41); /*POP R15*/
-        addbyte(0x5f);
-        addbyte(0x41); /*POP R14*/
-        addbyte(0x5e);
-        addbyte(0x41); /*POP R13*/
-        addbyte(0x5d);
-        addbyte(0x41); /*POP R12*/
-        addbyte(0x5c);
-        addbyte(0x5f); /*POP RDI*/
-        addbyte(0x5e); /*POP RSI*/
-        addbyte(0x5d); /*POP RBP*/
-        addbyte(0x5b); /*POP RDX*/
-        addbyte(0xC3); /*RET*/
+        addbyte(0xE9); /*JMP BLOCK_EXIT_OFFSET*/
+        addlong(BLOCK_EXIT_OFFSET - (block_pos + 4));
         
         if (block_pos > BLOCK_GPF_OFFSET)
                 fatal("Over limit!\n");
@@ -8,7 +8,7 @@
  *
  *		Definitions for the 64-bit code generator.
  *
- * Version:	@(#)codegen_x86-64.h	1.0.3	2020/12/13
+ * Version:	@(#)codegen_x86-64.h	1.0.4	2026/10/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -38,8 +38,14 @@
 # define CODEGEN_X86_64_H
 
 
-#define BLOCK_SIZE 0x4000
-#define BLOCK_MASK 0x3fff
+/*Host code space per block, and the default size of the code arena in MB.
+  The number of blocks is derived from the arena size, see codegen_init().
+  The arena is capped so that chained blocks can always reach each other
+  with a 32-bit relative jump*/
+#define BLOCK_DATA_SIZE 0xa00
+#define BLOCK_CACHE_DEF 40
+#define BLOCK_CACHE_MIN 2
+#define BLOCK_CACHE_MAX 1024
 #define BLOCK_START 0
 
 #define HASH_SIZE 0x20000
@@ -53,6 +59,9 @@
 
 #define BLOCK_MAX 1620
 
+/*Number of direct links to successor blocks each block can hold*/
+#define BLOCK_CHAIN_SLOTS 2
+
 enum
 {
         OP_RET = 0xc3
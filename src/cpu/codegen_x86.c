@@ -8,13 +8,13 @@
  *
  *		Dynamic Recompiler for Intel 32-bit systems.
  *
- * Version:	@(#)codegen_x86.c	1.0.10	2021/11/02
+ * Version:	@(#)codegen_x86.c	1.0.11	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
  *
- *		Copyright 2018-2021 Fred N. van Kempen.
+ *		Copyright 2018-2026 Fred N. van Kempen.
  *		Copyright 2008-2018 Sarah Walker.
  *		Copyright 2016-2021 Miran Grca.
  *
@@ -93,6 +93,8 @@ int block_pos;
 int cpu_recomp_evicted, cpu_recomp_evicted_latched;
 int cpu_recomp_reuse, cpu_recomp_reuse_latched;
 int cpu_recomp_removed, cpu_recomp_removed_latched;
+int cpu_recomp_misses, cpu_recomp_misses_latched;
+int cpu_recomp_chained, cpu_recomp_chained_latched;
 
 
 uint32_t codegen_endpc;
@@ -1193,6 +1195,7 @@ void codegen_init()
 
         memset(codeblock, 0, (BLOCK_SIZE+1) * sizeof(codeblock_t));
         memset(codeblock_hash, 0, HASH_SIZE * sizeof(codeblock_t *));
+        memset(codeblock_index, 0, sizeof(codeblock_index));
 
 #ifdef __linux__
 	start = (void *)((long)codeblock & pagemask);
@@ -1267,6 +1270,7 @@ void codegen_reset()
 {
         memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
         memset(codeblock_hash, 0, HASH_SIZE * sizeof(codeblock_t *));
+        memset(codeblock_index, 0, sizeof(codeblock_index));
         mem_reset_page_blocks();
 }
 
@@ -1370,7 +1374,7 @@ static void delete_block(codeblock_t *block)
                 fatal("Deleting deleted block\n");
         block->valid = 0;
 
-        codeblock_tree_delete(block);
+        codeblock_index_delete(block);
         remove_from_block_list(block, old_pc);
 }
 
@@ -1413,6 +1417,8 @@ void codegen_block_init(uint32_t phys_addr)
         if (!page->block[(phys_addr >> 10) & 3])
                 mem_flush_write_page(phys_addr, cs+cpu_state.pc);
 
+        cpu_recomp_misses++;
+
         block_current = (block_current + 1) & BLOCK_MASK;
         block = &codeblock[block_current];
 
@@ -1425,6 +1431,7 @@ void codegen_block_init(uint32_t phys_addr)
         codeblock_hash[block_num] = &codeblock[block_current];
 
 	block->valid = 1;
+        block->used = 0;
         block->ins = 0;
         block->pc = cs + cpu_state.pc;
         block->_cs = cs;
@@ -1442,7 +1449,7 @@ void codegen_block_init(uint32_t phys_addr)
 
         recomp_page = block->phys & ~0xfff;
         
-        codeblock_tree_add(block);
+        codeblock_index_add(block);
 }
 
 void codegen_block_start_recompile(codeblock_t *block)
@@ -1644,6 +1651,11 @@ void codegen_flush()
         return;
 }
 
+/*Blocks are not chained on this host, they always return to the dispatcher*/
+void codegen_chain_link(codeblock_t *from, codeblock_t *to)
+{
+}
+
 static int opcode_modrm[256] =
 {
         1, 1, 1, 1,  0, 0, 0, 0,  1, 1, 1, 1,  0, 0, 0, 0,  /*00*/
@@ -8,14 +8,14 @@
  *
  *		CPU type handler.
  *
- * Version:	@(#)cpu.c	1.0.19	2021/11/02
+ * Version:	@(#)cpu.c	1.0.20	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		leilei,
  *		Miran Grca, <mgrca8@gmail.com>
  *
- *		Copyright 2018-2021 Fred N. van Kempen.
+ *		Copyright 2018-2026 Fred N. van Kempen.
  *		Copyright 2016-2020 Miran Grca.
  *		Copyright 2008-2020 Sarah Walker.
  *		Copyright 2016-2018 leilei.
@@ -48,8 +48,12 @@
 #include "../io.h"
 #include "x86.h"
 #include "x86_ops.h"
+#include "x87.h"
 #include "../mem.h"
 #include "../devices/system/pci.h"
+#include "../devices/system/clk.h"
+#include "../timer.h"
+#include "../state.h"
 #include "../plat.h"
 #ifdef USE_DYNAREC
 # include "codegen.h"
@@ -211,6 +215,8 @@ static int	cpu_turbo = -1,
 		cpu_waitstates,
 		cpu_extfpu;
 static uint32_t	cpu_speed;
+static uint64_t	cpu_run_cycles,			/* statistics */
+		cpu_idle_cycles;
 
 #if defined(DEV_BRANCH) && defined(USE_AMD_K)
 /* Variables for the AMD "K" processors. */
@@ -2476,6 +2482,154 @@ cpu_exec(int slice)
     } else {
 	execx86(cpu_speed/slice);
     }
+
+    cpu_run_cycles += (cpu_speed / slice);
+}
+
+
+/*
+ * The CPU is halted, waiting for an interrupt.
+ *
+ * Only a device can raise one, and devices only act from their
+ * timers or from guest I/O, so nothing can wake the CPU before
+ * the next timer deadline. Skip straight to it, rather than go
+ * around the halt loop a few cycles at a time, but never past
+ * the end of the current period, and never less than 'min'.
+ *
+ * Returns the number of cycles to consume.
+ */
+int
+cpu_idle(int min)
+{
+    tmrval_t left;
+    int c;
+
+    if (is286)
+	left = timer_idle_left((tmrval_t)cycles << TIMER_SHIFT) >> TIMER_SHIFT;
+      else
+	left = timer_idle_left((tmrval_t)cycles * cpu_clock_multi) / cpu_clock_multi;
+
+    c = (left < cycles) ? (int)left : cycles;
+    if (c < min)
+	c = min;
+
+    cpu_idle_cycles += c;
+
+    return(c);
+}
+
+
+/* Return the percentage of time spent halted since the last call. */
+int
+cpu_get_idle(void)
+{
+    int ret = 0;
+
+    if (cpu_run_cycles > 0)
+	ret = (int)((cpu_idle_cycles * 100) / cpu_run_cycles);
+    if (ret > 100)
+	ret = 100;
+
+    cpu_run_cycles = cpu_idle_cycles = 0;
+
+    return(ret);
+}
+
+
+/*
+ * Save or load the state of the processor.
+ *
+ * This is done in between time slices, so there is no
+ * instruction in progress, and we only need the visible
+ * (and model-specific) registers and the mode flags.
+ */
+void
+cpu_serialize(state_t *s)
+{
+    state_var(s, cpu_state);
+    state_var(s, CR0);
+    state_var(s, cr2);
+    state_var(s, cr3);
+    state_var(s, cr4);
+    state_var(s, dr);
+    state_var(s, gdt);
+    state_var(s, ldt);
+    state_var(s, idt);
+    state_var(s, tr);
+    state_var(s, cpu_cur_status);
+    state_var(s, use32);
+    state_var(s, stack32);
+    state_var(s, oldcpl);
+    state_var(s, cgate16);
+    state_var(s, cgate32);
+    state_var(s, cpu_cache_int_enabled);
+    state_var(s, cpu_cache_ext_enabled);
+
+    state_var(s, x87_pc_off);
+    state_var(s, x87_op_off);
+    state_var(s, x87_pc_seg);
+    state_var(s, x87_op_seg);
+
+    state_var(s, tsc);
+    state_var(s, msr);
+    state_var(s, cs_msr);
+    state_var(s, esp_msr);
+    state_var(s, eip_msr);
+    state_var(s, star);
+    state_var(s, apic_base_msr);
+    state_var(s, mtrr_cap_msr);
+    state_var(s, mtrr_physbase_msr);
+    state_var(s, mtrr_physmask_msr);
+    state_var(s, mtrr_fix64k_8000_msr);
+    state_var(s, mtrr_fix16k_8000_msr);
+    state_var(s, mtrr_fix16k_a000_msr);
+    state_var(s, mtrr_fix4k_msr);
+    state_var(s, pat_msr);
+    state_var(s, mtrr_deftype_msr);
+    state_var(s, msr_ia32_pmc);
+    state_var(s, ecx17_msr);
+    state_var(s, ecx79_msr);
+    state_var(s, ecx8x_msr);
+    state_var(s, ecx116_msr);
+    state_var(s, ecx11x_msr);
+    state_var(s, ecx11e_msr);
+    state_var(s, ecx186_msr);
+    state_var(s, ecx187_msr);
+    state_var(s, ecx1e0_msr);
+    state_var(s, ecx570_msr);
+#if defined(DEV_BRANCH) && defined(USE_AMD_K)
+    state_var(s, ecx83_msr);
+    state_var(s, sfmask);
+#endif
+
+    state_var(s, ccr0);
+    state_var(s, ccr1);
+    state_var(s, ccr2);
+    state_var(s, ccr3);
+    state_var(s, ccr4);
+    state_var(s, ccr5);
+    state_var(s, ccr6);
+    state_var(s, cyrix_addr);
+
+#ifdef USE_DYNAREC
+    state_var(s, codegen_flat_ds);
+    state_var(s, codegen_flat_ss);
+#endif
+
+    /* And the state local to the 808x core. */
+    x86_serialize(s);
+
+    if (state_saving(s)) return;
+
+    /* This pointer is only valid in our own address space. */
+    cpu_state.ea_seg = &cpu_state.seg_ds;
+
+    cpu_update_waitstates();
+    flushmmucache();
+#ifdef USE_DYNAREC
+    /* Any code we translated so far is stale now. */
+    codegen_reset();
+#endif
 }
 
 
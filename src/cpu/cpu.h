@@ -8,14 +8,14 @@
  *
  *		Definitions for the CPU module.
  *
- * Version:	@(#)cpu.h	1.0.19	2021/11/02
+ * Version:	@(#)cpu.h	1.0.20	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		leilei,
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2020 Miran Grca.
  *		Copyright 2008-2020 Sarah Walker.
  *		Copyright 2016-2018 leilei.
@@ -461,6 +461,8 @@ extern void	cpu_reset(int hard);
 extern void	cpu_dumpregs(int __force);
 
 extern void	cpu_exec(int slice);
+extern int	cpu_idle(int min);
+extern int	cpu_get_idle(void);
 
 extern void	cpu_CPUID(void);
 extern void	cpu_RDMSR(void);
@@ -8,7 +8,7 @@
  *
  *		Miscellaneous x86 CPU Instructions.
  *
- * Version:	@(#)x86_ops_misc.h	1.0.8	2020/12/15
+ * Version:	@(#)x86_ops_misc.h	1.0.9	2026/10/17
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -667,7 +667,7 @@ static int opHLT(uint32_t fetchdat)
         }
         if (!((cpu_state.flags&I_FLAG) && pic_pending))
         {
-                CLOCK_CYCLES_ALWAYS(100);
+                CLOCK_CYCLES_ALWAYS(cpu_idle(100));
                 cpu_state.pc--;
         }
         else
@@ -8,13 +8,13 @@
  *
  *		x86 CPU segment emulation.
  *
- * Version:	@(#)x86seg.c	1.0.13	2021/11/03
+ * Version:	@(#)x86seg.c	1.0.14	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <http://pcem-emulator.co.uk/>
  *
- *		Copyright 2018-2021 Fred N. van Kempen.
+ *		Copyright 2018-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -52,6 +52,9 @@
 #include "x86.h"
 #include "386.h"
 #include "386_common.h"
+#ifdef USE_DYNAREC
+# include "codegen.h"
+#endif
 
 
 /*Controls whether the accessed bit in a descriptor is set when CS is loaded.*/
@@ -230,6 +233,11 @@ static void set_stack32(int s)
 
 static void set_use32(int u)
 {
+#ifdef USE_DYNAREC
+    /* Every protected mode CS load comes here, and may change the CPL. */
+    codegen_chain_break = 1;
+#endif
+
     if (u) {
 	use32 = 0x300;
 	cpu_cur_status |= CPU_STATUS_USE32;
@@ -11,13 +11,13 @@
  *
  * **TODO**	Merge the various 'add' variants, its getting too messy.
  *
- * Version:	@(#)device.c	1.0.30	2021/03/16
+ * Version:	@(#)device.c	1.0.31	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2021 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -49,6 +49,7 @@
 #include "mem.h"
 #include "rom.h"
 #include "device.h"
+#include "state.h"
 #include "machines/machine.h"
 #include "devices/sound/sound.h"
 #include "devices/video/video.h"
@@ -536,6 +537,81 @@ device_force_redraw(void)
 }
 
 
+/* Count (and report) the devices that cannot save their state. */
+int
+device_state_missing(void)
+{
+    int c, n = 0;
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+	if ((devices[c] == NULL) || (devices[c]->serialize != NULL))
+		continue;
+
+	ERRLOG("STATE: device '%s' has no state hook\n", devices[c]->name);
+	n++;
+    }
+
+    return(n);
+}
+
+
+/*
+ * Save the names of all devices, or check that the saved ones
+ * are the ones we have, in the same order, so a state is never
+ * loaded into a different configuration.
+ */
+void
+device_state_match(state_t *s)
+{
+    uint32_t n = 0, saved;
+    int c;
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+	if (devices[c] != NULL)
+		n++;
+    }
+
+    saved = n;
+    state_var(s, saved);
+    if (! state_saving(s) && (saved != n)) {
+	ERRLOG("STATE: saved with %lu devices, not %lu\n",
+	       (unsigned long)saved, (unsigned long)n);
+	state_invalid(s, "state does not match this machine");
+	return;
+    }
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+	if (devices[c] == NULL) continue;
+
+	if (! state_match(s, devices[c]->name)) break;
+    }
+}
+
+
+/*
+ * Save or load the state of all devices.
+ *
+ * Each device gets its own chunk, which starts with the name of
+ * the device, so we only ever load state into the same device.
+ * A state is only saved if all devices have a hook, see above.
+ */
+void
+device_serialize(state_t *s)
+{
+    int c;
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+	if ((devices[c] == NULL) || (devices[c]->serialize == NULL))
+		continue;
+
+	if (! state_begin(s, "DEV ", 1)) break;
+	if (state_match(s, devices[c]->name))
+		devices[c]->serialize(device_priv[c], s);
+	state_end(s);
+    }
+}
+
+
 const char *
 device_get_config_string(const char *s)
 {
@@ -8,13 +8,13 @@
  *
  *		Definitions for the device handler.
  *
- * Version:	@(#)device.h	1.0.16	2021/03/16
+ * Version:	@(#)device.h	1.0.17	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -103,6 +103,8 @@ typedef struct {
     devcfg_spinner_t	spinner;
 } device_config_t;
 
+struct _state_;
+
 typedef struct _device_ {
     const char	*name;
     uint32_t	flags;			// system flags
@@ -123,6 +125,8 @@ typedef struct _device_ {
 #define mca_reslist	u2_reuse
 #define mach_info	u2_reuse
     const device_config_t *config;
+
+    void	(*serialize)(priv_t, struct _state_ *);	// save/load state
 } device_t;
 
 
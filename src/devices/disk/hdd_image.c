@@ -14,12 +14,12 @@
  *		merged with hdd.c, since that is the scope of hdd.c. The
  *		actual format handlers can then be in hdd_format.c etc.
  *
- * Version:	@(#)hdd_image.c	1.0.15	2021/03/18
+ * Version:	@(#)hdd_image.c	1.0.17	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -45,6 +45,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
@@ -67,6 +68,43 @@
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
 
+#define HDD_RA_SECTORS	128		/* sectors per read-ahead line */
+#define HDD_RA_LINES	8		/* read-ahead lines per disk */
+#define HDD_WB_SECTORS	256		/* max sectors per write extent */
+#define HDD_WB_EXTENTS	8		/* pending write extents per disk */
+
+
+typedef struct {
+    uint32_t	sector,			// first sector in line
+		count,			// valid sectors, 0 if unused
+		stamp;			// last use, for replacement
+    uint8_t	*data;
+} hdd_line_t;
+
+typedef struct {
+    uint32_t	sector,			// first sector to write
+		count;
+    uint8_t	*data;
+} hdd_extent_t;
+
+typedef struct {
+    mutex_t	*lock,			// protects lines and extents
+		*io_lock;		// protects the image file
+    int8_t	active;			// an image is using this cache
+    int8_t	wb_busy;		// oldest extent is being written
+
+    hdd_line_t	lines[HDD_RA_LINES];
+    uint32_t	stamp;
+    uint32_t	ra_sector;		// read-ahead request, or -1
+    uint8_t	*ra_buff;
+
+    hdd_extent_t wb[HDD_WB_EXTENTS];	// ring of pending writes
+    int		wb_head,		// oldest pending extent
+		wb_count;		// number of pending extents
+
+    uint32_t	hits,			// statistics
+		misses;
+} hdd_cache_t;
 
 typedef struct {
     FILE	*file;
@@ -78,6 +116,7 @@ typedef struct {
 #ifdef USE_MINIVHD
     MVHDMeta	*vhd;
 #endif
+    hdd_cache_t	*cache;			// must be last, see image_clear()
 } hdd_image_t;
 
 
@@ -87,6 +126,10 @@ int		hdd_image_do_log = ENABLE_HDD_LOG;
 hdd_image_t	hdd_images[HDD_NUM];
 
 
+static thread_t	*cache_tid = NULL;
+static event_t	*cache_wake_ev = NULL;
+
+
 void
 hdd_image_log(int level, const char *fmt, ...)
 {
@@ -222,6 +265,490 @@ prepare_new_hard_disk(hdd_image_t *img, uint64_t full_size)
 }
 
 
+/*
+ * Disk cache.
+ *
+ * Reads are served from a small set of read-ahead lines, which
+ * are (re)filled with one large read, and the worker thread
+ * reads the next line in the background once the guest starts
+ * reading sequentially. Writes go into a ring of pending write
+ * extents, where adjacent writes are coalesced, and the worker
+ * thread writes them back to the image in order.
+ *
+ * The cache lock protects the lines and the extent ring, and
+ * the I/O lock protects the file. If both are needed, the I/O
+ * lock is always taken first. Since all file access happens
+ * with the I/O lock held, and extents are only removed from
+ * the ring after they have been written, data read from the
+ * file is made current by applying the ring on top of it.
+ */
+static void
+cache_wake(void)
+{
+    thread_set_event(cache_wake_ev);
+}
+
+
+/* Read sectors from the file, with the I/O lock held. */
+static uint32_t
+cache_file_read(hdd_image_t *img, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    size_t n;
+
+    fseeko64(img->file, ((uint64_t)sector << 9LL) + img->base, SEEK_SET);
+    n = fread(buffer, 512, count, img->file);
+    clearerr(img->file);
+
+    return((uint32_t)n);
+}
+
+
+/* Write sectors to the file, with the I/O lock held. */
+static void
+cache_file_write(hdd_image_t *img, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    fseeko64(img->file, ((uint64_t)sector << 9LL) + img->base, SEEK_SET);
+    if (fwrite(buffer, 512, count, img->file) != count)
+	ERRLOG("HDD: write error on image, sector %u\n", sector);
+    clearerr(img->file);
+}
+
+
+/* Copy any overlap between two sector ranges. */
+static void
+cache_copy(uint32_t dsec, uint32_t dcnt, uint8_t *dst,
+	   uint32_t ssec, uint32_t scnt, const uint8_t *src)
+{
+    uint32_t start, end;
+
+    start = (dsec > ssec) ? dsec : ssec;
+    end = ((dsec + dcnt) < (ssec + scnt)) ? (dsec + dcnt) : (ssec + scnt);
+    if (start >= end)
+	return;
+
+    memcpy(dst + ((start - dsec) << 9), src + ((start - ssec) << 9),
+	   (end - start) << 9);
+}
+
+
+/* Apply all pending writes to a buffer, with the cache lock held. */
+static void
+cache_overlay(hdd_cache_t *c, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_extent_t *ext;
+    int i;
+
+    for (i = 0; i < c->wb_count; i++) {
+	ext = &c->wb[(c->wb_head + i) % HDD_WB_EXTENTS];
+	cache_copy(sector, count, buffer, ext->sector, ext->count, ext->data);
+    }
+}
+
+
+/* Find the line holding a range of sectors, with the cache lock held. */
+static hdd_line_t *
+cache_find(hdd_cache_t *c, uint32_t sector, uint32_t count)
+{
+    hdd_line_t *line;
+    int i;
+
+    for (i = 0; i < HDD_RA_LINES; i++) {
+	line = &c->lines[i];
+	if (line->count && (sector >= line->sector) &&
+	    ((sector + count) <= (line->sector + line->count)))
+		return(line);
+    }
+
+    return(NULL);
+}
+
+
+/* Get the least recently used line, with the cache lock held. */
+static hdd_line_t *
+cache_victim(hdd_cache_t *c)
+{
+    hdd_line_t *line = &c->lines[0];
+    int i;
+
+    for (i = 1; i < HDD_RA_LINES; i++) {
+	if (c->lines[i].stamp < line->stamp)
+		line = &c->lines[i];
+    }
+
+    return(line);
+}
+
+
+/* Read a line from the file, and install it, with the I/O lock held. */
+static hdd_line_t *
+cache_fill(hdd_image_t *img, hdd_cache_t *c, uint32_t sector)
+{
+    hdd_line_t *line;
+    uint32_t n;
+
+    n = cache_file_read(img, sector, HDD_RA_SECTORS, c->ra_buff);
+
+    thread_wait_mutex(c->lock);
+
+    /* Someone may have read it in the meantime. */
+    line = cache_find(c, sector, 1);
+    if ((line == NULL) || (line->sector != sector)) {
+	line = cache_victim(c);
+	memcpy(line->data, c->ra_buff, n << 9);
+	line->sector = sector;
+	line->count = n;
+	cache_overlay(c, line->sector, line->count, line->data);
+    }
+    line->stamp = ++c->stamp;
+
+    return(line);
+}
+
+
+/* Write back the oldest pending extent, called by the worker. */
+static int
+cache_writeback(hdd_image_t *img, hdd_cache_t *c)
+{
+    hdd_extent_t *ext;
+
+    thread_wait_mutex(c->io_lock);
+    thread_wait_mutex(c->lock);
+
+    if (!c->active || (c->wb_count == 0)) {
+	thread_release_mutex(c->lock);
+	thread_release_mutex(c->io_lock);
+	return(0);
+    }
+
+    /* Keep it in the ring while we write, but do not let it grow. */
+    ext = &c->wb[c->wb_head];
+    c->wb_busy = 1;
+    thread_release_mutex(c->lock);
+
+    cache_file_write(img, ext->sector, ext->count, ext->data);
+
+    thread_wait_mutex(c->lock);
+    c->wb_head = (c->wb_head + 1) % HDD_WB_EXTENTS;
+    c->wb_count--;
+    c->wb_busy = 0;
+    thread_release_mutex(c->lock);
+
+    thread_release_mutex(c->io_lock);
+
+    return(1);
+}
+
+
+/* Do a requested read-ahead, called by the worker. */
+static int
+cache_readahead(hdd_image_t *img, hdd_cache_t *c)
+{
+    uint32_t sector;
+
+    thread_wait_mutex(c->io_lock);
+    thread_wait_mutex(c->lock);
+    sector = c->ra_sector;
+    c->ra_sector = (uint32_t)-1;
+    if (!c->active || (sector == (uint32_t)-1) ||
+	(cache_find(c, sector, 1) != NULL)) {
+	thread_release_mutex(c->lock);
+	thread_release_mutex(c->io_lock);
+	return(0);
+    }
+    thread_release_mutex(c->lock);
+
+    (void)cache_fill(img, c, sector);
+
+    thread_release_mutex(c->lock);
+    thread_release_mutex(c->io_lock);
+
+    return(1);
+}
+
+
+/* Worker thread, handles read-ahead and write-back for all disks. */
+static void
+cache_thread(UNUSED(void *priv))
+{
+    hdd_image_t *img;
+    hdd_cache_t *c;
+    int i, busy;
+
+    for (;;) {
+	thread_wait_event(cache_wake_ev, -1);
+
+	do {
+		busy = 0;
+		for (i = 0; i < HDD_NUM; i++) {
+			img = &hdd_images[i];
+			c = img->cache;
+			if (c == NULL)
+				continue;
+
+			/* Reads first, the guest may be waiting for them. */
+			busy |= cache_readahead(img, c);
+			busy |= cache_writeback(img, c);
+		}
+	} while (busy);
+    }
+}
+
+
+/*
+ * Set up the cache for an image.
+ *
+ * The worker thread may look at the cache of any disk at any
+ * time, so once allocated, it stays around for that disk, and
+ * is only switched on and off as images come and go.
+ */
+static void
+cache_open(hdd_image_t *img)
+{
+    hdd_cache_t *c = img->cache;
+    int i;
+
+    if (cache_tid == NULL) {
+	cache_wake_ev = thread_create_event();
+	cache_tid = thread_create(cache_thread, NULL);
+    }
+
+    if (c == NULL) {
+	c = (hdd_cache_t *)mem_alloc(sizeof(hdd_cache_t));
+	memset(c, 0x00, sizeof(hdd_cache_t));
+	c->lock = thread_create_mutex(NULL);
+	c->io_lock = thread_create_mutex(NULL);
+	c->ra_buff = (uint8_t *)mem_alloc(HDD_RA_SECTORS << 9);
+	for (i = 0; i < HDD_RA_LINES; i++)
+		c->lines[i].data = (uint8_t *)mem_alloc(HDD_RA_SECTORS << 9);
+	for (i = 0; i < HDD_WB_EXTENTS; i++)
+		c->wb[i].data = (uint8_t *)mem_alloc(HDD_WB_SECTORS << 9);
+
+	/* The worker only looks at it once it is complete. */
+	img->cache = c;
+    }
+
+    thread_wait_mutex(c->io_lock);
+    thread_wait_mutex(c->lock);
+    for (i = 0; i < HDD_RA_LINES; i++)
+	c->lines[i].count = 0;
+    c->wb_head = c->wb_count = 0;
+    c->ra_sector = (uint32_t)-1;
+    c->hits = c->misses = 0;
+    c->active = 1;
+    thread_release_mutex(c->lock);
+    thread_release_mutex(c->io_lock);
+}
+
+
+/*
+ * Clear an image. The cache pointer is kept, and never cleared
+ * on the way, as the worker may be looking at it at any time.
+ */
+static void
+image_clear(hdd_image_t *img)
+{
+    memset(img, 0x00, offsetof(hdd_image_t, cache));
+}
+
+
+/* Write back all pending writes, with neither lock held. */
+static void
+cache_flush(hdd_image_t *img)
+{
+    hdd_cache_t *c = img->cache;
+    hdd_extent_t *ext;
+
+    if ((c == NULL) || !c->active)
+	return;
+
+    thread_wait_mutex(c->io_lock);
+    thread_wait_mutex(c->lock);
+
+    while (c->wb_count > 0) {
+	ext = &c->wb[c->wb_head];
+	cache_file_write(img, ext->sector, ext->count, ext->data);
+	c->wb_head = (c->wb_head + 1) % HDD_WB_EXTENTS;
+	c->wb_count--;
+    }
+    fflush(img->file);
+
+    thread_release_mutex(c->lock);
+    thread_release_mutex(c->io_lock);
+}
+
+
+/* Write back everything, and switch off the cache of an image. */
+static void
+cache_close(hdd_image_t *img)
+{
+    hdd_cache_t *c = img->cache;
+
+    if ((c == NULL) || !c->active)
+	return;
+
+    cache_flush(img);
+
+    /* Once we hold the I/O lock, the worker is done with it. */
+    thread_wait_mutex(c->io_lock);
+    c->active = 0;
+    thread_release_mutex(c->io_lock);
+
+    DEBUG("HDD: cache closed, %u hits, %u misses\n", c->hits, c->misses);
+}
+
+
+/* Drop any cached copies of a range of sectors. */
+static void
+cache_invalidate(hdd_cache_t *c, uint32_t sector, uint32_t count)
+{
+    hdd_line_t *line;
+    int i;
+
+    thread_wait_mutex(c->lock);
+    for (i = 0; i < HDD_RA_LINES; i++) {
+	line = &c->lines[i];
+	if (line->count && (sector < (line->sector + line->count)) &&
+	    ((sector + count) > line->sector))
+		line->count = 0;
+    }
+    thread_release_mutex(c->lock);
+}
+
+
+static void
+cache_read(hdd_image_t *img, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_cache_t *c = img->cache;
+    hdd_line_t *line;
+    uint32_t next;
+
+    thread_wait_mutex(c->lock);
+    line = cache_find(c, sector, count);
+    if (line == NULL) {
+	thread_release_mutex(c->lock);
+
+	thread_wait_mutex(c->io_lock);
+	if (count <= HDD_RA_SECTORS) {
+		/* Read a full line, starting here. */
+		line = cache_fill(img, c, sector);
+		if (line->count < count) {
+			memset(buffer, 0x00, count << 9);
+			count = line->count;
+		}
+	} else {
+		/* Too large to cache, read it directly. */
+		count = cache_file_read(img, sector, count, buffer);
+		thread_wait_mutex(c->lock);
+		cache_overlay(c, sector, count, buffer);
+		line = NULL;
+	}
+	thread_release_mutex(c->io_lock);
+	c->misses++;
+    } else
+	c->hits++;
+
+    if (line != NULL) {
+	memcpy(buffer, line->data + ((sector - line->sector) << 9), count << 9);
+	line->stamp = ++c->stamp;
+    }
+
+    /* If the guest reads sequentially, get the next line ready. */
+    next = (line != NULL) ? (line->sector + line->count) : (sector + count);
+    if ((sector + count + (HDD_RA_SECTORS / 2)) >= next &&
+	(count > 0) && (cache_find(c, next, 1) == NULL)) {
+	c->ra_sector = next;
+	cache_wake();
+    }
+
+    thread_release_mutex(c->lock);
+
+    img->pos = sector + count - 1;
+}
+
+
+static void
+cache_write(hdd_image_t *img, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_cache_t *c = img->cache;
+    hdd_extent_t *ext;
+    int i;
+
+    if (count > HDD_WB_SECTORS) {
+	/* Too large to queue, write it directly. */
+	cache_flush(img);
+	thread_wait_mutex(c->io_lock);
+	cache_file_write(img, sector, count, buffer);
+	thread_wait_mutex(c->lock);
+    } else {
+	thread_wait_mutex(c->lock);
+
+	/* Try to add it to the most recent extent. */
+	ext = NULL;
+	if (c->wb_count > 0 && !(c->wb_busy && c->wb_count == 1)) {
+		ext = &c->wb[(c->wb_head + c->wb_count - 1) % HDD_WB_EXTENTS];
+		if ((sector >= ext->sector) &&
+		    (sector <= (ext->sector + ext->count)) &&
+		    ((sector + count - ext->sector) <= HDD_WB_SECTORS)) {
+			memcpy(ext->data + ((sector - ext->sector) << 9),
+			       buffer, count << 9);
+			if ((sector + count) > (ext->sector + ext->count))
+				ext->count = sector + count - ext->sector;
+		} else
+			ext = NULL;
+	}
+
+	if (ext == NULL) {
+		if (c->wb_count == HDD_WB_EXTENTS) {
+			/* Ring is full, wait for the disk. */
+			thread_release_mutex(c->lock);
+			cache_flush(img);
+			thread_wait_mutex(c->lock);
+		}
+
+		ext = &c->wb[(c->wb_head + c->wb_count) % HDD_WB_EXTENTS];
+		ext->sector = sector;
+		ext->count = count;
+		memcpy(ext->data, buffer, count << 9);
+		c->wb_count++;
+	}
+    }
+
+    /* Keep the read-ahead lines current. */
+    for (i = 0; i < HDD_RA_LINES; i++) {
+	if (c->lines[i].count)
+		cache_copy(c->lines[i].sector, c->lines[i].count,
+			   c->lines[i].data, sector, count, buffer);
+    }
+
+    thread_release_mutex(c->lock);
+    if (count > HDD_WB_SECTORS)
+	thread_release_mutex(c->io_lock);
+    else
+	cache_wake();
+
+    img->pos = sector + count - 1;
+}
+
+
+/* Get exclusive access to the image file, for direct access. */
+static void
+image_lock(hdd_image_t *img)
+{
+    if ((img->cache != NULL) && img->cache->active) {
+	cache_flush(img);
+	thread_wait_mutex(img->cache->io_lock);
+    }
+}
+
+
+static void
+image_unlock(hdd_image_t *img)
+{
+    if ((img->cache != NULL) && img->cache->active)
+	thread_release_mutex(img->cache->io_lock);
+}
+
+
 void
 hdd_image_init(void)
 {
@@ -231,8 +758,11 @@ hdd_image_init(void)
     /* Load and initialize the DLL here. */
 #endif
 
-    for (i = 0; i < HDD_NUM; i++)
-	memset(&hdd_images[i], 0, sizeof(hdd_image_t));
+    for (i = 0; i < HDD_NUM; i++) {
+	/* The cache (and its worker) outlives the image. */
+	cache_close(&hdd_images[i]);
+	image_clear(&hdd_images[i]);
+    }
 }
 
 
@@ -264,6 +794,7 @@ hdd_image_load(int id)
 #endif
 
     if (img->loaded) {
+	cache_close(img);
 	if (img->file) {
 		(void)fclose(img->file);
 		img->file = NULL;
@@ -480,8 +1011,11 @@ hdd_image_seek(uint8_t id, uint32_t sector)
 
     img->pos = sector;
 
-    if (img->type != HDD_IMAGE_VHD)
+    if (img->type != HDD_IMAGE_VHD) {
+	image_lock(img);
 	fseeko64(img->file, addr + img->base, SEEK_SET);
+	image_unlock(img);
+    }
 }
 
 
@@ -489,7 +1023,6 @@ void
 hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     hdd_image_t *img = &hdd_images[id];
-    uint32_t i;
  
 #ifdef USE_MINIVHD
     if (img->type == HDD_IMAGE_VHD) {
@@ -499,36 +1032,20 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 
     if (img->type != HDD_IMAGE_VHD) {
 #endif
-	/* Move to the desired position in the image. */
-	fseeko64(img->file, ((uint64_t)sector << 9LL) + img->base, SEEK_SET);
-
-	/* Now read all (consecutive) blocks from the image. */
-	for (i = 0; i < count; i++) {
-		/* If past end of image, give up. */
-		if (ferror(img->file) || feof(img->file))
-			break;
+	if ((img->cache == NULL) || !img->cache->active)
+		cache_open(img);
 
-		/* Read a block. */
-		fread(buffer + (i << 9), 1, 512, img->file);
-
-		/* If error during read, give up. */
-		if (ferror(img->file))
-			break;
-
-		/* Update position. */
-		img->pos = sector + i;
-	}
+	cache_read(img, sector, count, buffer);
 #ifdef USE_MINIVHD
     }
 #endif
 }
 
 
-uint32_t
-hdd_sectors(uint8_t id)
+/* Size of the image in sectors, caller must own the file. */
+static uint32_t
+image_sectors(hdd_image_t *img)
 {
-    hdd_image_t *img = &hdd_images[id];
-
 #ifdef USE_MINIVHD
     if (img->type == HDD_IMAGE_VHD) {
 	return (uint32_t) (img->last_sector - 1);
@@ -543,13 +1060,31 @@ hdd_sectors(uint8_t id)
 }
 
 
+uint32_t
+hdd_sectors(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+    uint32_t sectors;
+
+    image_lock(img);
+    sectors = image_sectors(img);
+    image_unlock(img);
+
+    return sectors;
+}
+
+
 int
 hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     hdd_image_t *img = &hdd_images[id];
     uint32_t transfer_sectors = count;
-    uint32_t sectors = hdd_sectors(id);
-    
+    uint32_t sectors;
+    int err;
+
+    image_lock(img);
+
+    sectors = image_sectors(img);
     if ((sectors - sector) < transfer_sectors)
 	transfer_sectors = sectors - sector;
 
@@ -558,7 +1093,11 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     fseeko64(img->file, ((uint64_t)sector << 9LL) + img->base, SEEK_SET);
     fread(buffer, 1, transfer_sectors << 9, img->file);
 
-    if (ferror(img->file) || (count != transfer_sectors))
+    err = ferror(img->file);
+
+    image_unlock(img);
+
+    if (err || (count != transfer_sectors))
 	return 1;
 
     return 0;
@@ -571,30 +1110,16 @@ hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     hdd_image_t *img = &hdd_images[id];
 #ifdef USE_MINIVHD
     int remaining;
-#endif
-    uint32_t i;
 
-#ifdef USE_MINIVHD
     if (img->type == HDD_IMAGE_VHD) {
 	remaining = mvhd_write_sectors(img->vhd, sector, count, buffer);
 	img->pos = sector + count - remaining - 1;
     } else {
 #endif
-	/* Move to the desired position in the image. */
-	fseeko64(img->file, ((uint64_t)sector << 9LL) + img->base, SEEK_SET);
-
-	/* Now write all (consecutive) blocks to the image. */
-	for (i = 0; i < count; i++) {
-		/* Write a block. */
-		fwrite(buffer + (i << 9), 512, 1, img->file);
-
-		/* If error during write, give up. */
-		if (ferror(img->file))
-			break;
+	if ((img->cache == NULL) || !img->cache->active)
+		cache_open(img);
 
-		/* Update position. */
-		img->pos = sector + i;
-	}
+	cache_write(img, sector, count, buffer);
 #ifdef USE_MINIVHD		
     }
 #endif
@@ -644,6 +1169,8 @@ hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
 #endif
 	memset(empty, 0x00, sizeof(empty));
 
+	image_lock(img);
+
 	/* Move to the desired position in the image. */
 	fseeko64(img->file, ((uint64_t)sector << 9LL) + img->base, SEEK_SET);
 
@@ -659,6 +1186,11 @@ hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
 		/* Update position. */
 		img->pos = sector + i;
 	}
+
+	if (img->cache != NULL)
+		cache_invalidate(img->cache, sector, count);
+
+	image_unlock(img);
 #ifdef USE_MINIVHD
     }
 #endif
@@ -671,9 +1203,13 @@ hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
     hdd_image_t *img = &hdd_images[id];
     uint8_t empty[512];
     uint32_t transfer_sectors = count;
-    uint32_t sectors = hdd_sectors(id);
+    uint32_t sectors;
     uint32_t i = 0;
+    int err;
+
+    image_lock(img);
 
+    sectors = image_sectors(img);
     if ((sectors - sector) < transfer_sectors)
 	transfer_sectors = sectors - sector;
 
@@ -691,7 +1227,14 @@ hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
 		break;
     }
 
-    if (ferror(img->file) || (count != transfer_sectors))
+    err = ferror(img->file);
+
+    if (img->cache != NULL)
+	cache_invalidate(img->cache, sector, transfer_sectors);
+
+    image_unlock(img);
+
+    if (err || (count != transfer_sectors))
 	return 1;
 
     return 0;
@@ -728,10 +1271,14 @@ hdd_image_specify(uint8_t id, int hpc, int spt)
 	hdd[id].at_hpc = hpc;
 	hdd[id].at_spt = spt;
 
+	image_lock(img);
+
 	fseeko64(img->file, 0x20, SEEK_SET);
 
 	fwrite(&(hdd[id].at_spt), 1, 4, img->file);
 	fwrite(&(hdd[id].at_hpc), 1, 4, img->file);
+
+	image_unlock(img);
     }
 }
 
@@ -745,6 +1292,7 @@ hdd_image_unload(uint8_t id, int fn_preserve)
 	return;
 
     if (img->loaded) {
+	cache_close(img);
 	if (img->file != NULL) {
 		(void)fclose(img->file);
 		img->file = NULL;
@@ -776,6 +1324,8 @@ hdd_image_close(uint8_t id)
 
     if (! img->loaded) return;
 
+    cache_close(img);
+
     if (img->file != NULL) {
 	(void)fclose(img->file);
 	img->file = NULL;
@@ -786,7 +1336,8 @@ hdd_image_close(uint8_t id)
 #endif
     }
 
-    memset(img, 0x00, sizeof(hdd_image_t));
+    /* Keep the (now idle) cache for the next image. */
+    image_clear(img);
 
     img->loaded = 0;
 }
@@ -16,13 +16,13 @@
  *		 it either will not process ctrl-alt-esc, or it will not do
  *		 ANY input.
  *
- * Version:	@(#)keyboard_at.c	1.0.32	2021/03/16
+ * Version:	@(#)keyboard_at.c	1.0.33	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2021 Miran Grca.
  *		Copyright 2008-2021 Sarah Walker.
  *
@@ -44,6 +44,7 @@
  *   Boston, MA 02111-1307
  *   USA.
  */
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -56,6 +57,7 @@
 #include "../../mem.h"
 #include "../../timer.h"
 #include "../../device.h"
+#include "../../state.h"
 #include "../system/pic.h"
 #include "../system/pit.h"
 #include "../system/ppi.h"
@@ -3242,6 +3244,49 @@ kbd_close(priv_t priv)
 }
 
 
+/*
+ * Save or load the state of the controller.
+ *
+ * We also do the PPI port and the keyboard queues here, as the
+ * controller is the one that owns them.
+ */
+static void
+kbd_serialize(priv_t priv, state_t *s)
+{
+    atkbd_t *dev = (atkbd_t *)priv;
+
+    /* Everything up to the vendor hooks. */
+    state_data(s, dev, offsetof(atkbd_t, write60_ven));
+
+    state_var(s, ppi);
+    state_var(s, ppispeakon);
+    state_var(s, speaker_gated);
+    state_var(s, speaker_enable);
+    state_var(s, speaker_was_enable);
+
+    state_var(s, keyboard_mode);
+    state_var(s, keyboard_scan);
+    state_var(s, keyboard_delay);
+    state_var(s, keyboard_set3_flags);
+    state_var(s, keyboard_set3_all_repeat);
+    state_var(s, keyboard_set3_all_break);
+    state_var(s, key_ctrl_queue);
+    state_var(s, key_ctrl_queue_start);
+    state_var(s, key_ctrl_queue_end);
+    state_var(s, key_queue);
+    state_var(s, key_queue_start);
+    state_var(s, key_queue_end);
+    state_var(s, mouse_scan);
+    state_var(s, mouse_queue);
+    state_var(s, mouse_queue_start);
+    state_var(s, mouse_queue_end);
+    state_var(s, sc_or);
+
+    if (! state_saving(s))
+	set_scancode_map(dev);
+}
+
+
 static priv_t
 kbd_init(const device_t *info, UNUSED(void *parent))
 {
@@ -3312,7 +3357,8 @@ const device_t keyboard_at_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_at_ami_device = {
@@ -3322,7 +3368,8 @@ const device_t keyboard_at_ami_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_at_toshiba_device = {
@@ -3332,7 +3379,8 @@ const device_t keyboard_at_toshiba_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_device = {
@@ -3342,7 +3390,8 @@ const device_t keyboard_ps2_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_pci_device = {
@@ -3352,7 +3401,8 @@ const device_t keyboard_ps2_pci_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_ps1_device = {
@@ -3362,7 +3412,8 @@ const device_t keyboard_ps2_ps1_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_ps2_device = {
@@ -3372,7 +3423,8 @@ const device_t keyboard_ps2_ps2_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_acer_device = {
@@ -3386,7 +3438,8 @@ const device_t keyboard_ps2_acer_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_ami_device = {
@@ -3396,7 +3449,8 @@ const device_t keyboard_ps2_ami_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_ami_pci_device = {
@@ -3406,7 +3460,8 @@ const device_t keyboard_ps2_ami_pci_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_mca_device = {
@@ -3416,7 +3471,8 @@ const device_t keyboard_ps2_mca_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_mca_2_device = {
@@ -3426,7 +3482,8 @@ const device_t keyboard_ps2_mca_2_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_quadtel_device = {
@@ -3436,7 +3493,8 @@ const device_t keyboard_ps2_quadtel_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 const device_t keyboard_ps2_xi8088_device = {
@@ -3446,7 +3504,8 @@ const device_t keyboard_ps2_xi8088_device = {
     NULL,
     kbd_init, kbd_close, kbd_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    kbd_serialize
 };
 
 
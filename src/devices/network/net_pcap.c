@@ -8,11 +8,11 @@
  *
  *		Handle WinPcap library processing.
  *
- * Version:	@(#)net_pcap.c	1.0.13	2021/03/23
+ * Version:	@(#)net_pcap.c	1.0.14	2026/10/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -110,20 +110,13 @@ poll_thread(void *arg)
     struct pcap_pkthdr h;
     uint32_t mac_cmp32[2];
     uint16_t mac_cmp16[2];
-    event_t *evt;
 
     INFO("PCAP: thread started.\n");
     thread_set_event(poll_state);
 
-    /* Create a waitable event. */
-    evt = thread_create_event();
-
     /* As long as the channel is open.. */
     while (pcap != NULL) {
-	/* Request ownership of the device. */
-	network_wait(1);
-
-	/* Wait for a poll request. */
+	/* Send whatever the card has queued. */
 	network_poll();
 
 	if (pcap == NULL) break;
@@ -150,15 +143,9 @@ poll_thread(void *arg)
 
 	/* If we did not get anything, wait a while. */
 	if (data == NULL)
-		thread_wait_event(evt, 10);
-
-	/* Release ownership of the device. */
-	network_wait(0);
+		network_sleep(10);
     }
 
-    /* No longer needed. */
-    if (evt != NULL)
-	thread_destroy_event(evt);
     thread_set_event(poll_state);
 
     INFO("PCAP: thread stopped.\n");
@@ -245,7 +232,7 @@ do_close(void)
 
     /* Tell the thread to terminate. */
     if (poll_tid != NULL) {
-	network_busy(0);
+	network_wake();
 
 	/* Wait for the thread to finish. */
 	INFO("PCAP: waiting for thread to end...\n");
@@ -346,11 +333,7 @@ do_send(const uint8_t *bufp, int len)
 {
     if (pcap == NULL) return;
 
-    network_busy(1);
-
     PCAP_sendpacket((pcap_t *)pcap, (uint8_t *)bufp, len);
-
-    network_busy(0);
 }
 
 
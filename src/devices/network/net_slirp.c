@@ -8,11 +8,11 @@
  *
  *		Handle SLiRP library processing.
  *
- * Version:	@(#)net_slirp.c	1.0.9	2021/03/23
+ * Version:	@(#)net_slirp.c	1.0.10	2026/10/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -125,20 +125,13 @@ poll_thread(void *arg)
     uint32_t mac_cmp32[2];
     uint16_t mac_cmp16[2];
     const uint8_t *mac = (const uint8_t *)arg;
-    event_t *evt;
     int len;
 
     INFO("SLiRP: thread started.\n");
     thread_set_event(poll_state);
 
-    /* Create a waitable event. */
-    evt = thread_create_event();
-
     while (slirp != NULL) {
-	/* Request ownership of the device. */
-	network_wait(1);
-
-	/* Wait for a poll request. */
+	/* Send whatever the card has queued. */
 	network_poll();
 
 	/* See if there is any work. */
@@ -168,16 +161,10 @@ poll_thread(void *arg)
 		}
 	} else {
 		/* If we did not get anything, wait a while. */
-		thread_wait_event(evt, 10);
+		network_sleep(10);
 	}
-
-	/* Release ownership of the device. */
-	network_wait(0);
     }
 
-    /* No longer needed. */
-    if (evt != NULL)
-	thread_destroy_event(evt);
     thread_set_event(poll_state);
 
     INFO("SLiRP: thread stopped.\n");
@@ -286,7 +273,7 @@ do_close(void)
 
     /* Tell the thread to terminate. */
     if (poll_tid != NULL) {
-	network_busy(0);
+	network_wake();
 
 	/* Wait for the thread to finish. */
 	INFO("SLiRP: waiting for thread to end...\n");
@@ -326,13 +313,8 @@ do_available(void)
 static void
 do_send(const uint8_t *pkt, int pkt_len)
 {
-    if (slirp != NULL) {
-	network_busy(1);
-
+    if (slirp != NULL)
 	FUNC(send)(slirp, pkt, pkt_len);
-
-	network_busy(0);
-    }
 }
 
 
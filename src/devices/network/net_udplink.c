@@ -8,12 +8,12 @@
  *
  *		Implement an Ethernet-over-UDP link tunnel.
  *
- * Version:	@(#)net_udplink.c	1.0.1	2021/03/23
+ * Version:	@(#)net_udplink.c	1.0.2	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Bryan Biedenkapp, <gatekeep@gmail.com>
  *
- *		Copyright 2021 Fred N. van Kempen.
+ *		Copyright 2021-2026 Fred N. van Kempen.
  *		Copyright 2018 Bryan Biedenkapp.
  *
  *		Redistribution and  use  in source  and binary forms, with
@@ -115,24 +115,17 @@ poll_thread(UNUSED(void *arg))
 {
     uint8_t *pkt_buf;
     int pkt_len;
-    event_t *evt;
 
     INFO("UDPlink: polling started.\n");
     thread_set_event(poll_state);
 
-    /* Create a waitable event. */
-    evt = thread_create_event();
-
     /* Create a packet buffer. */
     pkt_buf = (uint8_t *)mem_alloc(RX_BUF_SIZE);
 
     /* As long as the channel is open.. */
     is_running = 1;
     while (is_running) {
-	/* Request ownership of the device. */
-	network_wait(1);
-
-	/* Wait for a poll request. */
+	/* Send whatever the card has queued. */
 	network_poll();
 
 	/* Wait for the next packet to arrive. */
@@ -144,19 +137,12 @@ poll_thread(UNUSED(void *arg))
 	} else {
 		/* If we did not get anything, wait a while. */
 		if (pkt_len == 0)
-			thread_wait_event(evt, 10);
+			network_sleep(10);
 	}
-
-	/* Release ownership of the device. */
-	network_wait(0);
     }
 
     free(pkt_buf);
 
-    /* No longer needed. */
-    if (evt != NULL)
-	thread_destroy_event(evt);
-
     INFO("UDPlink: polling stopped.\n");
     thread_set_event(poll_state);
 }
@@ -170,9 +156,8 @@ do_close(void)
 
     /* Tell the thread to terminate. */
     if (poll_tid != NULL) {
-	network_busy(0);
-
 	is_running = 0;
+	network_wake();
 
 	/* Wait for the thread to finish. */
         INFO("UDPlink: waiting for thread to end...\n");
@@ -223,7 +208,7 @@ do_reset(uint8_t *mac)
 
     /* Tell the thread to terminate. */
     if (poll_tid != NULL)
-	network_busy(0);
+	network_wake();
 
     /* Wait for the thread to finish. */
     INFO("UDPlink: waiting for thread to end...\n");
@@ -312,16 +297,10 @@ do_send(const uint8_t *bufp, int len)
 {
     char temp[128];
 
-    network_busy(1);
-
     if (FUNC(send)(bufp, len) <= 0) {
 	FUNC(error)(temp, sizeof(temp));
         ERRLOG("UDPlink: %s\n", temp);
-	network_busy(0);
-	return;
     }
-
-    network_busy(0);
 }
 
 
@@ -8,14 +8,22 @@
  *
  *		Implementation of the network module.
  *
+ *		Packets are passed between the emulator and the provider's
+ *		polling thread through two single-producer, single-consumer
+ *		rings of preallocated buffers, one for each direction, so
+ *		neither side ever has to wait for the other. The polling
+ *		thread sends everything queued by the card, and queues all
+ *		received frames, which are handed to the card from a timer
+ *		on the emulator thread.
+ *
  * FIXME:	We should move the "receiver thread" out of the providers,
  *		and into here, really.
  *
- * Version:	@(#)network.c	1.0.23	2021/03/23
+ * Version:	@(#)network.c	1.0.25	2026/10/17
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -57,6 +65,7 @@
 #define dbglog network_log
 #include "../../emu.h"
 #include "../../config.h"
+#include "../../timer.h"
 #include "../../device.h"
 #include "../../ui/ui.h"
 #include "../../plat.h"
@@ -65,21 +74,48 @@
 
 #define ENABLE_NETWORK_DUMP	1
 
+#define NET_QUEUE_LEN	64			// must be a power of 2
+#define NET_RX_TIME	(100LL * TIMER_USEC)	// how often to check for RX
+#define NET_RX_IDLE	(1000LL * TIMER_USEC)	// same, with no RX traffic
+
+/*
+ * The rings only have a single writer and a single reader, so
+ * all we need is to make sure the packet data is stored before
+ * the index that makes it visible. The x86 hosts we run on do
+ * not reorder stores, so stopping the compiler is enough.
+ */
+#ifdef _MSC_VER
+# define NET_BARRIER()	_ReadWriteBarrier()
+#else
+# define NET_BARRIER()	__asm__ __volatile__("" ::: "memory")
+#endif
+
+
+typedef struct {
+    int		len;
+    uint8_t	data[NET_MAX_FRAME];
+} netpkt_t;
+
+typedef struct {
+    volatile uint32_t head,			// next slot to fill (writer)
+		tail;				// next slot to empty (reader)
+    uint32_t	dropped;			// packets lost, queue full
+    netpkt_t	pkt[NET_QUEUE_LEN];
+} netqueue_t;
 
 typedef struct {
     int		network;			// current provider
-    mutex_t	*mutex;
 
     void	*priv;				// card priv data
     int		(*poll)(void *);		// card poll function
     NETRXCB	rx;				// card RX function
     uint8_t	*mac;				// card MAC address
 
-    volatile int poll_busy,			// polling thread data
-		queue_in_use;
-    event_t	*poll_wake,
-		*poll_complete,
-		*queue_not_in_use;
+    event_t	*poll_wake;			// polling thread has work
+    tmrevent_t	rx_timer;			// delivers queued RX packets
+
+    netqueue_t	txq,				// card -> provider
+		rxq;				// provider -> card
 } netdata_t;
 
 
@@ -177,40 +213,114 @@ network_log(int level, const char *fmt, ...)
 #endif
 
 
-void
-network_wait(int8_t do_wait)
+/* Add a packet to a queue. Only ever called by its writer. */
+static int
+queue_put(netqueue_t *q, const uint8_t *bufp, int len)
+{
+    netpkt_t *pkt;
+
+    if ((len <= 0) || (len > NET_MAX_FRAME) ||
+	((q->head - q->tail) == NET_QUEUE_LEN)) {
+	q->dropped++;
+	return(0);
+    }
+
+    pkt = &q->pkt[q->head & (NET_QUEUE_LEN - 1)];
+    memcpy(pkt->data, bufp, len);
+    pkt->len = len;
+
+    NET_BARRIER();
+    q->head++;
+
+    return(1);
+}
+
+
+/* Get the oldest packet from a queue. Only ever called by its reader. */
+static netpkt_t *
+queue_peek(netqueue_t *q)
+{
+    if (q->head == q->tail)
+	return(NULL);
+
+    NET_BARRIER();
+
+    return(&q->pkt[q->tail & (NET_QUEUE_LEN - 1)]);
+}
+
+
+/* Done with the packet we got from queue_peek. */
+static void
+queue_next(netqueue_t *q)
+{
+    NET_BARRIER();
+    q->tail++;
+}
+
+
+/*
+ * Hand all received packets to the card, on the emulator thread.
+ *
+ * While the queue stays empty, we check it less often; sending
+ * a packet speeds it up again, as a reply is likely to follow.
+ */
+static void
+rx_timer(UNUSED(priv_t priv))
 {
-    if (do_wait)
-	thread_wait_mutex(netdata.mutex);
-      else
-	thread_release_mutex(netdata.mutex);
+    netpkt_t *pkt;
+
+    if (netdata.rxq.head == netdata.rxq.tail) {
+	timer_event_delay(&netdata.rx_timer, NET_RX_IDLE);
+	return;
+    }
+
+    ui_sb_icon_update(SB_NETWORK, 1);
+
+    while ((pkt = queue_peek(&netdata.rxq)) != NULL) {
+	if (netdata.rx && netdata.priv)
+		netdata.rx(netdata.priv, pkt->data, pkt->len);
+	queue_next(&netdata.rxq);
+    }
+
+    ui_sb_icon_update(SB_NETWORK, 0);
+
+    timer_event_delay(&netdata.rx_timer, NET_RX_TIME);
 }
 
 
+/*
+ * Send all packets queued by the card.
+ *
+ * Called by the provider's polling thread, so the provider
+ * is never entered by two threads at the same time.
+ */
 void
 network_poll(void)
 {
-    while (netdata.poll_busy)
-	thread_wait_event(netdata.poll_wake, -1);
+    netpkt_t *pkt;
 
-    thread_reset_event(netdata.poll_wake);
+    while ((pkt = queue_peek(&netdata.txq)) != NULL) {
+	networks[netdata.network].net->send(pkt->data, pkt->len);
+	queue_next(&netdata.txq);
+    }
 }
 
 
+/* Wait (at most ms milliseconds) until there is something to send. */
 void
-network_busy(int8_t set)
+network_sleep(int ms)
 {
-    netdata.poll_busy = !!set;
-
-    if (! set)
-	thread_set_event(netdata.poll_wake);
+    if (netdata.poll_wake != NULL)
+	thread_wait_event(netdata.poll_wake, ms);
 }
 
 
+/* Wake up the polling thread. */
 void
-network_end(void)
+network_wake(void)
 {
-    thread_set_event(netdata.poll_complete);
+    if (netdata.poll_wake != NULL)
+	thread_set_event(netdata.poll_wake);
 }
 
 
@@ -229,6 +339,7 @@ network_init(void)
     /* Clear the local data. */
     memset(&netdata, 0x00, sizeof(netdata_t));
     netdata.network = NET_NONE;
+    timer_event_init(&netdata.rx_timer, rx_timer, NULL);
 
     /* Initialize to a known state. */
     config.network_type = NET_NONE;
@@ -268,6 +379,13 @@ network_attach(void *dev, uint8_t *mac, NETRXCB rx)
     if (config.network_card == NET_CARD_NONE)
 	return(1);
 
+    /* Start with empty queues. */
+    netdata.txq.head = netdata.txq.tail = netdata.txq.dropped = 0;
+    netdata.rxq.head = netdata.rxq.tail = netdata.rxq.dropped = 0;
+
+    /* The polling thread needs this as soon as it starts. */
+    netdata.poll_wake = thread_create_event();
+
     /* Reset the network provider module. */
     if (networks[netdata.network].net->reset(mac) < 0) {
 	/* Tell user we can't do this (at the moment.) */
@@ -284,9 +402,8 @@ network_attach(void *dev, uint8_t *mac, NETRXCB rx)
     netdata.rx = rx;
     netdata.mac = mac;
 
-    /* Create the network events. */
-    netdata.poll_wake = thread_create_event();
-    netdata.poll_complete = thread_create_event();
+    /* Start delivering received packets. */
+    timer_event_delay(&netdata.rx_timer, NET_RX_TIME);
 
     return(1);
 }
@@ -298,6 +415,15 @@ network_close(void)
 {
     /* If already closed, do nothing. */
     if (netdata.network == NET_NONE)
+	return;
+
+    timer_event_cancel(&netdata.rx_timer);
+    netdata.rx = NULL;
+    netdata.priv = NULL;
+
+    if (netdata.txq.dropped || netdata.rxq.dropped)
+	INFO("NETWORK: dropped %u TX, %u RX packets (queue full)\n",
+	     netdata.txq.dropped, netdata.rxq.dropped);
 
     /* Force-close the network provider module. */
     if (networks[netdata.network].net)
@@ -309,14 +435,6 @@ network_close(void)
 	thread_destroy_event(netdata.poll_wake);
 	netdata.poll_wake = NULL;
     }
-    if (netdata.poll_complete != NULL) {
-	thread_destroy_event(netdata.poll_complete);
-	netdata.poll_complete = NULL;
-    }
-
-    /* Close the network thread mutex. */
-    thread_close_mutex(netdata.mutex);
-    netdata.mutex = NULL;
 }
 
 
@@ -355,7 +473,6 @@ network_reset(void)
 	network_card_getname(config.network_card));
 
     netdata.network = config.network_type;
-    netdata.mutex = thread_create_mutex(L"VARCem.NetMutex");
 
     /* Add the selected card to the I/O system. */
     dev = network_card_getdevice(config.network_card);
@@ -380,18 +497,29 @@ network_tx(uint8_t *bufp, int len)
 }
 #endif
 
-    networks[netdata.network].net->send(bufp, len);
+    /* The polling thread will send it. */
+    if (queue_put(&netdata.txq, bufp, len)) {
+	network_wake();
+
+	/* Look for the reply soon, if we were idling. */
+	if ((netdata.rx != NULL) &&
+	    (netdata.rx_timer.when > (timer_now() + NET_RX_TIME)))
+		timer_event_delay(&netdata.rx_timer, NET_RX_TIME);
+    }
 
     ui_sb_icon_update(SB_NETWORK, 0);
 }
 
 
-/* Process a packet received from one of the network providers. */
+/*
+ * Queue a packet received from one of the network providers.
+ *
+ * This is called on the provider's polling thread, so it
+ * must not touch the card; the RX timer will deliver it.
+ */
 void
 network_rx(uint8_t *bufp, int len)
 {
-    ui_sb_icon_update(SB_NETWORK, 1);
-
 #if defined(WALTJE) && defined(_DEBUG) && ENABLE_NETWORK_DUMP
 {
     char temp[16384];
@@ -402,10 +530,7 @@ network_rx(uint8_t *bufp, int len)
 }
 #endif
 
-    if (netdata.rx && netdata.priv)
-	netdata.rx(netdata.priv, bufp, len);
-
-    ui_sb_icon_update(SB_NETWORK, 0);
+    (void)queue_put(&netdata.rxq, bufp, len);
 }
 
 
@@ -8,11 +8,11 @@
  *
  *		Definitions for the network module.
  *
- * Version:	@(#)network.h	1.0.10	2021/03/22
+ * Version:	@(#)network.h	1.0.11	2026/10/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -62,6 +62,9 @@ enum {
 };
 
 
+#define NET_MAX_FRAME	2048		// largest frame we will queue
+
+
 typedef void (*NETRXCB)(void *, uint8_t *bufp, int);
 
 /* Define a host interface entry for a network provider. */
@@ -111,10 +114,9 @@ extern int		network_attach(void *, uint8_t *, NETRXCB);
 extern void		network_tx(uint8_t *, int);
 extern void		network_rx(uint8_t *, int);
 
-extern void		network_wait(int8_t do_wait);
 extern void		network_poll(void);
-extern void		network_busy(int8_t set);
-extern void		network_end(void);
+extern void		network_sleep(int ms);
+extern void		network_wake(void);
 
 extern void		network_card_log(int level, const char *fmt, ...);
 extern int		network_card_to_id(const char *);
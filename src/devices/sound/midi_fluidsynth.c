@@ -17,7 +17,7 @@
  *		website (for 32bit and 64bit Windows) are working, and
  *		need no additional support files other than sound fonts.
  *
- * Version:	@(#)midi_fluidsynth.c	1.0.20	2021/03/16
+ * Version:	@(#)midi_fluidsynth.c	1.0.21	2026/10/17
  *
  *		Code borrowed from scummvm.
  *
@@ -25,7 +25,7 @@
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -189,7 +189,7 @@ fluidsynth_thread(void *param)
 			f_fluid_synth_write_float(data->synth, buf_size/(2 * sizeof(float)), buf, 0, 2, buf, 1, 2);
 		buf_pos += buf_size;
 		if (buf_pos >= data->buf_size) {
-			openal_buffer_midi(data->buffer, data->buf_size / sizeof(float));
+			sound_sink_write(SINK_MIDI, data->buffer, data->buf_size / sizeof(float));
 			buf_pos = 0;
 		}
 	} else {
@@ -199,7 +199,7 @@ fluidsynth_thread(void *param)
 			f_fluid_synth_write_s16(data->synth, buf_size/(2 * sizeof(int16_t)), buf, 0, 2, buf, 1, 2);
 		buf_pos += buf_size;
 		if (buf_pos >= data->buf_size) {
-			openal_buffer_midi(data->buffer_int16, data->buf_size / sizeof(int16_t));
+			sound_sink_write(SINK_MIDI, data->buffer_int16, data->buf_size / sizeof(int16_t));
 			buf_pos = 0;
 		}
 	}
@@ -338,7 +338,7 @@ fluidsynth_init(const device_t *info, UNUSED(void *parent))
 	data->buffer_int16 = (int16_t *)mem_alloc(data->buf_size);
     }
 
-    openal_set_midi(data->samplerate, data->buf_size);
+    sound_sink_set_midi(data->samplerate, data->buf_size);
 
     DEBUG("fluidsynth (%s) initialized, samplerate %d, buf_size %d\n",
 	  f_fluid_version_str(), data->samplerate, data->buf_size);
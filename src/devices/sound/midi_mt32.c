@@ -8,13 +8,13 @@
  *
  *		Interface to the MuNT32 MIDI synthesizer.
  *
- * Version:	@(#)midi_mt32.c	1.0.15	2021/03/16
+ * Version:	@(#)midi_mt32.c	1.0.16	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -233,7 +233,7 @@ mt32_thread(void *param)
 		mt32_stream(buf, bsize / (2 * sizeof(float)));
 		buf_pos += bsize;
 		if (buf_pos >= buf_size) {
-			openal_buffer_midi(buffer, buf_size / sizeof(float));
+			sound_sink_write(SINK_MIDI, buffer, buf_size / sizeof(float));
 			buf_pos = 0;
 		}
 	} else {
@@ -243,7 +243,7 @@ mt32_thread(void *param)
 		mt32_stream_int16(buf16, bsize / (2 * sizeof(int16_t)));
 		buf_pos += bsize;
 		if (buf_pos >= buf_size) {
-			openal_buffer_midi(buffer_int16, buf_size / sizeof(int16_t));
+			sound_sink_write(SINK_MIDI, buffer_int16, buf_size / sizeof(int16_t));
 			buf_pos = 0;
 		}
 	}
@@ -317,7 +317,7 @@ mt32emu_init(wchar_t *control_rom, wchar_t *pcm_rom)
     //DEBUG("mt32 reverb: %d\n", FUNC(is_reverb_enabled)(context));
     //DEBUG("mt32 reversed stereo: %d\n", FUNC(is_reversed_stereo_enabled)(context));
 
-    openal_set_midi(samplerate, buf_size);
+    sound_sink_set_midi(samplerate, buf_size);
 
     dev = (midi_device_t *)mem_alloc(sizeof(midi_device_t));
     memset(dev, 0, sizeof(midi_device_t));
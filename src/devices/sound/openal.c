@@ -8,13 +8,13 @@
  *
  *		Interface to the OpenAL sound processing library.
  *
- * Version:	@(#)openal.c	1.0.22	2021/03/19
+ * Version:	@(#)openal.c	1.0.23	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -380,8 +380,9 @@ openal_reset(void)
 }
 
 
-static void
-openal_buffer_common(void *buf, uint8_t src, int size, int freq)
+/* Queue a block of one stream; called from the mixer thread. */
+void
+openal_write(int src, const void *buf, int size, int freq)
 {
 #ifdef USE_OPENAL
     int processed;
@@ -416,30 +417,19 @@ openal_buffer_common(void *buf, uint8_t src, int size, int freq)
 }
 
 
-void
-openal_buffer(void *buf)
-{
-    openal_buffer_common(buf, 0, BUFLEN << 1, FREQ);
-}
-
-
-void
-openal_buffer_cd(void *buf)
-{
-    openal_buffer_common(buf, 1, CD_BUFLEN << 1, CD_FREQ);
-}
-
-
-void
-openal_buffer_midi(void *buf, uint32_t size)
-{
-    openal_buffer_common(buf, 2, size, midi_freq);
-}
-
-
 void
 openal_set_midi(int freq, int buf_size)
 {
     midi_freq = freq;
     midi_buf_size = buf_size;
 }
+
+
+const sound_sink_t openal_sink = {
+    "openal", "OpenAL",
+    0,
+    openal_init,
+    openal_close,
+    openal_reset,
+    openal_write
+};
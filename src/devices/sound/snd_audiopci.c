@@ -8,13 +8,13 @@
  *
  *		Implementation of the AudioPCI sound device.
  *
- * Version:	@(#)snd_audiopci.c	1.0.23	2021/03/16
+ * Version:	@(#)snd_audiopci.c	1.0.24	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -40,7 +40,6 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #define dbglog sound_card_log
 #include "../../emu.h"
 #include "../../timer.h"
@@ -54,14 +53,13 @@
 #include "midi.h"
 #include "snd_mpu401.h"
 #include "sound.h"
+#include "snd_fir.h"
 
 
 #define N 16
 
 #define ES1371_NCoef 91
 
-static float low_fir_es1371_coef[ES1371_NCoef];
-
 typedef struct {
 
     mpu_t mpu;
@@ -106,6 +104,7 @@ typedef struct {
 	int16_t buffer_l[64], buffer_r[64];
 	int buffer_pos, buffer_pos_end;
 
+	fir_t *fir;
 	int filtered_l[32], filtered_r[32];
 	int f_pos;
 
@@ -989,113 +988,60 @@ es1371_fetch(es1371_t *dev, int dac_nr)
 {
     int format = dac_nr ? ((dev->si_cr >> 2) & 3) : (dev->si_cr & 3);
     int pos = dev->dac[dac_nr].buffer_pos & 63;
-    int c;
+    uint8_t buf[32];
+    int16_t *l = dev->dac[dac_nr].buffer_l;
+    int16_t *r = dev->dac[dac_nr].buffer_r;
+    int c, n;
 
     DBGLOG(2, "Fetch format=%i %08x %08x  %08x %08x  %08x\n", format, dev->dac[dac_nr].count, dev->dac[dac_nr].size,  dev->dac[dac_nr].curr_samp_ct,dev->dac[dac_nr].samp_ct, dev->dac[dac_nr].addr);
 
+    /*
+     * Fetch up to 32 bytes (16 for stereo 16-bit) in one go, but
+     * stop at the end of the buffer, where we wrap to its start.
+     */
+    n = (format == FORMAT_STEREO_16) ? 4 : 8;
+    if (dev->dac[dac_nr].count > dev->dac[dac_nr].size)
+	n = 1;
+    else if (n > (dev->dac[dac_nr].size - dev->dac[dac_nr].count + 1))
+	n = dev->dac[dac_nr].size - dev->dac[dac_nr].count + 1;
+    mem_read_phys(buf, dev->dac[dac_nr].addr, n << 2);
+
     switch (format) {
 	case FORMAT_MONO_8:
-		for (c = 0; c < 32; c += 4) {
-			dev->dac[dac_nr].buffer_l[(pos+c)   & 63] = dev->dac[dac_nr].buffer_r[(pos+c)   & 63] = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
-			dev->dac[dac_nr].buffer_l[(pos+c+1) & 63] = dev->dac[dac_nr].buffer_r[(pos+c+1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr+1) ^ 0x80) << 8;
-			dev->dac[dac_nr].buffer_l[(pos+c+2) & 63] = dev->dac[dac_nr].buffer_r[(pos+c+2) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr+2) ^ 0x80) << 8;
-			dev->dac[dac_nr].buffer_l[(pos+c+3) & 63] = dev->dac[dac_nr].buffer_r[(pos+c+3) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr+3) ^ 0x80) << 8;
-			dev->dac[dac_nr].addr += 4;
-	
-			dev->dac[dac_nr].buffer_pos_end += 4;
-			dev->dac[dac_nr].count++;
-			if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-				dev->dac[dac_nr].count = 0;
-				dev->dac[dac_nr].addr = dev->dac[dac_nr].addr_latch;
-				break;
-			}
-		}
+		for (c = 0; c < (n << 2); c++)
+			l[(pos+c) & 63] = r[(pos+c) & 63] = (buf[c] ^ 0x80) << 8;
+		dev->dac[dac_nr].buffer_pos_end += (n << 2);
 		break;
 
 	case FORMAT_STEREO_8:
-		for (c = 0; c < 16; c += 2) {
-			dev->dac[dac_nr].buffer_l[(pos+c)   & 63] = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
-			dev->dac[dac_nr].buffer_r[(pos+c)   & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 1) ^ 0x80) << 8;
-			dev->dac[dac_nr].buffer_l[(pos+c+1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 2) ^ 0x80) << 8;
-			dev->dac[dac_nr].buffer_r[(pos+c+1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 3) ^ 0x80) << 8;
-			dev->dac[dac_nr].addr += 4;
-	
-			dev->dac[dac_nr].buffer_pos_end += 2;
-			dev->dac[dac_nr].count++;
-			if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-				dev->dac[dac_nr].count = 0;
-				dev->dac[dac_nr].addr = dev->dac[dac_nr].addr_latch;
-				break;
-			}
+		for (c = 0; c < (n << 1); c++) {
+			l[(pos+c) & 63] = (buf[(c << 1)] ^ 0x80) << 8;
+			r[(pos+c) & 63] = (buf[(c << 1) + 1] ^ 0x80) << 8;
 		}
+		dev->dac[dac_nr].buffer_pos_end += (n << 1);
 		break;
 
 	case FORMAT_MONO_16:
-		for (c = 0; c < 16; c += 2) {
-			dev->dac[dac_nr].buffer_l[(pos+c)   & 63] = dev->dac[dac_nr].buffer_r[(pos+c)   & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
-			dev->dac[dac_nr].buffer_l[(pos+c+1) & 63] = dev->dac[dac_nr].buffer_r[(pos+c+1) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
-			dev->dac[dac_nr].addr += 4;
-
-			dev->dac[dac_nr].buffer_pos_end += 2;
-			dev->dac[dac_nr].count++;
-			if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-				dev->dac[dac_nr].count = 0;
-				dev->dac[dac_nr].addr = dev->dac[dac_nr].addr_latch;
-				break;
-			}
-		}
+		for (c = 0; c < (n << 1); c++)
+			l[(pos+c) & 63] = r[(pos+c) & 63] = buf[(c << 1)] | (buf[(c << 1) + 1] << 8);
+		dev->dac[dac_nr].buffer_pos_end += (n << 1);
 		break;
 
 	case FORMAT_STEREO_16:
-		for (c = 0; c < 4; c++) {
-			dev->dac[dac_nr].buffer_l[(pos+c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
-			dev->dac[dac_nr].buffer_r[(pos+c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
-//			DBGLOG(1, "Fetch %02x %08x  %04x %04x\n", (pos+c) & 63, dev->dac[dac_nr].addr, dev->dac[dac_nr].buffer_l[(pos+c) & 63], dev->dac[dac_nr].buffer_r[(pos+c) & 63]);
-			dev->dac[dac_nr].addr += 4;
-	
-			dev->dac[dac_nr].buffer_pos_end++;
-			dev->dac[dac_nr].count++;
-			if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-				dev->dac[dac_nr].count = 0;
-				dev->dac[dac_nr].addr = dev->dac[dac_nr].addr_latch;
-				break;
-			}
+		for (c = 0; c < n; c++) {
+			l[(pos+c) & 63] = buf[(c << 2)] | (buf[(c << 2) + 1] << 8);
+			r[(pos+c) & 63] = buf[(c << 2) + 2] | (buf[(c << 2) + 3] << 8);
 		}
+		dev->dac[dac_nr].buffer_pos_end += n;
 		break;
     }
-}
-
-
-static __inline float
-low_fir_es1371(int dac_nr, int i, float NewSample)
-{
-    static float x[2][2][128]; //input samples
-    static int x_pos[2] = {0, 0};
-    float out = 0.0;
-    int read_pos;
-    int n_coef;
-    int pos = x_pos[dac_nr];
-
-    x[dac_nr][i][pos] = NewSample;
-
-    /*Since only 1/16th of input samples are non-zero, only filter those that
-      are valid.*/
-    read_pos = (pos + 15) & (127 & ~15);
-    n_coef = (16 - pos) & 15;
-
-    while (n_coef < ES1371_NCoef) {
-	out += low_fir_es1371_coef[n_coef] * x[dac_nr][i][read_pos];
-	read_pos = (read_pos + 16) & (127 & ~15);
-	n_coef += 16;
-    }
 
-    if (i == 1) {
-       	x_pos[dac_nr] = (x_pos[dac_nr] + 1) & 127;
-       	if (x_pos[dac_nr] > 127)
-       		x_pos[dac_nr] = 0;
+    dev->dac[dac_nr].addr += (n << 2);
+    dev->dac[dac_nr].count += n;
+    if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
+	dev->dac[dac_nr].count = 0;
+	dev->dac[dac_nr].addr = dev->dac[dac_nr].addr_latch;
     }
-
-    return out;
 }
 
 
@@ -1103,7 +1049,6 @@ static void
 es1371_next_sample_filtered(es1371_t *dev, int dac_nr, int out_idx)
 {
     int out_l, out_r;
-    int c;
         
     if ((dev->dac[dac_nr].buffer_pos - dev->dac[dac_nr].buffer_pos_end) >= 0) {
 	es1371_fetch(dev, dac_nr);
@@ -1112,12 +1057,10 @@ es1371_next_sample_filtered(es1371_t *dev, int dac_nr, int out_idx)
     out_l = dev->dac[dac_nr].buffer_l[dev->dac[dac_nr].buffer_pos & 63];
     out_r = dev->dac[dac_nr].buffer_r[dev->dac[dac_nr].buffer_pos & 63];
         
-    dev->dac[dac_nr].filtered_l[out_idx] = (int)low_fir_es1371(dac_nr, 0, (float)out_l);
-    dev->dac[dac_nr].filtered_r[out_idx] = (int)low_fir_es1371(dac_nr, 1, (float)out_r);
-    for (c = 1; c < 16; c++) {
-	dev->dac[dac_nr].filtered_l[out_idx+c] = (int)low_fir_es1371(dac_nr, 0, 0);
-	dev->dac[dac_nr].filtered_r[out_idx+c] = (int)low_fir_es1371(dac_nr, 1, 0);
-    }
+    /*Upsample by N, into the next half of the filtered buffer*/
+    fir_interp(dev->dac[dac_nr].fir, out_l, out_r,
+	       &dev->dac[dac_nr].filtered_l[out_idx],
+	       &dev->dac[dac_nr].filtered_r[out_idx]);
         
 //  DBGLOG(1, "Use %02x %04x %04x\n", dev->dac[dac_nr].buffer_pos & 63, dev->dac[dac_nr].out_l, dev->dac[dac_nr].out_r);
 	
@@ -1253,57 +1196,15 @@ static void
 es1371_get_buffer(int32_t *buffer, int len, priv_t priv)
 {
     es1371_t *dev = (es1371_t *)priv;
-    int c;
 
     es1371_update(dev);
 
-    for (c = 0; c < len * 2; c++)
-	buffer[c] += (dev->buffer[c] / 2);
+    snd_mix_block_half(buffer, dev->buffer, len);
 	
     dev->pos = 0;
 }
 
 
-static __inline
-double sinc(double x)
-{
-    return sin(M_PI * x) / (M_PI * x);
-}
-
-
-static void
-generate_es1371_filter(void)
-{
-    /*Cutoff frequency = 1 / 32*/
-    float fC = 1.0 / 32.0;
-    float gain;
-    int n;
-
-    for (n = 0; n < ES1371_NCoef; n++) {
-	/*Blackman window*/
-	double w = 0.42 - (0.5 * cos((2.0*n*M_PI)/(double)(ES1371_NCoef-1))) + (0.08 * cos((4.0*n*M_PI)/(double)(ES1371_NCoef-1)));
-
-	/*Sinc filter*/
-	double h = sinc(2.0 * fC * ((double)n - ((double)(ES1371_NCoef-1) / 2.0)));
-
-	/*Create windowed-sinc filter*/
-	low_fir_es1371_coef[n] = (float)(w * h);
-    }
-
-    low_fir_es1371_coef[(ES1371_NCoef - 1) / 2] = 1.0;
-
-    gain = 0.0;
-    for (n = 0; n < ES1371_NCoef; n++)
-	gain += low_fir_es1371_coef[n] / (float)N;
-
-    gain /= (float)0.95;
-
-    /*Normalise filter, to produce unity gain*/
-    for (n = 0; n < ES1371_NCoef; n++)
-	low_fir_es1371_coef[n] /= gain;
-}        
-
-
 static uint8_t
 es1371_pci_read(int func, int addr, priv_t priv)
 {
@@ -1458,7 +1359,9 @@ es1371_init(const device_t *info, UNUSED(void *parent))
 
     timer_add(es1371_poll, dev, &dev->dac[1].time, TIMER_ALWAYS_ENABLED);
 
-    generate_es1371_filter();
+    /*Cutoff frequency = 1 / 32, and unity gain after upsampling by N*/
+    dev->dac[0].fir = fir_create(ES1371_NCoef, N, 1.0 / 32.0, (float)N * (float)0.95);
+    dev->dac[1].fir = fir_create(ES1371_NCoef, N, 1.0 / 32.0, (float)N * (float)0.95);
 		
     return (priv_t)dev;
 }
@@ -1468,6 +1371,9 @@ static void
 es1371_close(priv_t priv)
 {
     es1371_t *dev = (es1371_t *)priv;
+
+    fir_close(dev->dac[0].fir);
+    fir_close(dev->dac[1].fir);
 	
     free(dev);
 }
@@ -8,13 +8,13 @@
  *
  *		Define the various audio filters.
  *
- * Version:	@(#)snd_filters.h	1.0.1	2020/07/14
+ * Version:	@(#)snd_filters.h	1.0.2	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2020 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -401,34 +401,4 @@ dac_iir(int i, float NewSample)
 }
 
 
-#define SB16_NCoef 51
-
-extern float low_fir_sb16_coef[SB16_NCoef];
-
-static inline float
-low_fir_sb16(int i, float NewSample)
-{
-    static float x[2][SB16_NCoef+1];		//input samples
-    static int pos = 0;
-    float out = 0.0;
-    int n;
-
-    /* Calculate the new output. */
-    x[i][pos] = NewSample;
-
-    for (n = 0; n < ((SB16_NCoef+1)-pos) && n < SB16_NCoef; n++)
-	out += low_fir_sb16_coef[n] * x[i][n+pos];
-    for (; n < SB16_NCoef; n++)
-	out += low_fir_sb16_coef[n] * x[i][(n+pos) - (SB16_NCoef+1)];
-
-    if (i == 1) {
-	pos++;
-	if (pos > SB16_NCoef)
-		pos = 0;
-    }
-
-    return(out);
-}
-
-
 #endif	/*SOUND_FILTERS*/
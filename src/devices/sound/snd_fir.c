@@ -0,0 +1,434 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Shared FIR filter and polyphase resampler.
+ *
+ *		Several of the sound cards run their DAC output through
+ *		a windowed-sinc low-pass filter, either as a plain FIR
+ *		(SB16) or as an interpolator which upsamples by a fixed
+ *		factor (ES1371.) Each of them used to have its own copy
+ *		of the filter design code, and a per-sample convolution
+ *		with its history in static variables.
+ *
+ *		The filter taps are kept in banks, one set of taps for
+ *		each phase, which are cached by their parameters, so a
+ *		change of playback rate only designs a new filter once.
+ *		The history is kept twice in a row, so every window is
+ *		contiguous and the inner product runs four taps at a
+ *		time, using SSE where the host has it.
+ *
+ * Version:	@(#)snd_fir.c	1.0.1	2026/10/17
+ *
+ * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *		Sarah Walker, <tommowalker@tommowalker.co.uk>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *		Copyright 2008-2018 Sarah Walker.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../../emu.h"
+#include "sound.h"
+#include "snd_fir.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+# define USE_SSE2
+# include <emmintrin.h>
+#endif
+
+
+#define FIR_CACHE_MAX	16		// unused banks kept around
+
+
+struct fir_bank {
+    struct fir_bank *next;
+    int		refs;
+
+    /* Design parameters, used as the cache key. */
+    int		ntaps,
+		phases;
+    double	cutoff,
+		gain;
+
+    int		taps;			// taps per phase, padded
+    float	*coef;			// [phases][taps]
+};
+
+
+static fir_bank_t	*banks;
+static int		banks_unused;
+
+
+static double
+sinc(double x)
+{
+    return sin(M_PI * x) / (M_PI * x);
+}
+
+
+/*
+ * Design a windowed-sinc low-pass filter of ntaps taps, with the
+ * cutoff given as a fraction of the (upsampled) rate, normalized
+ * to the given DC gain, and split it into phases sub-filters.
+ */
+static void
+bank_design(fir_bank_t *bank)
+{
+    double w, h, sum;
+    float *proto;
+    int n, p, q;
+
+    proto = (float *)mem_alloc(bank->ntaps * sizeof(float));
+
+    for (n = 0; n < bank->ntaps; n++) {
+	/*Blackman window*/
+	w = 0.42 - (0.5 * cos((2.0*n*M_PI)/(double)(bank->ntaps-1))) + (0.08 * cos((4.0*n*M_PI)/(double)(bank->ntaps-1)));
+
+	/*Sinc filter*/
+	h = sinc(2.0 * bank->cutoff * ((double)n - ((double)(bank->ntaps-1) / 2.0)));
+
+	/*Create windowed-sinc filter*/
+	proto[n] = (float)(w * h);
+    }
+
+    proto[(bank->ntaps - 1) / 2] = 1.0;
+
+    sum = 0.0;
+    for (n = 0; n < bank->ntaps; n++)
+	sum += proto[n];
+
+    /*Normalise filter, to produce the requested gain*/
+    for (n = 0; n < bank->ntaps; n++)
+	proto[n] = (float)(proto[n] * bank->gain / sum);
+
+    /* Phase p uses taps p, p+phases, p+2*phases, ... */
+    bank->taps = (bank->ntaps + bank->phases - 1) / bank->phases;
+    bank->taps = (bank->taps + 3) & ~3;
+    bank->coef = (float *)mem_alloc(bank->phases * bank->taps * sizeof(float));
+    memset(bank->coef, 0x00, bank->phases * bank->taps * sizeof(float));
+
+    for (p = 0; p < bank->phases; p++) {
+	for (q = 0; (q * bank->phases + p) < bank->ntaps; q++)
+		bank->coef[p * bank->taps + q] = proto[q * bank->phases + p];
+    }
+
+    free(proto);
+}
+
+
+static const fir_bank_t *
+bank_get(int ntaps, int phases, double cutoff, double gain)
+{
+    fir_bank_t *bank, **prev;
+
+    for (prev = &banks; (bank = *prev) != NULL; prev = &bank->next) {
+	if (bank->ntaps == ntaps && bank->phases == phases &&
+	    bank->cutoff == cutoff && bank->gain == gain) {
+		/* Move it to the head, so the list stays in LRU order. */
+		*prev = bank->next;
+		bank->next = banks;
+		banks = bank;
+
+		if (bank->refs++ == 0)
+			banks_unused--;
+		return(bank);
+	}
+    }
+
+    bank = (fir_bank_t *)mem_alloc(sizeof(fir_bank_t));
+    memset(bank, 0x00, sizeof(fir_bank_t));
+    bank->ntaps = ntaps;
+    bank->phases = phases;
+    bank->cutoff = cutoff;
+    bank->gain = gain;
+    bank_design(bank);
+
+    bank->refs = 1;
+    bank->next = banks;
+    banks = bank;
+
+    return(bank);
+}
+
+
+/* Drop a reference, and trim the cache if it has grown too big. */
+static void
+bank_put(const fir_bank_t *ptr)
+{
+    fir_bank_t *bank, **prev, **victim;
+
+    if (ptr == NULL)
+	return;
+
+    bank = (fir_bank_t *)ptr;
+    if (--bank->refs == 0)
+	banks_unused++;
+
+    /* Free the least recently used unreferenced banks. */
+    while (banks_unused > FIR_CACHE_MAX) {
+	victim = NULL;
+	for (prev = &banks; *prev != NULL; prev = &(*prev)->next) {
+		if ((*prev)->refs == 0)
+			victim = prev;
+	}
+
+	bank = *victim;
+	*victim = bank->next;
+	free(bank->coef);
+	free(bank);
+	banks_unused--;
+    }
+}
+
+
+static __inline float
+fir_dot(const float *coef, const float *x, int taps)
+{
+#ifdef USE_SSE2
+    __m128 acc = _mm_setzero_ps();
+    float out[4];
+    int n;
+
+    for (n = 0; n < taps; n += 4)
+	acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&coef[n]),
+					 _mm_loadu_ps(&x[n])));
+
+    _mm_storeu_ps(out, acc);
+
+    return((out[0] + out[1]) + (out[2] + out[3]));
+#else
+    float acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+    int n;
+
+    for (n = 0; n < taps; n += 4) {
+	acc[0] += coef[n] * x[n];
+	acc[1] += coef[n + 1] * x[n + 1];
+	acc[2] += coef[n + 2] * x[n + 2];
+	acc[3] += coef[n + 3] * x[n + 3];
+    }
+
+    return((acc[0] + acc[1]) + (acc[2] + acc[3]));
+#endif
+}
+
+
+/* Add one stereo sample to the history; it ends up at hist[pos]. */
+static __inline void
+fir_push(fir_t *fir, float l, float r)
+{
+    if (--fir->pos < 0)
+	fir->pos = fir->taps - 1;
+
+    fir->hist[0][fir->pos] = fir->hist[0][fir->pos + fir->taps] = l;
+    fir->hist[1][fir->pos] = fir->hist[1][fir->pos + fir->taps] = r;
+}
+
+
+/*
+ * Create a stereo filter. For a plain FIR, phases is 1 and the
+ * cutoff is relative to the sample rate; for an interpolator it
+ * is the upsampling factor, and the cutoff is relative to the
+ * upsampled rate.
+ */
+fir_t *
+fir_create(int ntaps, int phases, double cutoff, double gain)
+{
+    fir_t *fir;
+
+    fir = (fir_t *)mem_alloc(sizeof(fir_t));
+    memset(fir, 0x00, sizeof(fir_t));
+    fir->ntaps = ntaps;
+    fir->phases = phases;
+
+    fir->bank = bank_get(ntaps, phases, cutoff, gain);
+    fir->taps = fir->bank->taps;
+    if (fir->taps > FIR_MAX_TAPS)
+	fatal("FIR: %i taps per phase, max is %i\n", fir->taps, FIR_MAX_TAPS);
+
+    return(fir);
+}
+
+
+void
+fir_close(fir_t *fir)
+{
+    if (fir == NULL)
+	return;
+
+    bank_put(fir->bank);
+
+    free(fir);
+}
+
+
+void
+fir_reset(fir_t *fir)
+{
+    memset(fir->hist, 0x00, sizeof(fir->hist));
+    fir->pos = 0;
+}
+
+
+/* Switch to another cutoff, keeping the history. */
+void
+fir_set_cutoff(fir_t *fir, double cutoff, double gain)
+{
+    const fir_bank_t *old = fir->bank;
+
+    fir->bank = bank_get(fir->ntaps, fir->phases, cutoff, gain);
+
+    bank_put(old);
+}
+
+
+/* Filter a block of interleaved stereo samples. */
+void
+fir_filter_block(fir_t *fir, const int16_t *in, float *out, int len)
+{
+    const float *coef = fir->bank->coef;
+    int taps = fir->taps;
+
+    while (len--) {
+	fir_push(fir, (float)in[0], (float)in[1]);
+
+	out[0] = fir_dot(coef, &fir->hist[0][fir->pos], taps);
+	out[1] = fir_dot(coef, &fir->hist[1][fir->pos], taps);
+
+	in += 2;
+	out += 2;
+    }
+}
+
+
+/*
+ * Upsample one stereo sample by the number of phases. This is the
+ * same as filtering the input with (phases - 1) zeroes stuffed in
+ * after every sample, without doing the work for the zeroes.
+ */
+void
+fir_interp(fir_t *fir, int16_t l, int16_t r, int *out_l, int *out_r)
+{
+    const float *coef = fir->bank->coef;
+    int taps = fir->taps;
+    int p;
+
+    fir_push(fir, (float)l, (float)r);
+
+    for (p = 0; p < fir->phases; p++) {
+	out_l[p] = (int)fir_dot(coef, &fir->hist[0][fir->pos], taps);
+	out_r[p] = (int)fir_dot(coef, &fir->hist[1][fir->pos], taps);
+	coef += taps;
+    }
+}
+
+
+/* Mix a block of interleaved samples into the output. */
+void
+snd_mix_block(int32_t *dst, const int32_t *src, int len)
+{
+    int c = 0;
+
+#ifdef USE_SSE2
+    for (; c <= (len * 2) - 4; c += 4)
+	_mm_storeu_si128((__m128i *)&dst[c],
+			 _mm_add_epi32(_mm_loadu_si128((__m128i *)&dst[c]),
+				       _mm_loadu_si128((__m128i *)&src[c])));
+#endif
+
+    for (; c < len * 2; c++)
+	dst[c] += src[c];
+}
+
+
+/* Mix a block of interleaved 16-bit samples at half volume. */
+void
+snd_mix_block_half(int32_t *dst, const int16_t *src, int len)
+{
+    int c = 0;
+
+#ifdef USE_SSE2
+    __m128i v;
+
+    for (; c <= (len * 2) - 8; c += 8) {
+	/* Halve, rounding towards zero like a division does. */
+	v = _mm_loadu_si128((__m128i *)&src[c]);
+	v = _mm_srai_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 15)), 1);
+
+	_mm_storeu_si128((__m128i *)&dst[c],
+			 _mm_add_epi32(_mm_loadu_si128((__m128i *)&dst[c]),
+				       _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)));
+	_mm_storeu_si128((__m128i *)&dst[c + 4],
+			 _mm_add_epi32(_mm_loadu_si128((__m128i *)&dst[c + 4]),
+				       _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)));
+    }
+#endif
+
+    for (; c < len * 2; c++)
+	dst[c] += src[c] / 2;
+}
+
+
+/* Mix a block of separate left and right samples into the output. */
+void
+snd_mix_block16(int32_t *dst, const int16_t *l, const int16_t *r, int len)
+{
+    int c = 0;
+
+#ifdef USE_SSE2
+    __m128i lo, hi, v;
+
+    for (; c <= len - 8; c += 8) {
+	/* Interleave, then sign-extend to 32 bits. */
+	v = _mm_loadu_si128((__m128i *)&l[c]);
+	hi = _mm_loadu_si128((__m128i *)&r[c]);
+	lo = _mm_unpacklo_epi16(v, hi);
+	hi = _mm_unpackhi_epi16(v, hi);
+
+	v = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+	_mm_storeu_si128((__m128i *)&dst[c * 2],
+			 _mm_add_epi32(_mm_loadu_si128((__m128i *)&dst[c * 2]), v));
+	v = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+	_mm_storeu_si128((__m128i *)&dst[c * 2 + 4],
+			 _mm_add_epi32(_mm_loadu_si128((__m128i *)&dst[c * 2 + 4]), v));
+	v = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+	_mm_storeu_si128((__m128i *)&dst[c * 2 + 8],
+			 _mm_add_epi32(_mm_loadu_si128((__m128i *)&dst[c * 2 + 8]), v));
+	v = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+	_mm_storeu_si128((__m128i *)&dst[c * 2 + 12],
+			 _mm_add_epi32(_mm_loadu_si128((__m128i *)&dst[c * 2 + 12]), v));
+    }
+#endif
+
+    for (; c < len; c++) {
+	dst[c * 2] += l[c];
+	dst[c * 2 + 1] += r[c];
+    }
+}
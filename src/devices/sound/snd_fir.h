@@ -0,0 +1,81 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the shared FIR filter and resampler.
+ *
+ * Version:	@(#)snd_fir.h	1.0.1	2026/10/17
+ *
+ * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *		Sarah Walker, <tommowalker@tommowalker.co.uk>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *		Copyright 2008-2018 Sarah Walker.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#ifndef SOUND_FIR_H
+# define SOUND_FIR_H
+
+
+#define FIR_MAX_TAPS	128		// max taps per phase
+
+
+typedef struct fir_bank fir_bank_t;
+
+typedef struct fir {
+    const fir_bank_t *bank;
+    int		ntaps,			// prototype length
+		phases,			// 1 for a plain FIR
+		taps,			// taps per phase, padded
+		pos;
+
+    /* Two copies of the history, so a window is always contiguous. */
+    float	hist[2][FIR_MAX_TAPS * 2];
+} fir_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern fir_t	*fir_create(int ntaps, int phases, double cutoff, double gain);
+extern void	fir_close(fir_t *);
+extern void	fir_reset(fir_t *);
+extern void	fir_set_cutoff(fir_t *, double cutoff, double gain);
+
+extern void	fir_filter_block(fir_t *, const int16_t *in, float *out, int len);
+extern void	fir_interp(fir_t *, int16_t l, int16_t r, int *out_l, int *out_r);
+
+extern void	snd_mix_block(int32_t *dst, const int32_t *src, int len);
+extern void	snd_mix_block_half(int32_t *dst, const int16_t *src, int len);
+extern void	snd_mix_block16(int32_t *dst, const int16_t *l,
+				const int16_t *r, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/*SOUND_FIR_H*/
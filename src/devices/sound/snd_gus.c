@@ -8,13 +8,13 @@
  *
  *		Implementation of the Gravis UltraSound sound device.
  *
- * Version:	@(#)snd_gus.c	1.0.19	2021/06/05
+ * Version:	@(#)snd_gus.c	1.0.20	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2021 Sarah Walker.
  *
@@ -51,12 +51,16 @@
 #include "../system/nmi.h"
 #include "../system/pic.h"
 #include "sound.h"
+#include "snd_fir.h"
 #if defined(DEV_BRANCH) && defined(USE_GUSMAX)
 #include "snd_cs423x.h"
 #include <math.h>
 #endif
 
 
+#define GUS_DMA_BLOCK	512		/* DMA units moved per block */
+
+
 enum {
     MIDI_INT_RECEIVE = 0x01,
     MIDI_INT_TRANSMIT = 0x02,
@@ -263,6 +267,95 @@ midi_update_int_status(gus_t *dev)
 }
 
 
+/* Move a DMA block from GUS RAM to system memory. */
+static void
+gus_dma_to_mem(gus_t *dev, uint8_t ctrl)
+{
+    uint8_t buf[GUS_DMA_BLOCK * 2];
+    int width = dma[dev->dma].size ? 2 : 1;
+    uint32_t addr, gus_addr;
+    int c, i, n, ret;
+    uint16_t d;
+
+    for (c = 0; c < 65536; c += n) {
+	n = 65536 - c;
+	if (n > GUS_DMA_BLOCK)
+		n = GUS_DMA_BLOCK;
+
+	for (i = 0; i < n; i++) {
+		addr = (dev->dmaaddr + i) & 0xfffff;
+		if (ctrl & 0x04) {
+			gus_addr = (addr & 0xc0000) | ((addr & 0x1ffff) << 1);
+			d = dev->ram[gus_addr] | (dev->ram[gus_addr + 1] << 8);
+			if (ctrl & 0x80)
+				d ^= 0x8080;
+		} else {
+			d = dev->ram[addr];
+			if (ctrl & 0x80)
+				d ^= 0x80;
+		}
+		buf[i * width] = d & 0xff;
+		if (width == 2)
+			buf[(i * 2) + 1] = d >> 8;
+	}
+
+	ret = dma_channel_write_block(dev->dma, buf, n * width);
+	if (ret == DMA_NODATA)
+		break;
+
+	n = (ret & ~DMA_OVER) / width;
+	dev->dmaaddr = (dev->dmaaddr + n) & 0xfffff;
+	if (ret & DMA_OVER)
+		break;
+    }
+}
+
+
+/* Move a DMA block from system memory to GUS RAM. */
+static void
+gus_dma_from_mem(gus_t *dev, uint8_t ctrl)
+{
+    uint8_t buf[GUS_DMA_BLOCK * 2];
+    int width = dma[dev->dma].size ? 2 : 1;
+    uint32_t gus_addr;
+    int c, i, n, ret;
+    uint16_t d;
+
+    for (c = 0; c < 65536; c += n) {
+	n = 65536 - c;
+	if (n > GUS_DMA_BLOCK)
+		n = GUS_DMA_BLOCK;
+
+	ret = dma_channel_read_block(dev->dma, buf, n * width);
+	if (ret == DMA_NODATA)
+		break;
+
+	n = (ret & ~DMA_OVER) / width;
+	for (i = 0; i < n; i++) {
+		d = buf[i * width];
+		if (width == 2)
+			d |= (buf[(i * 2) + 1] << 8);
+
+		if (ctrl & 0x04) {
+			gus_addr = (dev->dmaaddr & 0xc0000) | ((dev->dmaaddr & 0x1ffff) << 1);
+			if (ctrl & 0x80)
+				d ^= 0x8080;
+			dev->ram[gus_addr] = d & 0xff;
+			dev->ram[gus_addr + 1] = (d >> 8) & 0xff;
+		} else {
+			if (ctrl & 0x80)
+				d ^= 0x80;
+			dev->ram[dev->dmaaddr] = d & 0xff;
+		}
+		dev->dmaaddr = (dev->dmaaddr + 1) & 0xfffff;
+	}
+
+	if (ret & DMA_OVER)
+		break;
+    }
+}
+
+
 static void
 gus_write(uint16_t addr, uint8_t val, priv_t priv)
 {
@@ -270,7 +363,7 @@ gus_write(uint16_t addr, uint8_t val, priv_t priv)
 #if defined(DEV_BRANCH) && defined(USE_GUSMAX)
     uint16_t csioport;
 #endif
-    int c, d, old;
+    int old;
     uint16_t port;
 
 	if ((addr == 0x388) || (addr == 0x389))
@@ -457,61 +550,12 @@ gus_write(uint16_t addr, uint8_t val, priv_t priv)
 
 			case 0x41: /*DMA*/
 				if (val & 1 && dev->dma != -1) {
-					if (val & 2) {
-						c = 0;
-						while (c < 65536) {
-							int dma_result;
-	
-							if (val & 0x04) {
-								uint32_t gus_addr = (dev->dmaaddr & 0xc0000) | ((dev->dmaaddr & 0x1ffff) << 1);
-								d = dev->ram[gus_addr] | (dev->ram[gus_addr + 1] << 8);
-								if (val & 0x80)
-									d ^= 0x8080;
-								dma_result = dma_channel_write(dev->dma, d);
-								if (dma_result == DMA_NODATA)
-									break;
-							} else {
-								d = dev->ram[dev->dmaaddr];
-								if (val & 0x80)
-									d ^= 0x80;
-								dma_result = dma_channel_write(dev->dma, d);
-								if (dma_result == DMA_NODATA)
-									break;
-							}
-							dev->dmaaddr++;
-							dev->dmaaddr &= 0xFFFFF;
-							c++;
-							if (dma_result & DMA_OVER)
-								break;
-						}
-						dev->dmactrl = val & ~0x40;
-						dev->irqnext = 1;
-					} else {
-						c = 0;
-						while (c < 65536) {
-							d = dma_channel_read(dev->dma);
-							if (d == DMA_NODATA)
-								break;
-							if (val & 0x04) {
-								uint32_t gus_addr = (dev->dmaaddr & 0xc0000) | ((dev->dmaaddr & 0x1ffff) << 1);
-								if (val & 0x80)
-									d ^= 0x8080;
-								dev->ram[gus_addr] = d & 0xff;
-								dev->ram[gus_addr + 1] = (d >> 8) & 0xff;
-							} else {
-								if (val & 0x80)
-									d ^= 0x80;
-								dev->ram[dev->dmaaddr] = d;
-							}
-							dev->dmaaddr++;
-							dev->dmaaddr &= 0xFFFFF;
-							c++;
-							if (d & DMA_OVER)
-								break;
-						}
-						dev->dmactrl = val & ~0x40;
-						dev->irqnext = 1;
-					}
+					if (val & 2)
+						gus_dma_to_mem(dev, val);
+					  else
+						gus_dma_from_mem(dev, val);
+					dev->dmactrl = val & ~0x40;
+					dev->irqnext = 1;
 				}
 				break;
 
@@ -1162,7 +1206,6 @@ static void
 get_buffer(int32_t *buffer, int len, priv_t priv)
 {
     gus_t *dev = (gus_t *)priv;
-    int c;
 
 #if defined(DEV_BRANCH) && defined(USE_GUSMAX)  
     if (dev->max_ctrl)
@@ -1170,13 +1213,11 @@ get_buffer(int32_t *buffer, int len, priv_t priv)
 #endif	
     gus_update(dev);
 
-    for (c = 0; c < len * 2; c++) {
 #if defined(DEV_BRANCH) && defined(USE_GUSMAX)    
-	if (dev->max_ctrl)
-		buffer[c] += (int32_t)(dev->cs423x.buffer[c] / 2);
+    if (dev->max_ctrl)
+	snd_mix_block_half(buffer, dev->cs423x.buffer, len);
 #endif		
-	buffer[c] += (int32_t)dev->buffer[c & 1][c >> 1];
-    }
+    snd_mix_block16(buffer, dev->buffer[0], dev->buffer[1], len);
 
 #if defined(DEV_BRANCH) && defined(USE_GUSMAX)    
     if (dev->max_ctrl)
@@ -27,14 +27,14 @@
  *		in that order. The OPL2, however, is mono. What should
  *		we generate for that?
  *
- * Version:	@(#)snd_opl_nuked.c	1.0.6	2021/03/19
+ * Version:	@(#)snd_opl_nuked.c	1.0.8	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Alexey Khokholov (Nuke.YKT)
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2020 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *		Copyright 2013-2018 Alexey Khokholov (Nuke.YKT)
@@ -57,11 +57,14 @@
  *   Boston, MA 02111-1307
  *   USA.
  */
+#include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "../../emu.h"
 #include "../../timer.h"
+#include "../../plat.h"
+#include "../../misc/random.h"
 #include "sound.h"
 #include "snd_opl_nuked.h"
 
@@ -69,6 +72,9 @@
 #define WRBUF_SIZE	1024
 #define WRBUF_DELAY	1
 #define RSM_FRAC	10
+#define NUKED_BLOCK	256		// native samples per batch
+#define BENCH_FRAMES	500		// 10 seconds of output
+#define BENCH_WRITES	8		// register writes per frame
 
 
 // Channel types
@@ -182,6 +188,7 @@ typedef struct chip {
     int32_t	samplecnt;
     int32_t	oldsamples[2];
     int32_t	samples[2];
+    int32_t	block[NUKED_BLOCK * 2];	// batched native samples
 
     uint64_t	wrbuf_samplecnt;
     uint32_t	wrbuf_cur;
@@ -756,7 +763,7 @@ slot_write_e0(slot_t *slot, uint8_t data)
 }
 
 
-static void
+static __inline void
 slot_generate(slot_t *slot)
 {
     slot->out = env_sin[slot->reg_wf](slot->pg_phase_out + *slot->mod,
@@ -764,7 +771,7 @@ slot_generate(slot_t *slot)
 }
 
 
-static void
+static __inline void
 slot_calc_fb(slot_t *slot)
 {
     if (slot->chan->fb != 0x00)
@@ -776,6 +783,20 @@ slot_calc_fb(slot_t *slot)
 }
 
 
+/* Run one full slot step for a range of slots, in hardware order. */
+static __inline void
+slot_run(slot_t *slot, int num)
+{
+    while (num--) {
+	slot_calc_fb(slot);
+	env_calc(slot);
+	phase_generate(slot);
+	slot_generate(slot);
+	slot++;
+    }
+}
+
+
 static void
 channel_setup_alg(chan_t *ch)
 {
@@ -1214,10 +1235,208 @@ nuked_write_reg_buffered(priv_t priv, uint16_t reg, uint8_t val)
 }
 
 
+/* Mix all 18 channels into one output, masked by the per-channel enable. */
+static __inline int32_t
+chip_mix(nuked_t *dev, int right)
+{
+    const chan_t *ch = dev->chan;
+    int32_t mix = 0;
+    int16_t accm;
+    int i;
+
+    for (i = 0; i < 18; i++, ch++) {
+	accm = *ch->out[0] + *ch->out[1] + *ch->out[2] + *ch->out[3];
+
+	mix += (int16_t)(accm & (right ? ch->chb : ch->cha));
+    }
+
+    return(mix);
+}
+
+
+/*
+ * Generate one native (49716 Hz) sample.
+ *
+ * The slots cannot be run side-by-side: within a sample each one
+ * depends on the previous ones (modulator outputs, feedback, the
+ * rhythm bits and the noise generator), and the two mixes sample
+ * the chip state at fixed points in the slot sequence. We keep that
+ * exact order here, and make the per-sample work cheap instead.
+ */
+static __inline void
+chip_generate(nuked_t *dev, int32_t *bufp)
+{
+    int16_t shift = 0;
+
+    bufp[1] = dev->mixbuff[1];
+
+    slot_run(&dev->slot[0], 15);
+
+    dev->mixbuff[0] = chip_mix(dev, 0);
+
+    slot_run(&dev->slot[15], 3);
+
+    bufp[0] = dev->mixbuff[0];
+
+    slot_run(&dev->slot[18], 15);
+
+    dev->mixbuff[1] = chip_mix(dev, 1);
+
+    slot_run(&dev->slot[33], 3);
+
+    if ((dev->timer & 0x3f) == 0x3f)
+	dev->tremolopos = (dev->tremolopos + 1) % 210;
+
+    if (dev->tremolopos < 105)
+	dev->tremolo = dev->tremolopos >> dev->tremoloshift;
+    else
+	dev->tremolo = (210 - dev->tremolopos) >> dev->tremoloshift;
+
+    if ((dev->timer & 0x03ff) == 0x03ff)
+	dev->vibpos = (dev->vibpos + 1) & 7;
+
+    dev->timer++;
+    dev->eg_add = 0;
+
+    if (dev->eg_timer) {
+	while (shift < 36 && ((dev->eg_timer >> shift) & 1) == 0)
+	    shift++;
+
+	if (shift > 12)
+	    dev->eg_add = 0;
+	else
+	    dev->eg_add = shift + 1;
+    }
+
+    if (dev->eg_timerrem || dev->eg_state) {
+	if (dev->eg_timer == 0xfffffffff) {
+	    dev->eg_timer = 0;
+	    dev->eg_timerrem = 1;
+	} else {
+	    dev->eg_timer++;
+	    dev->eg_timerrem = 0;
+	}
+    }
+
+    dev->eg_state ^= 1;
+
+    while (dev->wrbuf[dev->wrbuf_cur].time <= (tmrval_t)dev->wrbuf_samplecnt) {
+	if (! (dev->wrbuf[dev->wrbuf_cur].reg & 0x200))
+	    break;
+
+	dev->wrbuf[dev->wrbuf_cur].reg &= 0x01ff;
+
+	nuked_write_reg(dev, dev->wrbuf[dev->wrbuf_cur].reg,
+		        dev->wrbuf[dev->wrbuf_cur].data);
+
+	dev->wrbuf_cur = (dev->wrbuf_cur + 1) % WRBUF_SIZE;
+    }
+
+    dev->wrbuf_samplecnt++;
+}
+
+
 void
 nuked_generate(priv_t priv, int32_t *bufp)
+{
+    chip_generate((nuked_t *)priv, bufp);
+}
+
+
+/* Generate a batch of native samples (interleaved L/R) into a buffer. */
+void
+nuked_generate_block(priv_t priv, int32_t *bufp, uint32_t num)
 {
     nuked_t *dev = (nuked_t *)priv;
+
+    while (num--) {
+	chip_generate(dev, bufp);
+	bufp += 2;
+    }
+}
+
+
+void
+nuked_generate_resampled(priv_t priv, int32_t *bufp)
+{
+    nuked_t *dev = (nuked_t *)priv;
+
+    while (dev->samplecnt >= dev->rateratio) {
+	dev->oldsamples[0] = dev->samples[0];
+	dev->oldsamples[1] = dev->samples[1];
+	nuked_generate(dev, dev->samples);
+	dev->samplecnt -= dev->rateratio;
+    }
+
+    bufp[0] = (int32_t)((dev->oldsamples[0] * (dev->rateratio - dev->samplecnt)
+		     + dev->samples[0] * dev->samplecnt) / dev->rateratio);
+    bufp[1] = (int32_t)((dev->oldsamples[1] * (dev->rateratio - dev->samplecnt)
+		     + dev->samples[1] * dev->samplecnt) / dev->rateratio);
+
+    dev->samplecnt += 1 << RSM_FRAC;
+}
+
+
+void
+nuked_generate_stream(priv_t priv, int32_t *sndptr, uint32_t num)
+{
+    nuked_t *dev = (nuked_t *)priv;
+    const int32_t *src = dev->block;
+    uint32_t avail = 0, need = 0;
+    int32_t cnt = dev->samplecnt;
+    uint32_t i;
+
+    /*
+     * Work out how many native samples this block consumes, so we
+     * can generate exactly those in batches. Generating any more
+     * would shift the timing of buffered register writes.
+     */
+    for (i = 0; i < num; i++) {
+	while (cnt >= dev->rateratio) {
+		cnt -= dev->rateratio;
+		need++;
+	}
+	cnt += 1 << RSM_FRAC;
+    }
+
+    for (i = 0; i < num; i++) {
+	while (dev->samplecnt >= dev->rateratio) {
+		if (avail == 0) {
+			avail = (need > NUKED_BLOCK) ? NUKED_BLOCK : need;
+			nuked_generate_block(dev, dev->block, avail);
+			need -= avail;
+			src = dev->block;
+		}
+
+		dev->oldsamples[0] = dev->samples[0];
+		dev->oldsamples[1] = dev->samples[1];
+		dev->samples[0] = src[0];
+		dev->samples[1] = src[1];
+		src += 2;
+		avail--;
+
+		dev->samplecnt -= dev->rateratio;
+	}
+
+	sndptr[0] = (int32_t)((dev->oldsamples[0] * (dev->rateratio - dev->samplecnt)
+			     + dev->samples[0] * dev->samplecnt) / dev->rateratio);
+	sndptr[1] = (int32_t)((dev->oldsamples[1] * (dev->rateratio - dev->samplecnt)
+			     + dev->samples[1] * dev->samplecnt) / dev->rateratio);
+	sndptr += 2;
+
+	dev->samplecnt += 1 << RSM_FRAC;
+    }
+}
+
+
+/*
+ * The original one-sample-at-a-time generator and resampler, kept
+ * as they were so nuked_bench() can check the batched generator
+ * against them.
+ */
+static void
+ref_generate(nuked_t *dev, int32_t *bufp)
+{
     int16_t accm, shift = 0;
     uint8_t i, j;
 
@@ -1326,15 +1545,14 @@ nuked_generate(priv_t priv, int32_t *bufp)
 }
 
 
-void
-nuked_generate_resampled(priv_t priv, int32_t *bufp)
+static void
+ref_generate_resampled(nuked_t *dev, int32_t *bufp)
 {
-    nuked_t *dev = (nuked_t *)priv;
 
     while (dev->samplecnt >= dev->rateratio) {
 	dev->oldsamples[0] = dev->samples[0];
 	dev->oldsamples[1] = dev->samples[1];
-	nuked_generate(dev, dev->samples);
+	ref_generate(dev, dev->samples);
 	dev->samplecnt -= dev->rateratio;
     }
 
@@ -1347,16 +1565,81 @@ nuked_generate_resampled(priv_t priv, int32_t *bufp)
 }
 
 
+/*
+ * Check and time the batched generator.
+ *
+ * Two chips get the same random register writes, one frame at a
+ * time. One of them generates its output one sample at a time with
+ * the original generator, the other one does it in batches with
+ * nuked_generate_stream(), and both outputs have to be identical.
+ */
 void
-nuked_generate_stream(priv_t priv, int32_t *sndptr, uint32_t num)
+nuked_bench(void)
 {
-    nuked_t *dev = (nuked_t *)priv;
-    uint32_t i;
+    int32_t *ref, *out;
+    uint64_t ticks[2], start;
+    priv_t chip[2];
+    uint16_t reg;
+    uint8_t val;
+    int f, i, bad = 0;
+
+    ref = (int32_t *)mem_alloc(SOUNDBUFLEN * 2 * sizeof(int32_t));
+    out = (int32_t *)mem_alloc(SOUNDBUFLEN * 2 * sizeof(int32_t));
+    chip[0] = nuked_init(48000);
+    chip[1] = nuked_init(48000);
+    ticks[0] = ticks[1] = 0;
+
+    /* Enable OPL3 mode and all the waveforms. */
+    for (i = 0; i < 2; i++) {
+	nuked_write_reg(chip[i], 0x105, 0x01);
+	nuked_write_reg(chip[i], 0x001, 0x20);
+    }
 
-    for (i = 0; i < num; i++) {
-	nuked_generate_resampled(dev, sndptr);
-	sndptr += 2;
+    for (f = 0; f < BENCH_FRAMES; f++) {
+	for (i = 0; i < BENCH_WRITES; i++) {
+		reg = random_generate() | ((random_generate() & 1) << 8);
+		val = random_generate();
+
+		/* Leave the chip in OPL3 mode. */
+		if (reg == 0x105)
+			val |= 0x01;
+
+		nuked_write_reg_buffered(chip[0], reg, val);
+		nuked_write_reg_buffered(chip[1], reg, val);
+	}
+
+	start = plat_timer_read();
+	for (i = 0; i < SOUNDBUFLEN; i++)
+		ref_generate_resampled((nuked_t *)chip[0], &ref[i * 2]);
+	ticks[0] += plat_timer_read() - start;
+
+	start = plat_timer_read();
+	nuked_generate_stream(chip[1], out, SOUNDBUFLEN);
+	ticks[1] += plat_timer_read() - start;
+
+	if (memcmp(ref, out, SOUNDBUFLEN * 2 * sizeof(int32_t))) {
+		ERRLOG("NUKED: batched output does not match in frame %i!\n", f);
+		bad = 1;
+		break;
+	}
     }
+
+    if (! bad) {
+	for (i = 0; i < 2; i++)
+		if (ticks[i] == 0)
+			ticks[i] = 1;
+
+	INFO("NUKED: %i frames, original %.1f ms, batched %.1f ms (%.2fx)\n",
+	     BENCH_FRAMES,
+	     (double)ticks[0] * 1000.0 / plat_timer_freq(),
+	     (double)ticks[1] * 1000.0 / plat_timer_freq(),
+	     (double)ticks[0] / (double)ticks[1]);
+    }
+
+    nuked_close(chip[1]);
+    nuked_close(chip[0]);
+    free(out);
+    free(ref);
 }
 
 
@@ -8,12 +8,12 @@
  *
  *		Definitions for the NukedOPL3 driver.
  *
- * Version:	@(#)snd_opl_nuked.h	1.0.5	2020/07/16
+ * Version:	@(#)snd_opl_nuked.h	1.0.7	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *
- *		Copyright 2017-2020 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -46,8 +46,11 @@ extern void	nuked_write_reg(priv_t, uint16_t reg, uint8_t v);
 extern void	nuked_write_reg_buffered(priv_t, uint16_t reg, uint8_t v);
 
 extern void	nuked_generate(priv_t, int32_t *buf);
+extern void	nuked_generate_block(priv_t, int32_t *buf, uint32_t num);
 extern void	nuked_generate_resampled(priv_t, int32_t *buf);
 extern void	nuked_generate_stream(priv_t, int32_t *sndptr, uint32_t num);
 
+extern void	nuked_bench(void);
+
 
 #endif	/*SOUND_OPL_NUKED_H*/
@@ -10,7 +10,7 @@
  *
  * FIXME:	THIS FILE IS A HORRIBLE NIGHTMARE
  *
- * Version:	@(#)snd_sb.c	1.0.20	2021/03/16
+ * Version:	@(#)snd_sb.c	1.0.21	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -18,7 +18,7 @@
  *		John Sirett, <notifications@github.com>	//FIXME:
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -57,6 +57,7 @@
 #include "../system/mca.h"
 #include "sound.h"
 #include "snd_filters.h"
+#include "snd_fir.h"
 #include "snd_emu8k.h"
 #include "snd_mpu401.h"
 #include "snd_opl.h"
@@ -333,6 +334,7 @@ static void sb_get_buffer_sb16(int32_t *buffer, int len, priv_t priv)
         sb_t *sb = (sb_t *)priv;
         sb_ct1745_mixer_t *mixer = &sb->mixer_sb16;
         int dsp_rec_pos = sb->dsp.record_pos_write;
+        float voice[SOUNDBUFLEN * 2];
         int c;
 
 	if (sb->opl_enabled)
@@ -340,6 +342,8 @@ static void sb_get_buffer_sb16(int32_t *buffer, int len, priv_t priv)
 
         sb_dsp_update(&sb->dsp);
 
+        fir_filter_block(sb->dsp.fir, sb->dsp.buffer, voice, len);
+
         for (c = 0; c < len * 2; c += 2)
         {
                 int32_t out_l = 0, out_r = 0, in_l, in_r;
@@ -353,8 +357,8 @@ static void sb_get_buffer_sb16(int32_t *buffer, int len, priv_t priv)
                 in_l = (mixer->input_selector_left&INPUT_MIDI_L) ? out_l : 0 + (mixer->input_selector_left&INPUT_MIDI_R) ? out_r : 0;
                 in_r = (mixer->input_selector_right&INPUT_MIDI_L) ? out_l : 0 + (mixer->input_selector_right&INPUT_MIDI_R) ? out_r : 0;
         
-                out_l += ((int32_t)(low_fir_sb16(0, (float)sb->dsp.buffer[c])     * mixer->voice_l) / 3) >> 15;
-                out_r += ((int32_t)(low_fir_sb16(1, (float)sb->dsp.buffer[c + 1]) * mixer->voice_r) / 3) >> 15;
+                out_l += ((int32_t)(voice[c] * mixer->voice_l) / 3) >> 15;
+                out_r += ((int32_t)(voice[c + 1] * mixer->voice_r) / 3) >> 15;
 
                 out_l = (out_l * mixer->master_l) >> 15;
                 out_r = (out_r * mixer->master_r) >> 15;
@@ -408,6 +412,7 @@ static void sb_get_buffer_emu8k(int32_t *buffer, int len, priv_t priv)
         sb_t *sb = (sb_t *)priv;
         sb_ct1745_mixer_t *mixer = &sb->mixer_sb16;
         int dsp_rec_pos = sb->dsp.record_pos_write;
+        float voice[SOUNDBUFLEN * 2];
         int c;
 
 	if (sb->opl_enabled)
@@ -417,6 +422,8 @@ static void sb_get_buffer_emu8k(int32_t *buffer, int len, priv_t priv)
 
         sb_dsp_update(&sb->dsp);
 
+        fir_filter_block(sb->dsp.fir, sb->dsp.buffer, voice, len);
+
         for (c = 0; c < len * 2; c += 2)
         {
                 int32_t out_l = 0, out_r = 0, in_l, in_r;
@@ -434,8 +441,8 @@ static void sb_get_buffer_emu8k(int32_t *buffer, int len, priv_t priv)
                 in_l = (mixer->input_selector_left&INPUT_MIDI_L) ? out_l : 0 + (mixer->input_selector_left&INPUT_MIDI_R) ? out_r : 0;
                 in_r = (mixer->input_selector_right&INPUT_MIDI_L) ? out_l : 0 + (mixer->input_selector_right&INPUT_MIDI_R) ? out_r : 0;
                 
-                out_l += ((int32_t)(low_fir_sb16(0, (float)sb->dsp.buffer[c])     * mixer->voice_l) / 3) >> 15;
-                out_r += ((int32_t)(low_fir_sb16(1, (float)sb->dsp.buffer[c + 1]) * mixer->voice_r) / 3) >> 15;
+                out_l += ((int32_t)(voice[c] * mixer->voice_l) / 3) >> 15;
+                out_r += ((int32_t)(voice[c + 1] * mixer->voice_r) / 3) >> 15;
 
                 out_l = (out_l * mixer->master_l) >> 15;
                 out_r = (out_r * mixer->master_r) >> 15;
@@ -14,13 +14,13 @@
  *		  486-50 - 32kHz
  *		  Pentium - 45kHz
  *
- * Version:	@(#)snd_sb_dsp.c	1.0.14	2020/07/14
+ * Version:	@(#)snd_sb_dsp.c	1.0.15	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2020 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -46,7 +46,6 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
-#include <math.h>
 #include <wchar.h>
 #define dbglog sound_card_log
 #include "../../emu.h"
@@ -59,6 +58,7 @@
 #include "midi.h"
 #include "snd_mpu401.h"
 #include "snd_filters.h"
+#include "snd_fir.h"
 #include "snd_sb.h"
 #include "snd_sb_dsp.h"
 
@@ -155,43 +155,16 @@ static int sb_commands[256] = {
 };
 static mpu_t *mpu;
 
-float low_fir_sb16_coef[SB16_NCoef];
+#define SB16_NCoef	51
 
 
-static inline double
-sinc(double x)
-{
-    return sin(M_PI * x) / (M_PI * x);
-}
-
 static void
-recalc_sb16_filter(int playback_freq)
+recalc_sb16_filter(sb_dsp_t *dsp, int playback_freq)
 {
     /*Cutoff frequency = playback / 2*/
     float fC = (float)((float)playback_freq / (float)2.0) / (float)48000.0;
-    float gain;
-    int n;
-    double w, h;
-
-    for (n = 0; n < SB16_NCoef; n++) {
-	/*Blackman window*/
-	w = 0.42 - (0.5 * cos((2.0*n*M_PI)/(double)(SB16_NCoef-1))) + (0.08 * cos((4.0*n*M_PI)/(double)(SB16_NCoef-1)));
-	/*Sinc filter*/
-	h = sinc(2.0 * fC * ((double)n - ((double)(SB16_NCoef-1) / 2.0)));
-
-	/*Create windowed-sinc filter*/
-	low_fir_sb16_coef[n] = (float)(w * h);
-    }
-
-    low_fir_sb16_coef[(SB16_NCoef - 1) / 2] = 1.0;
-
-    gain = 0.0;
-    for (n = 0; n < SB16_NCoef; n++)
-	gain += low_fir_sb16_coef[n];
 
-    /*Normalise filter, to produce unity gain*/
-    for (n = 0; n < SB16_NCoef; n++)
-	low_fir_sb16_coef[n] /= gain;
+    fir_set_cutoff(dsp->fir, fC, 1.0);
 }
 
 
@@ -497,7 +470,7 @@ sb_exec_command(sb_dsp_t *dsp)
 		temp = 1000000 / temp;
 		DBGLOG(1, "Sample rate - %ihz (%i)\n",temp, dsp->sblatcho);
 		if (dsp->sb_freq != temp && dsp->sb_type >= SB16)
-			recalc_sb16_filter(temp);
+			recalc_sb16_filter(dsp, temp);
 		dsp->sb_freq = temp;
                 break;
                 
@@ -511,7 +484,7 @@ sb_exec_command(sb_dsp_t *dsp)
 			dsp->sblatchi = dsp->sblatcho;
 			dsp->sb_timei = dsp->sb_timeo;
 			if (dsp->sb_freq != temp && dsp->sb_type >= SB16)
-				recalc_sb16_filter(dsp->sb_freq);
+				recalc_sb16_filter(dsp, dsp->sb_freq);
 		}
 		break;
 		
@@ -905,7 +878,8 @@ sb_dsp_init(sb_dsp_t *dsp, int type)
 
     /*Initialise SB16 filter to same cutoff as 8-bit SBs (3.2 kHz). This will be recalculated when
           a set frequency command is sent.*/
-    recalc_sb16_filter(3200*2);
+    if (type >= SB16)
+	dsp->fir = fir_create(SB16_NCoef, 1, (float)3200.0 / (float)48000.0, 1.0);
 }
 
 void sb_dsp_setaddr(sb_dsp_t *dsp, uint16_t addr)
@@ -1312,4 +1286,5 @@ sb_dsp_update(sb_dsp_t *dsp)
 void 
 sb_dsp_close(sb_dsp_t *dsp)
 {
+    fir_close(dsp->fir);
 }
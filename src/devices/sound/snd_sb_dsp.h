@@ -8,13 +8,13 @@
  *
  *		Definitions for the SoundBlaster DSP driver.
  *
- * Version:	@(#)snd_sb_dsp.h	1.0.3	2019/05/17
+ * Version:	@(#)snd_sb_dsp.h	1.0.4	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -111,6 +111,8 @@ typedef struct sb_dsp_t
         int16_t record_buffer[0xFFFF];
         int16_t buffer[SOUNDBUFLEN * 2];
         int pos;
+
+        struct fir *fir;		/*SB16 output filter*/
 } sb_dsp_t;
 
 void sb_dsp_set_mpu(mpu_t *src_mpu);
@@ -8,14 +8,14 @@
  *
  *		Implementation of the Windows Sound System sound device.
  *
- * Version:	@(#)snd_wss.c	1.0.14	2021/03/16
+ * Version:	@(#)snd_wss.c	1.0.15	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		TheCollector1995, <mariogplayer@gmail.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2018 TheCollector1995.
  *		Copyright 2016-2018 Miran Grca.
@@ -56,6 +56,7 @@
 #include "../system/pic.h"
 #include "sound.h"
 #include "snd_ad1848.h"
+#include "snd_fir.h"
 #include "snd_opl.h"
 
 
@@ -83,16 +84,13 @@ static void
 get_buffer(int32_t *buffer, int len, priv_t priv)
 {
     wss_t *dev = (wss_t *)priv;
-    int c;
 
     opl3_update(&dev->opl);
 
     ad1848_update(&dev->ad1848);
 
-    for (c = 0; c < len * 2; c++) {
-	buffer[c] += dev->opl.buffer[c];
-	buffer[c] += (dev->ad1848.buffer[c] / 2);
-    }
+    snd_mix_block(buffer, dev->opl.buffer, len);
+    snd_mix_block_half(buffer, dev->ad1848.buffer, len);
 
     dev->opl.pos = 0;
     dev->ad1848.pos = 0;
@@ -8,13 +8,13 @@
  *
  *		Sound emulation core.
  *
- * Version:	@(#)sound.c	1.0.21	2020/07/14
+ * Version:	@(#)sound.c	1.0.22	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2020 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -211,9 +211,9 @@ cd_thread(void *param)
 	}
 
 	if (config.sound_is_float)
-		openal_buffer_cd(cd_out_buffer);
+		sound_sink_write(SINK_CD, cd_out_buffer, CD_BUFLEN * 2);
 	else
-		openal_buffer_cd(cd_out_buffer_int16);
+		sound_sink_write(SINK_CD, cd_out_buffer_int16, CD_BUFLEN * 2);
     }
 }
 
@@ -275,9 +275,9 @@ sound_poll(void *priv)
 	}
 
 	if (config.sound_is_float)
-		openal_buffer(outbuffer_ex);
+		sound_sink_write(SINK_PCM, outbuffer_ex, SOUNDBUFLEN * 2);
 	else
-		openal_buffer(outbuffer_ex_int16);
+		sound_sink_write(SINK_PCM, outbuffer_ex_int16, SOUNDBUFLEN * 2);
 	
 	if (cd_thread_enable) {
 		cd_buf_update--;
@@ -320,6 +320,9 @@ sound_reset(void)
     /* Kill the CD-Audio thread. */
     sound_cd_stop();
 
+    /* Stop feeding the output sink. */
+    sound_sink_stop();
+
     /* Reset the sound module buffers. */
     if (outbuffer_ex != NULL)
 	free(outbuffer_ex);
@@ -336,8 +339,8 @@ sound_reset(void)
     /* Reset the MIDI devices. */
     midi_device_init();
 
-    /* Reset OpenAL. */
-    openal_reset();
+    /* Reset the output sink and its mixer. */
+    sound_sink_reset();
 
     timer_add(sound_poll, NULL, &poll_time, TIMER_ALWAYS_ENABLED);
 
@@ -366,8 +369,8 @@ sound_init(void)
 {
     int drives, i;
 
-    /* Initialize the OpenAL module. */
-    openal_init();
+    /* Initialize the output sink. */
+    sound_sink_init();
 
 #ifdef USE_FLUIDSYNTH
     /* Initialize the FluidSynth module. */
@@ -427,8 +430,8 @@ sound_close(void)
     /* Close down the MIDI module. */
     midi_close();
 
-    /* Close the OpenAL interface. */
-    openal_close();
+    /* Close the output sink. */
+    sound_sink_close();
 }
 
 
@@ -8,13 +8,13 @@
  *
  *		Definitions for the Sound Emulation core.
  *
- * Version:	@(#)sound.h	1.0.13	2021/06/03
+ * Version:	@(#)sound.h	1.0.14	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -48,6 +48,12 @@
 #define SOUND_NONE	0
 #define SOUND_INTERNAL	1
 
+/* Audio streams going to the output sink. */
+#define SINK_PCM	0			// sound cards, 48 kHz
+#define SINK_CD		1			// CD audio, CD_FREQ
+#define SINK_MIDI	2			// MIDI synths
+#define SINK_MAX	3
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,6 +61,24 @@ extern "C" {
 
 extern int	sound_pos_global;
 
+
+/* Define an audio output sink. */
+typedef struct {
+    const char	*internal_name;
+    const char	*name;
+
+    int		merged;			// wants one mixed 48 kHz stream
+
+    void	(*init)(void);
+    void	(*close)(void);
+    void	(*reset)(void);
+    void	(*write)(int stream, const void *buf, int size, int freq);
+} sound_sink_t;
+
+extern const sound_sink_t openal_sink;
+extern const sound_sink_t null_sink;
+extern const sound_sink_t wav_sink;
+
 #ifdef EMU_DEVICE_H
 /* Sound card devices. */
 extern const device_t adlib_device;
@@ -112,12 +136,19 @@ extern void	sound_close(void);
 extern void	sound_cd_stop(void);
 extern void	sound_cd_set_volume(unsigned int vol_l, unsigned int vol_r);
 
+extern void	sound_sink_init(void);
+extern void	sound_sink_stop(void);
+extern void	sound_sink_reset(void);
+extern void	sound_sink_close(void);
+extern void	sound_sink_write(int stream, const void *buf, int size);
+extern void	sound_sink_set_midi(int freq, int buf_size);
+extern const char *sound_sink_get_internal_name(int id);
+extern int	sound_sink_get_from_internal_name(const char *s);
+
 extern void	openal_close(void);
 extern void	openal_init(void);
 extern void	openal_reset(void);
-extern void	openal_buffer(void *buf);
-extern void	openal_buffer_cd(void *buf);
-extern void	openal_buffer_midi(void *buf, uint32_t size);
+extern void	openal_write(int stream, const void *buf, int size, int freq);
 extern void	openal_set_midi(int freq, int buf_size);
 
 extern void	resid_init(void);
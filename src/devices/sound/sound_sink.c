@@ -0,0 +1,644 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Audio output sinks.
+ *
+ *		The sound core, the CD audio thread and the MIDI synths
+ *		each produce a stream of audio blocks. These are handed
+ *		to a mixer thread through one single-producer, single-
+ *		consumer ring per stream, so none of the producers ever
+ *		has to wait for the host audio. If a ring is full, the
+ *		block is dropped. The rings are only (re)allocated while
+ *		the producers are locked out through a per-ring flag.
+ *
+ *		The mixer thread passes the blocks to the selected sink.
+ *		Sinks that can play several streams (OpenAL) get them
+ *		as-is; sinks that want a single stream (null, WAV file)
+ *		get the CD and MIDI streams resampled to 48 kHz, and
+ *		mixed into the sound card stream.
+ *
+ * Version:	@(#)sound_sink.c	1.0.1	2026/10/17
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <wchar.h>
+#include <time.h>
+#define dbglog sound_log
+#include "../../emu.h"
+#include "../../config.h"
+#include "../../plat.h"
+#include "sound.h"
+
+#ifdef _MSC_VER
+# include <intrin.h>
+# define ring_barrier()	_ReadWriteBarrier()
+# define ring_fence()	_mm_mfence()
+#else
+# define ring_barrier()	__sync_synchronize()
+# define ring_fence()	__sync_synchronize()
+#endif
+
+
+#define SINK_SLOTS	8			// blocks per stream ring
+#define AUX_FRAMES	(CD_BUFLEN * 4)		// max resampled frames queued
+#define WAV_PATH	L"sound"		// where WAV files go
+
+
+typedef struct {
+    int		size,				// max samples per block
+		freq;
+    uint8_t	*data;				// SINK_SLOTS blocks
+    int		len[SINK_SLOTS];		// samples in each block
+
+    volatile uint32_t head,			// written by the producer
+		tail;				// written by the mixer
+
+    volatile int active,			// producer may use the ring
+		writing;			// producer is using the ring
+
+    uint32_t	drops;
+} ring_t;
+
+/* A stream being resampled to 48 kHz for merging. */
+typedef struct {
+    float	*buf;				// AUX_FRAMES frames
+    int		len;				// frames queued
+    double	pos;				// position in the input
+    float	last[2];			// last input frame
+} aux_t;
+
+
+static const sound_sink_t *sinks[] = {
+    &openal_sink,
+    &null_sink,
+    &wav_sink,
+    NULL
+};
+
+static const sound_sink_t *sink;
+static ring_t		rings[SINK_MAX];
+static aux_t		aux[SINK_MAX];
+static float		*mixbuf;
+static int		sample_size;
+static int		midi_freq = 44100,
+			midi_buf_size = 4410;
+
+static thread_t		*mixer_thread;
+static event_t		*mixer_event;
+static volatile int	mixer_run;
+
+
+static void
+ring_alloc(ring_t *r, int size, int freq)
+{
+    memset(r, 0x00, sizeof(ring_t));
+    r->size = size;
+    r->freq = freq;
+    r->data = (uint8_t *)mem_alloc(SINK_SLOTS * size * sample_size);
+}
+
+
+static void
+ring_free(ring_t *r)
+{
+    if (r->data != NULL)
+	free(r->data);
+    memset(r, 0x00, sizeof(ring_t));
+}
+
+
+/* Resample a block of an input stream into its 48 kHz queue. */
+static void
+aux_push(aux_t *a, const void *buf, int size, int freq)
+{
+    const float *fp = (const float *)buf;
+    const int16_t *ip = (const int16_t *)buf;
+    double step = (double)freq / 48000.0;
+    float x0[2], x1[2], f;
+    int frames = size / 2;
+    int i;
+
+    if ((a->len + (int)(frames / step) + 2) > AUX_FRAMES) {
+	/* Nobody is taking them, so start over. */
+	a->len = 0;
+    }
+
+    /*
+     * Linear interpolation: a->pos is the position of the next
+     * output frame, relative to the first frame of this block,
+     * where -1 is the last frame of the previous block.
+     */
+    while (a->pos < (double)(frames - 1)) {
+	i = (int)(a->pos + 1.0) - 1;
+	f = (float)(a->pos - (double)i);
+
+	if (i < 0) {
+		x0[0] = a->last[0];
+		x0[1] = a->last[1];
+	} else if (sample_size == sizeof(float)) {
+		x0[0] = fp[i * 2];
+		x0[1] = fp[i * 2 + 1];
+	} else {
+		x0[0] = (float)ip[i * 2];
+		x0[1] = (float)ip[i * 2 + 1];
+	}
+	if (sample_size == sizeof(float)) {
+		x1[0] = fp[i * 2 + 2];
+		x1[1] = fp[i * 2 + 3];
+	} else {
+		x1[0] = (float)ip[i * 2 + 2];
+		x1[1] = (float)ip[i * 2 + 3];
+	}
+
+	a->buf[a->len * 2] = x0[0] + ((x1[0] - x0[0]) * f);
+	a->buf[a->len * 2 + 1] = x0[1] + ((x1[1] - x0[1]) * f);
+	a->len++;
+
+	a->pos += step;
+    }
+    a->pos -= (double)frames;
+
+    if (sample_size == sizeof(float)) {
+	a->last[0] = fp[size - 2];
+	a->last[1] = fp[size - 1];
+    } else {
+	a->last[0] = (float)ip[size - 2];
+	a->last[1] = (float)ip[size - 1];
+    }
+}
+
+
+/* Mix the queued CD and MIDI audio into a sound card block. */
+static void
+merge_block(const void *buf, int size)
+{
+    float *fp = (float *)buf;
+    int16_t *ip = (int16_t *)buf;
+    aux_t *a;
+    float v;
+    int c, n, s;
+
+    for (c = 0; c < size; c++)
+	mixbuf[c] = (sample_size == sizeof(float)) ? fp[c] : (float)ip[c];
+
+    for (s = SINK_CD; s < SINK_MAX; s++) {
+	a = &aux[s];
+	n = (a->len < (size / 2)) ? a->len : (size / 2);
+	for (c = 0; c < (n * 2); c++)
+		mixbuf[c] += a->buf[c];
+
+	a->len -= n;
+	if (a->len > 0)
+		memmove(a->buf, &a->buf[n * 2], a->len * 2 * sizeof(float));
+    }
+
+    if (sample_size == sizeof(float)) {
+	sink->write(SINK_PCM, mixbuf, size, 48000);
+	return;
+    }
+
+    /* Convert back, in place. */
+    ip = (int16_t *)mixbuf;
+    for (c = 0; c < size; c++) {
+	v = mixbuf[c];
+	if (v > 32767.0)
+		v = 32767.0;
+	if (v < -32768.0)
+		v = -32768.0;
+	ip[c] = (int16_t)v;
+    }
+
+    sink->write(SINK_PCM, ip, size, 48000);
+}
+
+
+static void
+mixer_thread_func(void *priv)
+{
+    ring_t *r;
+    void *buf;
+    int s, slot;
+
+    while (mixer_run) {
+	thread_wait_event(mixer_event, 100);
+	thread_reset_event(mixer_event);
+
+	/* CD and MIDI first, so they are ready for merging. */
+	for (s = SINK_MAX - 1; s >= 0; s--) {
+		r = &rings[s];
+
+		while (r->tail != r->head) {
+			ring_barrier();
+
+			slot = r->tail % SINK_SLOTS;
+			buf = &r->data[slot * r->size * sample_size];
+
+			if (! sink->merged)
+				sink->write(s, buf, r->len[slot], r->freq);
+			else if (s == SINK_PCM)
+				merge_block(buf, r->len[slot]);
+			else
+				aux_push(&aux[s], buf, r->len[slot], r->freq);
+
+			ring_barrier();
+			r->tail++;
+		}
+	}
+    }
+}
+
+
+/*
+ * Keep the producers away from the rings, and wait for any that
+ * was already copying a block in. The fence makes sure that we
+ * either see its 'writing' flag, or it sees 'active' cleared.
+ */
+static void
+rings_lock_out(void)
+{
+    int s;
+
+    for (s = 0; s < SINK_MAX; s++)
+	rings[s].active = 0;
+
+    ring_fence();
+
+    for (s = 0; s < SINK_MAX; s++) {
+	while (rings[s].writing)
+		plat_delay_ms(1);
+    }
+}
+
+
+/* Release the rings; only when no producer can be writing. */
+static void
+mixer_free(void)
+{
+    int s;
+
+    for (s = 0; s < SINK_MAX; s++) {
+	ring_free(&rings[s]);
+	if (aux[s].buf != NULL)
+		free(aux[s].buf);
+	aux[s].buf = NULL;
+    }
+
+    if (mixbuf != NULL)
+	free(mixbuf);
+    mixbuf = NULL;
+}
+
+
+static void
+mixer_start(void)
+{
+    int s;
+
+    mixer_free();
+
+    sample_size = config.sound_is_float ? sizeof(float) : sizeof(int16_t);
+
+    ring_alloc(&rings[SINK_PCM], SOUNDBUFLEN * 2, 48000);
+    ring_alloc(&rings[SINK_CD], CD_BUFLEN * 2, CD_FREQ);
+    ring_alloc(&rings[SINK_MIDI], midi_buf_size / sample_size, midi_freq);
+
+    mixbuf = (float *)mem_alloc(SOUNDBUFLEN * 2 * sizeof(float));
+    for (s = SINK_CD; s < SINK_MAX; s++) {
+	memset(&aux[s], 0x00, sizeof(aux_t));
+	aux[s].buf = (float *)mem_alloc(AUX_FRAMES * 2 * sizeof(float));
+    }
+
+    /* Producers only look at the rings once this is set. */
+    ring_barrier();
+    for (s = 0; s < SINK_MAX; s++)
+	rings[s].active = 1;
+
+    mixer_run = 1;
+    mixer_thread = thread_create(mixer_thread_func, NULL);
+}
+
+
+static void
+mixer_stop(void)
+{
+    rings_lock_out();
+
+    if (mixer_thread == NULL)
+	return;
+
+    mixer_run = 0;
+    thread_set_event(mixer_event);
+    thread_wait(mixer_thread, -1);
+    mixer_thread = NULL;
+
+    if ((rings[SINK_PCM].drops + rings[SINK_CD].drops + rings[SINK_MIDI].drops) > 0)
+	INFO("SOUND: sink '%s' dropped %u/%u/%u blocks (pcm/cd/midi)\n",
+	     sink->internal_name, rings[SINK_PCM].drops,
+	     rings[SINK_CD].drops, rings[SINK_MIDI].drops);
+}
+
+
+/* Queue a block for the mixer thread; never blocks. */
+void
+sound_sink_write(int stream, const void *buf, int size)
+{
+    ring_t *r = &rings[stream];
+    int slot;
+
+    /* Tell a reset we are here before looking at the ring. */
+    r->writing = 1;
+    ring_fence();
+
+    if (! r->active) {
+	r->writing = 0;
+	return;
+    }
+
+    if ((r->head - r->tail) >= SINK_SLOTS) {
+	r->drops++;
+	r->writing = 0;
+	return;
+    }
+
+    if (size > r->size)
+	size = r->size;
+
+    slot = r->head % SINK_SLOTS;
+    memcpy(&r->data[slot * r->size * sample_size], buf, size * sample_size);
+    r->len[slot] = size;
+
+    ring_barrier();
+    r->head++;
+
+    r->writing = 0;
+
+    thread_set_event(mixer_event);
+}
+
+
+/* MIDI synths tell us their rate and block size (in bytes.) */
+void
+sound_sink_set_midi(int freq, int buf_size)
+{
+    midi_freq = freq;
+    midi_buf_size = buf_size;
+
+    openal_set_midi(freq, buf_size);
+}
+
+
+void
+sound_sink_init(void)
+{
+    sink = sinks[config.sound_sink];
+    if (sink == NULL)
+	sink = sinks[0];
+
+    INFO("SOUND: using output '%s'\n", sink->name);
+
+    /* Kept for good, producers may still poke it during a reset. */
+    mixer_event = thread_create_event();
+
+    if (sink->init != NULL)
+	sink->init();
+}
+
+
+/*
+ * Stop the mixer before a reset. Producers (the CD and MIDI
+ * threads) may still be running, but they no longer use the rings.
+ */
+void
+sound_sink_stop(void)
+{
+    mixer_stop();
+}
+
+
+void
+sound_sink_reset(void)
+{
+    mixer_stop();
+
+    if (sink->reset != NULL)
+	sink->reset();
+
+    mixer_start();
+}
+
+
+void
+sound_sink_close(void)
+{
+    mixer_stop();
+
+    if (sink->close != NULL)
+	sink->close();
+
+    mixer_free();
+
+    thread_destroy_event(mixer_event);
+    mixer_event = NULL;
+}
+
+
+const char *
+sound_sink_get_internal_name(int id)
+{
+    int c;
+
+    for (c = 0; sinks[c] != NULL; c++) {
+	if (c == id)
+		return(sinks[c]->internal_name);
+    }
+
+    return(NULL);
+}
+
+
+int
+sound_sink_get_from_internal_name(const char *s)
+{
+    int c;
+
+    for (c = 0; sinks[c] != NULL; c++) {
+	if (! strcmp(sinks[c]->internal_name, s))
+		return(c);
+    }
+
+    /* Default value. */
+    return(0);
+}
+
+
+static uint64_t	null_samples;
+
+
+static void
+null_write(int stream, const void *buf, int size, int freq)
+{
+    null_samples += size;
+}
+
+
+static void
+null_close(void)
+{
+    INFO("SOUND: null output consumed %llu samples\n",
+	 (unsigned long long)null_samples);
+}
+
+
+const sound_sink_t null_sink = {
+    "none", "None",
+    0,
+    NULL,
+    null_close,
+    NULL,
+    null_write
+};
+
+
+static FILE	*wav_fp;
+static uint32_t	wav_bytes;
+
+
+static void
+wav_put16(uint16_t val)
+{
+    fputc(val & 0xff, wav_fp);
+    fputc(val >> 8, wav_fp);
+}
+
+
+static void
+wav_put32(uint32_t val)
+{
+    wav_put16(val & 0xffff);
+    wav_put16(val >> 16);
+}
+
+
+/* (Re)write the header, with the sizes we have so far. */
+static void
+wav_header(void)
+{
+    int bits = (sample_size == sizeof(float)) ? 32 : 16;
+
+    fseek(wav_fp, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, wav_fp);
+    wav_put32(wav_bytes + 36);
+    fwrite("WAVEfmt ", 1, 8, wav_fp);
+    wav_put32(16);
+    wav_put16((sample_size == sizeof(float)) ? 3 : 1);
+    wav_put16(2);
+    wav_put32(48000);
+    wav_put32(48000 * 2 * (bits / 8));
+    wav_put16(2 * (bits / 8));
+    wav_put16(bits);
+    fwrite("data", 1, 4, wav_fp);
+    wav_put32(wav_bytes);
+    fseek(wav_fp, 0, SEEK_END);
+}
+
+
+static void
+wav_close(void)
+{
+    if (wav_fp == NULL)
+	return;
+
+    wav_header();
+    (void)fclose(wav_fp);
+    wav_fp = NULL;
+
+    INFO("SOUND: wrote %u bytes of audio\n", wav_bytes);
+}
+
+
+static void
+wav_reset(void)
+{
+    wchar_t path[1024], fn[128];
+    struct tm *info;
+    time_t now;
+
+    wav_close();
+
+    (void)time(&now);
+    info = localtime(&now);
+
+    memset(path, 0x00, sizeof(path));
+    plat_append_filename(path, usr_path, WAV_PATH);
+
+    if (! plat_dir_check(path))
+	plat_dir_create(path);
+
+    plat_append_slash(path);
+
+    wcsftime(fn, sizeof_w(fn), L"%Y%m%d_%H%M%S.wav", info);
+    wcscat(path, fn);
+
+    /* The header is written with the format of the next session. */
+    sample_size = config.sound_is_float ? sizeof(float) : sizeof(int16_t);
+    wav_bytes = 0;
+
+    wav_fp = plat_fopen(path, L"wb");
+    if (wav_fp == NULL) {
+	ERRLOG("SOUND: unable to create '%ls'\n", path);
+	return;
+    }
+
+    wav_header();
+}
+
+
+static void
+wav_write(int stream, const void *buf, int size, int freq)
+{
+    if (wav_fp == NULL)
+	return;
+
+    wav_bytes += (uint32_t)fwrite(buf, sample_size, size, wav_fp) * sample_size;
+}
+
+
+const sound_sink_t wav_sink = {
+    "wav", "WAV file",
+    1,
+    NULL,
+    wav_close,
+    wav_reset,
+    wav_write
+};
@@ -8,13 +8,13 @@
  *
  *		Implementation of the Intel DMA controllers.
  *
- * Version:	@(#)dma.c	1.0.12	2019/05/17
+ * Version:	@(#)dma.c	1.0.13	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -45,6 +45,7 @@
 #include "../../cpu/x86.h"
 #include "../../mem.h"
 #include "../../io.h"
+#include "../../state.h"
 #include "../../plat.h"
 #include "mca.h"
 #include "dma.h"
@@ -911,7 +912,6 @@ dma_channel_write(int channel, uint16_t val)
 			dma_c->ac -= 2;
 		  else
 			dma_c->ac = (dma_c->ac & 0xfe0000) | ((dma_c->ac - 2) & 0x1ffff);
-		dma_c->ac = (dma_c->ac & 0xfe0000) | ((dma_c->ac - 2) & 0x1ffff);
 	} else {
 		if (dma_ps2.is_ps2)
 			dma_c->ac += 2;
@@ -939,6 +939,131 @@ dma_channel_write(int channel, uint16_t val)
 }
 
 
+/*
+ * Move a block of data between memory and a DMA channel.
+ *
+ * This does what a series of single transfers would do, but the
+ * channel state is checked only once, and the data is moved in
+ * runs which end at the DMA page boundary or terminal count. We
+ * stop at terminal count, so the caller can act on it; if the
+ * channel is in auto-init mode, it is re-loaded for the next call.
+ */
+static int
+dma_channel_block(int channel, uint8_t *rbuf, const uint8_t *wbuf, int len)
+{
+    dma_t *dma_c = &dma[channel];
+    uint32_t mask, high;
+    int width, units, run, done, c;
+
+    if (((channel < 4) ? dma_command : dma16_command) & 0x04) {
+	DEBUG("DMA: chan_block(%i) & 04\n", channel);
+	return(DMA_NODATA);
+    }
+
+    if (dma_m & (1 << channel)) {
+	DEBUG("DMA: chan_block(%i) mask %02x\n", channel, dma_m);
+	return(DMA_NODATA);
+    }
+    if ((dma_c->mode & 0x0c) != ((rbuf != NULL) ? 8 : 4)) {
+	DEBUG("DMA: chan_block(%i) mode %02x\n", channel, dma_c->mode);
+	return(DMA_NODATA);
+    }
+
+    width = dma_c->size ? 2 : 1;
+    mask = dma_c->size ? 0x1ffff : 0xffff;
+    high = dma_c->size ? 0xfe0000 : 0xff0000;
+
+    /* Keep the count clear of the DMA_OVER flag. */
+    if (len > 0xffff)
+	len = 0xffff;
+    units = len / width;
+    if (units == 0)
+	return(DMA_NODATA);
+
+    done = 0;
+    while (units > 0) {
+	run = dma_c->cc + 1;
+	if (run > units)
+		run = units;
+
+	if (dma_c->mode & 0x20) {
+		/* Address decrement, so move one unit at a time. */
+		run = 1;
+	} else if (! dma_ps2.is_ps2) {
+		/* Do not cross into the next DMA page. */
+		c = (mask - (dma_c->ac & mask) + 1) / width;
+		if (c < 1)
+			c = 1;
+		if (run > c)
+			run = c;
+	}
+	c = run * width;
+
+	if (! AT) {
+		for (units -= run; run > 0; run--)
+			refreshread();
+	} else
+		units -= run;
+
+	if (rbuf != NULL)
+		mem_read_phys(&rbuf[done], dma_c->ac, c);
+	  else
+		mem_write_phys(&wbuf[done], dma_c->ac, c);
+	done += c;
+
+	if (dma_c->mode & 0x20) {
+		if (dma_ps2.is_ps2)
+			dma_c->ac -= c;
+		  else
+			dma_c->ac = (dma_c->ac & high) | ((dma_c->ac - c) & mask);
+	} else {
+		if (dma_ps2.is_ps2)
+			dma_c->ac += c;
+		  else
+			dma_c->ac = (dma_c->ac & high) | ((dma_c->ac + c) & mask);
+	}
+
+	dma_stat_rq |= (1 << channel);
+
+	dma_c->cc -= (c / width);
+	if (dma_c->cc < 0) {
+		if (dma_c->mode & 0x10) { /*Auto-init*/
+			dma_c->cc = dma_c->cb;
+			dma_c->ac = dma_c->ab;
+		} else
+			dma_m |= (1 << channel);
+		dma_stat |= (1 << channel);
+
+		return(done | DMA_OVER);
+	}
+    }
+
+    return(done);
+}
+
+
+/*
+ * Read up to 'len' bytes from memory through a DMA channel.
+ *
+ * Returns the number of bytes read, with DMA_OVER set if the
+ * terminal count was reached, or DMA_NODATA if the channel is
+ * not set up for a read transfer.
+ */
+int
+dma_channel_read_block(int channel, uint8_t *buf, int len)
+{
+    return(dma_channel_block(channel, buf, NULL, len));
+}
+
+
+/* Write up to 'len' bytes to memory through a DMA channel. */
+int
+dma_channel_write_block(int channel, const uint8_t *buf, int len)
+{
+    return(dma_channel_block(channel, NULL, buf, len));
+}
+
+
 int
 dma_mode(int channel)
 {
@@ -949,33 +1074,36 @@ dma_mode(int channel)
 }
 
 
+/* Save or load the state of the DMA controllers. */
+void
+dma_serialize(state_t *s)
+{
+    state_var(s, dma);
+    state_var(s, dmaregs);
+    state_var(s, dma16regs);
+    state_var(s, dmapages);
+    state_var(s, dma_wp);
+    state_var(s, dma16_wp);
+    state_var(s, dma_m);
+    state_var(s, dma_stat);
+    state_var(s, dma_stat_rq);
+    state_var(s, dma_stat_rq_pc);
+    state_var(s, dma_command);
+    state_var(s, dma16_command);
+    state_var(s, dma_ps2);
+}
+
+
 /* DMA Bus Master Page Read/Write */
 void
 DMAPageRead(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize)
 {
-    uint32_t i = 0;
-
-#if 0
-    memcpy(DataRead, &ram[PhysAddress], TotalSize);
-#else
-    for (i = 0; i < TotalSize; i++)
-	DataRead[i] = mem_readb_phys(PhysAddress + i);
-#endif
+    mem_read_phys(DataRead, PhysAddress, (int)TotalSize);
 }
 
 
 void
 DMAPageWrite(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize)
 {
-    uint32_t i = 0;
-
-#if 0
-    mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
-    memcpy(&ram[PhysAddress], DataWrite, TotalSize);
-#else
-    for (i = 0; i < TotalSize; i++)
-	mem_writeb_phys(PhysAddress + i, DataWrite[i]);
-
-    mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
-#endif
+    mem_write_phys(DataWrite, PhysAddress, (int)TotalSize);
 }
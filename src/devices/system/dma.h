@@ -8,13 +8,13 @@
  *
  *		Definitions for the Intel DMA controller.
  *
- * Version:	@(#)dma.h	1.0.4	2019/05/17
+ * Version:	@(#)dma.h	1.0.5	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -76,6 +76,9 @@ extern void	dma_set_drq(int channel, int set);
 
 extern int	dma_channel_read(int channel);
 extern int	dma_channel_write(int channel, uint16_t val);
+extern int	dma_channel_read_block(int channel, uint8_t *buf, int len);
+extern int	dma_channel_write_block(int channel, const uint8_t *buf,
+					int len);
 
 extern void	DMAPageRead(uint32_t PhysAddress, uint8_t *DataRead,
 			    uint32_t TotalSize);
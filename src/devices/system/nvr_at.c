@@ -189,14 +189,14 @@
  *		including the later update (DS12887A) which implemented a
  *		"century" register to be compatible with Y2K.
  *
- * Version:	@(#)nvr_at.c	1.0.25	2021/03/19
+ * Version:	@(#)nvr_at.c	1.0.26	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Mahod,
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2020 Miran Grca.
  *		Copyright 2008-2020 Sarah Walker.
  *
@@ -233,6 +233,7 @@
 #include "../../io.h"
 #include "../../device.h"
 #include "../../nvr.h"
+#include "../../state.h"
 #include "../../plat.h"
 #include "clk.h"
 #include "nmi.h"
@@ -854,6 +855,32 @@ nvr_at_close(priv_t priv)
 }
 
 
+/* Save or load the state of the RTC and its registers. */
+static void
+nvr_at_serialize(priv_t priv, state_t *s)
+{
+    local_t *dev = (local_t *)priv;
+    nvr_t *nvr = &dev->nvr;
+
+    state_var(s, nvr->regs);
+    state_var(s, nvr->clk);
+    state_var(s, nvr->onesec_cnt);
+    state_var(s, nvr->onesec_time);
+
+    state_var(s, dev->read_addr);
+    state_var(s, dev->stat);
+    state_var(s, dev->addr);
+    state_var(s, dev->wp);
+    state_var(s, dev->bank);
+    state_data(s, dev->lock, nvr->size);
+    state_var(s, dev->count);
+    state_var(s, dev->state);
+    state_var(s, dev->ptimer);
+    state_var(s, dev->utimer);
+    state_var(s, dev->ecount);
+}
+
+
 static priv_t
 nvr_at_init(const device_t *info, UNUSED(void *parent))
 {
@@ -950,7 +977,8 @@ const device_t at_nvr_old_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 const device_t at_nvr_device = {
@@ -962,7 +990,8 @@ const device_t at_nvr_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 const device_t ibmat_nvr_device = {
@@ -974,7 +1003,8 @@ const device_t ibmat_nvr_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 const device_t amstrad_nvr_device = {
@@ -986,7 +1016,8 @@ const device_t amstrad_nvr_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 const device_t ps_nvr_device = {
@@ -998,7 +1029,8 @@ const device_t ps_nvr_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 const device_t piix4_nvr_device = {
@@ -1010,7 +1042,8 @@ const device_t piix4_nvr_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 const device_t ls486e_nvr_device = {
@@ -1022,7 +1055,8 @@ const device_t ls486e_nvr_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 const device_t via_nvr_device = {
@@ -1034,7 +1068,8 @@ const device_t via_nvr_device = {
     NULL,
     nvr_at_recalc,
     NULL, NULL,
-    NULL
+    NULL,
+    nvr_at_serialize
 };
 
 
@@ -8,13 +8,13 @@
  *
  *		Implementation of Intel 8259 interrupt controller.
  *
- * Version:	@(#)pic.c	1.0.10	2021/02/17
+ * Version:	@(#)pic.c	1.0.11	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -44,6 +44,8 @@
 #include "../../timer.h"
 #include "../../io.h"
 #include "../../cpu/cpu.h"
+#include "../../state.h"
+#include "nmi.h"
 #include "pci.h"
 #include "pic.h"
 #include "pit.h"
@@ -729,6 +731,27 @@ picinterrupt_poll(int is_pic2)
 }
 
 
+/* Save or load the state of the interrupt controllers. */
+void
+pic_serialize(state_t *s)
+{
+    state_var(s, pic);
+    state_var(s, pic2);
+    state_var(s, pic_pending);
+    state_var(s, pic_pend);
+    state_var(s, pic_current);
+    state_var(s, shadow);
+    state_var(s, intclear);
+    state_var(s, keywaiting);
+
+    /* The NMI logic is small enough to go along. */
+    state_var(s, nmi);
+    state_var(s, nmi_mask);
+    state_var(s, nmi_enable);
+    state_var(s, nmi_auto_clear);
+}
+
+
 void
 pic_dump(void)
 {
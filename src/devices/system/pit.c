@@ -13,13 +13,13 @@
  *		B4 to 40, two writes to 43, then two reads
  *			- value _does_ change!
  *
- * Version:	@(#)pit.c	1.0.18	2021/03/18
+ * Version:	@(#)pit.c	1.0.19	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -42,6 +42,7 @@
  *   USA.
  */
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -51,6 +52,7 @@
 #include "../../cpu/cpu.h"
 #include "../../io.h"
 #include "../../device.h"
+#include "../../state.h"
 #include "../sound/sound.h"
 #include "../sound/snd_speaker.h"
 #ifdef USE_CASSETTE
@@ -688,3 +690,12 @@ pit_set_out_func(PIT *dev, int t, void (*func)(int new_out, int old_out))
 {
     dev->funcs[t] = func;
 }
+
+
+/* Save or load the state of the timers, up to the (local) pointers. */
+void
+pit_serialize(state_t *s)
+{
+    state_data(s, &pit, offsetof(PIT, pit_nr));
+    state_data(s, &pit2, offsetof(PIT, pit_nr));
+}
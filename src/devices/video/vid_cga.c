@@ -8,13 +8,13 @@
  *
  *		Emulation of the old and new IBM CGA graphics cards.
  *
- * Version:	@(#)vid_cga.c	1.0.21	2021/05/24
+ * Version:	@(#)vid_cga.c	1.0.22	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2021 Sarah Walker.
  *
@@ -298,7 +298,6 @@ cga_poll(priv_t priv)
 	if (dev->cgadispon) {
 		if (dev->displine < dev->firstline) {
 			dev->firstline = dev->displine;
-			video_blit_wait_buffer();
 		}
 		dev->lastline = dev->displine;
 
@@ -8,13 +8,13 @@
  *
  *		Implementation of CGA used by Compaq PC's.
  *
- * Version:	@(#)vid_cga_compaq.c	1.0.13	2019/05/17
+ * Version:	@(#)vid_cga_compaq.c	1.0.14	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		TheCollector1995, <mariogplayer@gmail.com>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -121,7 +121,6 @@ compaq_poll(priv_t priv)
 	if (dev->cga.cgadispon) {
 		if (dev->cga.displine < dev->cga.firstline) {
 			dev->cga.firstline = dev->cga.displine;
-			video_blit_wait_buffer();
 		}
 		dev->cga.lastline = dev->cga.displine;
 
@@ -8,13 +8,13 @@
  *
  *		Plantronics ColorPlus emulation.
  *
- * Version:	@(#)vid_colorplus.c	1.0.19	2021/04/14
+ * Version:	@(#)vid_colorplus.c	1.0.20	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -187,7 +187,6 @@ colorplus_poll(priv_t priv)
 	if (dev->cga.cgadispon) {
 		if (dev->cga.displine < dev->cga.firstline) {
 			dev->cga.firstline = dev->cga.displine;
-			video_blit_wait_buffer();
 		}
 		dev->cga.lastline = dev->cga.displine;
 
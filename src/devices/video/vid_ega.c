@@ -9,13 +9,13 @@
  *		Emulation of the EGA, Chips & Technologies SuperEGA, and
  *		AX JEGA graphics cards.
  *
- * Version:	@(#)vid_ega.c	1.0.21	2019/05/17
+ * Version:	@(#)vid_ega.c	1.0.22	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -344,7 +344,6 @@ ega_poll(priv_t priv)
 	if (dev->dispon) {
 		if (dev->firstline == 2000) {
 			dev->firstline = dev->displine;
-			video_blit_wait_buffer();
 		}
 
 		if (dev->scrblank)
@@ -64,13 +64,13 @@
  *		reducing the height of characters so they fit in an 8x12 cell
  *		if necessary.
  *
- * Version:	@(#)vid_genius.c	1.0.17	2019/05/17
+ * Version:	@(#)vid_genius.c	1.0.18	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *              John Elliott, <jce@seasip.info>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2016-2019 John Elliott.
  *
@@ -518,9 +518,6 @@ genius_poll(priv_t priv)
 		else
 			bg = dev->pal[0];
 
-		if (dev->displine == 0)
-			video_blit_wait_buffer();
-
 		/* Start off with a blank line. */
 		for (x = 0; x < GENIUS_XSIZE; x++)
 			screen->line[dev->displine][x].pal = bg;
@@ -8,13 +8,13 @@
  *
  *		Hercules Plus emulation.
  *
- * Version:	@(#)vid_hercules_plus.c	1.0.23	2019/05/17
+ * Version:	@(#)vid_hercules_plus.c	1.0.24	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -526,7 +526,6 @@ herculesplus_poll(priv_t priv)
 	if (dev->dispon) {
 		if (dev->displine < dev->firstline) {
 			dev->firstline = dev->displine;
-			video_blit_wait_buffer();
 		}
 		dev->lastline = dev->displine;
 
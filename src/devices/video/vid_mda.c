@@ -8,13 +8,13 @@
  *
  *		MDA emulation.
  *
- * Version:	@(#)vid_mda.c	1.0.18	2019/05/17
+ * Version:	@(#)vid_mda.c	1.0.19	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -185,7 +185,6 @@ mda_poll(priv_t priv)
 	if (dev->dispon) {
 		if (dev->displine < dev->firstline) {
 			dev->firstline = dev->displine;
-			video_blit_wait_buffer();
 		}
 		dev->lastline = dev->displine;
 
@@ -44,12 +44,12 @@
  *
  *		This is expected to be done shortly.
  *
- * Version:	@(#)vid_pgc.c	1.0.7	2019/05/17
+ * Version:	@(#)vid_pgc.c	1.0.8	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		John Elliott, <jce@seasip.info>
  *
- *		Copyright 2019 Fred N. van Kempen.
+ *		Copyright 2019-2026 Fred N. van Kempen.
  *		Copyright 2019 John Elliott.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -2317,9 +2317,6 @@ pgc_cga_poll(pgc_t *dev)
 	dev->linepos = 1;
 
 	if (dev->cgadispon) {
-		if (dev->displine == 0)
-			video_blit_wait_buffer();
-
 		if ((dev->mapram[0x03d8] & 0x12) == 0x12)
 			pgc_cga_gfx80(dev);	
 		else if (dev->mapram[0x03d8] & 0x02)
@@ -2400,9 +2397,6 @@ pgc_poll(priv_t priv)
 	dev->mapram[0x03da] |= 1;
 	dev->linepos = 1;
 	if (dev->cgadispon && (uint32_t)dev->displine < dev->maxh) {
-		if (dev->displine == 0)
-			video_blit_wait_buffer();
-
 		/* Don't know why pan needs to be multiplied by -2, but
 		 * the IM1024 driver uses PAN -112 for an offset of 
 		 * 224. */
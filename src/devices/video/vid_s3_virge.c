@@ -8,13 +8,13 @@
  *
  *		S3 ViRGE emulation.
  *
- * Version:	@(#)vid_s3_virge.c	1.0.25	2021/10/22
+ * Version:	@(#)vid_s3_virge.c	1.0.27	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2020 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -69,10 +69,38 @@ static int dither[4][4] =
         {7,  3,  6,  2},
 };
 
+/*The span and sampler templates must be inlined to be specialized*/
+#if defined(_MSC_VER)
+# define VIRGE_INLINE __forceinline
+#elif defined(__GNUC__)
+# define VIRGE_INLINE __inline __attribute__((always_inline))
+#else
+# define VIRGE_INLINE __inline
+#endif
+
 #define RB_SIZE 256
 #define RB_MASK (RB_SIZE - 1)
 
-#define RB_ENTRIES (virge->s3d_write_idx - virge->s3d_read_idx)
+/*
+ * Triangles are rendered by a pool of threads, all of which walk
+ * the whole ring buffer. Each thread draws only the scanlines in
+ * its own bands of VIRGE_BAND_LINES lines, so a slot is free once
+ * the slowest thread is done with it.
+ */
+#define VIRGE_MAX_THREADS 8
+#define VIRGE_BAND_SHIFT 3
+#define VIRGE_BAND_LINES (1 << VIRGE_BAND_SHIFT)
+
+/*The busy flags and ring indices are handed between threads, and some
+  checks need a store to be visible before a following load*/
+#ifdef _MSC_VER
+# include <intrin.h>
+# define s3d_fence() _mm_mfence()
+#else
+# define s3d_fence() __sync_synchronize()
+#endif
+
+#define RB_ENTRIES (virge->s3d_write_idx - s3d_read_idx_min(virge))
 #define RB_FULL (RB_ENTRIES == RB_SIZE)
 #define RB_EMPTY (!RB_ENTRIES)
 
@@ -164,6 +192,12 @@ typedef struct s3d_t
 	uint8_t fog_r, fog_g, fog_b;
 } s3d_t;
         
+typedef struct virge_render_ctx_t
+{
+        struct virge_t *virge;
+        int thread;
+} virge_render_ctx_t;
+
 typedef struct virge_t
 {
         mem_map_t   linear_mapping;
@@ -191,10 +225,12 @@ typedef struct virge_t
         int dithering_enabled;
         int memory_size;
         
-        int pixel_count, tri_count;
+        int pixel_count[VIRGE_MAX_THREADS], tri_count;
         
-        thread_t *render_thread;
-        event_t *wake_render_thread;
+        int render_threads;
+        virge_render_ctx_t render_ctx[VIRGE_MAX_THREADS];
+        thread_t *render_thread[VIRGE_MAX_THREADS];
+        event_t *wake_render_thread[VIRGE_MAX_THREADS];
         event_t *wake_main_thread;
         event_t *not_full_event;
         
@@ -249,8 +285,9 @@ typedef struct virge_t
         s3d_t s3d_tri;
 
         s3d_t s3d_buffer[RB_SIZE];
-        int s3d_read_idx, s3d_write_idx;
-        int s3d_busy;
+        volatile int s3d_read_idx[VIRGE_MAX_THREADS], s3d_write_idx;
+        volatile int s3d_busy[VIRGE_MAX_THREADS];
+        volatile int s3d_full_wait;
                 
         struct
         {
@@ -304,6 +341,31 @@ static video_timings_t timing_diamond_stealth3d_2000	= {VID_BUS, 2,  2,  3,  28,
 static video_timings_t timing_diamond_stealth3d_3000	= {VID_BUS, 2,  2,  4,  26, 26, 42};
 static video_timings_t timing_virge_dx			= {VID_BUS, 2,  2,  3,  28, 28, 45};
 
+/*Ring buffer slots are only free once every render thread is past them*/
+static __inline int s3d_read_idx_min(virge_t *virge)
+{
+        int c, idx = virge->s3d_read_idx[0];
+
+        for (c = 1; c < virge->render_threads; c++)
+        {
+                if ((virge->s3d_read_idx[c] - idx) < 0)
+                        idx = virge->s3d_read_idx[c];
+        }
+        return idx;
+}
+
+static __inline int s3d_is_busy(virge_t *virge)
+{
+        int c;
+
+        for (c = 0; c < virge->render_threads; c++)
+        {
+                if (virge->s3d_busy[c] || virge->s3d_read_idx[c] != virge->s3d_write_idx)
+                        return 1;
+        }
+        return 0;
+}
+
 static __inline void wake_fifo_thread(virge_t *virge)
 {
         thread_set_event(virge->wake_fifo_thread); /*Wake up FIFO thread if moving from idle*/
@@ -842,7 +904,7 @@ static uint8_t s3_virge_mmio_read(uint32_t addr, priv_t priv)
         switch (addr & 0xffff)
         {
                 case 0x8505:
-                if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+                if (s3d_is_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                         ret = 0x10;
                 else
                         ret = 0x10 | (1 << 5);
@@ -959,7 +1021,7 @@ static uint32_t s3_virge_mmio_read_l(uint32_t addr, priv_t priv)
                 break;
                 
                 case 0x8504:
-                if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+                if (s3d_is_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                         ret = (0x10 << 8);
                 else
                         ret = (0x10 << 8) | (1 << 13);
@@ -2439,9 +2501,9 @@ skip_line:
                                   r = (val & 0xff0000) >> 16
 
 #define RGB15(r, g, b, dest) \
-        if (virge->dithering_enabled)                           \
+        if (state->dither)                                      \
         {                                                       \
-                int add = dither[_y & 3][_x & 3];               \
+                int add = dither[state->y & 3][state->x & 3];   \
                 int _r = (r > 248) ? 248 : r+add;               \
                 int _g = (g > 248) ? 248 : g+add;               \
                 int _b = (b > 248) ? 248 : b+add;               \
@@ -2460,6 +2522,7 @@ typedef struct rgba_t
 typedef struct s3d_state_t
 {
         int32_t r, g, b, a, u, v, d, w;
+        int x;
 
         int32_t base_r, base_g, base_b, base_a, base_u, base_v, base_d, base_w;
         
@@ -2478,8 +2541,20 @@ typedef struct s3d_state_t
         int y;
         
         rgba_t dest_rgba;
+
+        void (*tex_sample)(struct s3d_state_t *state);
+        int dither;
+        int thread, threads;
+        int pixel_count;
 } s3d_state_t;
 
+/*Render thread that draws a band. Lines can be negative, so this is a floor
+  modulo*/
+static __inline int s3d_band_thread(s3d_state_t *state, int band)
+{
+        return ((band % state->threads) + state->threads) % state->threads;
+}
+
 typedef struct s3d_texture_state_t
 {
         int level;
@@ -2488,16 +2563,13 @@ typedef struct s3d_texture_state_t
         int32_t u, v;
 } s3d_texture_state_t;
 
-static void (*tex_read)(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
-static void (*tex_sample)(s3d_state_t *state);
-static void (*dest_pixel)(s3d_state_t *state);
+typedef void (*tex_read_t)(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
+typedef void (*tex_sample_t)(s3d_state_t *state);
 
 //#define MAX(a, b) ((a) > (b) ? (a) : (b))
 //#define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-static int _x, _y;
-
-static void tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+static VIRGE_INLINE void tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
         int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
                      (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
@@ -2509,7 +2581,7 @@ static void tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state,
         out->a = (val & 0x8000) ? 0xff : 0;
 }
 
-static void tex_ARGB1555_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+static VIRGE_INLINE void tex_ARGB1555_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
         int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
                      (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
@@ -2524,7 +2596,7 @@ static void tex_ARGB1555_nowrap(s3d_state_t *state, s3d_texture_state_t *texture
         out->a = (val & 0x8000) ? 0xff : 0;
 }
 
-static void tex_ARGB4444(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+static VIRGE_INLINE void tex_ARGB4444(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
         int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
                      (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
@@ -2536,7 +2608,7 @@ static void tex_ARGB4444(s3d_state_t *state, s3d_texture_state_t *texture_state,
         out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
 }
 
-static void tex_ARGB4444_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+static VIRGE_INLINE void tex_ARGB4444_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
         int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
                      (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
@@ -2551,7 +2623,7 @@ static void tex_ARGB4444_nowrap(s3d_state_t *state, s3d_texture_state_t *texture
         out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
 }
 
-static void tex_ARGB8888(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+static VIRGE_INLINE void tex_ARGB8888(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
         int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
                      (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
@@ -2562,7 +2634,7 @@ static void tex_ARGB8888(s3d_state_t *state, s3d_texture_state_t *texture_state,
         out->b =  val        & 0xff;
         out->a = (val >> 24) & 0xff;
 }
-static void tex_ARGB8888_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+static VIRGE_INLINE void tex_ARGB8888_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
         int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
                      (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
@@ -2577,7 +2649,7 @@ static void tex_ARGB8888_nowrap(s3d_state_t *state, s3d_texture_state_t *texture
         out->a = (val >> 24) & 0xff;
 }
 
-static void tex_sample_normal(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_normal_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         
@@ -2589,7 +2661,7 @@ static void tex_sample_normal(s3d_state_t *state)
         tex_read(state, &texture_state, &state->dest_rgba);
 }
 
-static void tex_sample_normal_filter(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_normal_filter_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int tex_offset;
@@ -2630,7 +2702,7 @@ static void tex_sample_normal_filter(s3d_state_t *state)
         state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] + tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
 }
 
-static void tex_sample_mipmap(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_mipmap_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
 
@@ -2644,7 +2716,7 @@ static void tex_sample_mipmap(s3d_state_t *state)
         tex_read(state, &texture_state, &state->dest_rgba);
 }
 
-static void tex_sample_mipmap_filter(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_mipmap_filter_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int tex_offset;
@@ -2687,7 +2759,7 @@ static void tex_sample_mipmap_filter(s3d_state_t *state)
         state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] + tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
 }
 
-static void tex_sample_persp_normal(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_normal_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0;
@@ -2703,7 +2775,7 @@ static void tex_sample_persp_normal(s3d_state_t *state)
         tex_read(state, &texture_state, &state->dest_rgba);
 }
 
-static void tex_sample_persp_normal_filter(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_normal_filter_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0, u, v;
@@ -2751,7 +2823,7 @@ static void tex_sample_persp_normal_filter(s3d_state_t *state)
         state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] + tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
 }
 
-static void tex_sample_persp_normal_375(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_normal_375_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0;
@@ -2767,7 +2839,7 @@ static void tex_sample_persp_normal_375(s3d_state_t *state)
         tex_read(state, &texture_state, &state->dest_rgba);
 }
 
-static void tex_sample_persp_normal_filter_375(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_normal_filter_375_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0, u, v;
@@ -2816,7 +2888,7 @@ static void tex_sample_persp_normal_filter_375(s3d_state_t *state)
 }
 
 
-static void tex_sample_persp_mipmap(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_mipmap_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0;
@@ -2834,7 +2906,7 @@ static void tex_sample_persp_mipmap(s3d_state_t *state)
         tex_read(state, &texture_state, &state->dest_rgba);
 }
 
-static void tex_sample_persp_mipmap_filter(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_mipmap_filter_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0, u, v;
@@ -2884,7 +2956,7 @@ static void tex_sample_persp_mipmap_filter(s3d_state_t *state)
         state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] + tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
 }
 
-static void tex_sample_persp_mipmap_375(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_mipmap_375_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0;
@@ -2902,7 +2974,7 @@ static void tex_sample_persp_mipmap_375(s3d_state_t *state)
         tex_read(state, &texture_state, &state->dest_rgba);
 }
 
-static void tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
+static VIRGE_INLINE void tex_sample_persp_mipmap_filter_375_t(s3d_state_t *state, tex_read_t tex_read)
 {
         s3d_texture_state_t texture_state;
         int32_t w = 0, u, v;
@@ -2952,6 +3024,77 @@ static void tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
         state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] + tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
 }
 
+/*
+ * Samplers specialized for each texture format, so the texel
+ * fetches are inlined instead of going through a pointer.
+ */
+enum
+{
+        SAMPLE_NORMAL = 0,
+        SAMPLE_NORMAL_FILTER,
+        SAMPLE_MIPMAP,
+        SAMPLE_MIPMAP_FILTER,
+        SAMPLE_PERSP_NORMAL,
+        SAMPLE_PERSP_NORMAL_FILTER,
+        SAMPLE_PERSP_NORMAL_375,
+        SAMPLE_PERSP_NORMAL_FILTER_375,
+        SAMPLE_PERSP_MIPMAP,
+        SAMPLE_PERSP_MIPMAP_FILTER,
+        SAMPLE_PERSP_MIPMAP_375,
+        SAMPLE_PERSP_MIPMAP_FILTER_375,
+        SAMPLE_MAX
+};
+
+#define TEX_SAMPLER(mode, fmt)                                                  \
+        static void tex_sample_ ## mode ## _ ## fmt(s3d_state_t *state)         \
+        {                                                                       \
+                tex_sample_ ## mode ## _t(state, tex_ ## fmt);                  \
+        }
+
+#define TEX_SAMPLERS(fmt)                                                       \
+        TEX_SAMPLER(normal, fmt)                                                \
+        TEX_SAMPLER(normal_filter, fmt)                                         \
+        TEX_SAMPLER(mipmap, fmt)                                                \
+        TEX_SAMPLER(mipmap_filter, fmt)                                         \
+        TEX_SAMPLER(persp_normal, fmt)                                          \
+        TEX_SAMPLER(persp_normal_filter, fmt)                                   \
+        TEX_SAMPLER(persp_normal_375, fmt)                                      \
+        TEX_SAMPLER(persp_normal_filter_375, fmt)                               \
+        TEX_SAMPLER(persp_mipmap, fmt)                                          \
+        TEX_SAMPLER(persp_mipmap_filter, fmt)                                   \
+        TEX_SAMPLER(persp_mipmap_375, fmt)                                      \
+        TEX_SAMPLER(persp_mipmap_filter_375, fmt)                               \
+        static const tex_sample_t tex_samplers_ ## fmt[SAMPLE_MAX] =            \
+        {                                                                       \
+                tex_sample_normal_ ## fmt,                                      \
+                tex_sample_normal_filter_ ## fmt,                               \
+                tex_sample_mipmap_ ## fmt,                                      \
+                tex_sample_mipmap_filter_ ## fmt,                               \
+                tex_sample_persp_normal_ ## fmt,                                \
+                tex_sample_persp_normal_filter_ ## fmt,                         \
+                tex_sample_persp_normal_375_ ## fmt,                            \
+                tex_sample_persp_normal_filter_375_ ## fmt,                     \
+                tex_sample_persp_mipmap_ ## fmt,                                \
+                tex_sample_persp_mipmap_filter_ ## fmt,                         \
+                tex_sample_persp_mipmap_375_ ## fmt,                            \
+                tex_sample_persp_mipmap_filter_375_ ## fmt                      \
+        };
+
+TEX_SAMPLERS(ARGB8888)
+TEX_SAMPLERS(ARGB8888_nowrap)
+TEX_SAMPLERS(ARGB4444)
+TEX_SAMPLERS(ARGB4444_nowrap)
+TEX_SAMPLERS(ARGB1555)
+TEX_SAMPLERS(ARGB1555_nowrap)
+
+/*Indexed by texture format * 2, plus 1 if texture wrapping is disabled*/
+static const tex_sample_t *tex_samplers[6] =
+{
+        tex_samplers_ARGB8888, tex_samplers_ARGB8888_nowrap,
+        tex_samplers_ARGB4444, tex_samplers_ARGB4444_nowrap,
+        tex_samplers_ARGB1555, tex_samplers_ARGB1555_nowrap
+};
+
 
 #define CLAMP(x) do                                     \
         {                                               \
@@ -2987,7 +3130,7 @@ static void tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
         }                               \
         while (0)
 
-static void dest_pixel_gouraud_shaded_triangle(s3d_state_t *state)
+static VIRGE_INLINE void dest_pixel_gouraud_shaded_triangle(s3d_state_t *state)
 {
         state->dest_rgba.r = state->r >> 7;
         CLAMP(state->dest_rgba.r);
@@ -3002,25 +3145,25 @@ static void dest_pixel_gouraud_shaded_triangle(s3d_state_t *state)
         CLAMP(state->dest_rgba.a);
 }
 
-static void dest_pixel_unlit_texture_triangle(s3d_state_t *state)
+static VIRGE_INLINE void dest_pixel_unlit_texture_triangle(s3d_state_t *state)
 {
-        tex_sample(state);
+        state->tex_sample(state);
 
         if (state->cmd_set & CMD_SET_ABC_SRC)
                 state->dest_rgba.a = state->a >> 7;
 }
 
-static void dest_pixel_lit_texture_decal(s3d_state_t *state)
+static VIRGE_INLINE void dest_pixel_lit_texture_decal(s3d_state_t *state)
 {
-        tex_sample(state);
+        state->tex_sample(state);
 
         if (state->cmd_set & CMD_SET_ABC_SRC)
                 state->dest_rgba.a = state->a >> 7;
 }
 
-static void dest_pixel_lit_texture_reflection(s3d_state_t *state)
+static VIRGE_INLINE void dest_pixel_lit_texture_reflection(s3d_state_t *state)
 {
-        tex_sample(state);
+        state->tex_sample(state);
 
         state->dest_rgba.r += (state->r >> 7);
         state->dest_rgba.g += (state->g >> 7);
@@ -3031,11 +3174,11 @@ static void dest_pixel_lit_texture_reflection(s3d_state_t *state)
         CLAMP_RGBA(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, state->dest_rgba.a);
 }
 
-static void dest_pixel_lit_texture_modulate(s3d_state_t *state)
+static VIRGE_INLINE void dest_pixel_lit_texture_modulate(s3d_state_t *state)
 {
         int r = state->r >> 7, g = state->g >> 7, b = state->b >> 7, a = state->a >> 7;
         
-        tex_sample(state);
+        state->tex_sample(state);
         
         CLAMP_RGBA(r, g, b, a);
         
@@ -3047,7 +3190,17 @@ static void dest_pixel_lit_texture_modulate(s3d_state_t *state)
                 state->dest_rgba.a = a;
 }
 
-static void tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2)
+enum
+{
+        DEST_GOURAUD = 0,
+        DEST_UNLIT_TEXTURE,
+        DEST_LIT_DECAL,
+        DEST_LIT_REFLECTION,
+        DEST_LIT_MODULATE
+};
+
+/*Draw the lines of a half triangle that are in this thread's bands*/
+static VIRGE_INLINE void tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2, const int dest_mode)
 {
 	svga_t *svga = &virge->svga;
         uint8_t *vram = svga->vram;
@@ -3113,6 +3266,9 @@ static void tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int3
         
         for (; y_count > 0; y_count--)
         {
+                if (s3d_band_thread(state, state->y >> VIRGE_BAND_SHIFT) != state->thread)
+                        goto tri_skip_line;
+
                 x  = (state->x1 + ((1 << 20) - 1)) >> 20;
                 xe = (state->x2 + ((1 << 20) - 1)) >> 20;
                 z = (state->base_z > 0) ? (state->base_z << 1) : 0;
@@ -3204,7 +3360,7 @@ static void tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int3
                         for (; x != xe; x = (x + x_dir) & 0xfff)
                         {
                                 update = 1;
-                                _x = x; _y = state->y;
+                                state->x = x;
 
                                 if (use_z)
                                 {
@@ -3216,7 +3372,24 @@ static void tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int3
                                 {
                                         uint32_t dest_col;
 
-                                        dest_pixel(state);
+                                        switch (dest_mode)
+                                        {
+                                                case DEST_GOURAUD:
+                                                dest_pixel_gouraud_shaded_triangle(state);
+                                                break;
+                                                case DEST_UNLIT_TEXTURE:
+                                                dest_pixel_unlit_texture_triangle(state);
+                                                break;
+                                                case DEST_LIT_DECAL:
+                                                dest_pixel_lit_texture_decal(state);
+                                                break;
+                                                case DEST_LIT_REFLECTION:
+                                                dest_pixel_lit_texture_reflection(state);
+                                                break;
+                                                case DEST_LIT_MODULATE:
+                                                dest_pixel_lit_texture_modulate(state);
+                                                break;
+                                        }
 					
 					if (s3d_tri->cmd_set & CMD_SET_FE) {
                                                 int a = state->a >> 7;
@@ -3277,7 +3450,7 @@ static void tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int3
                                 state->w += s3d_tri->TdWdX;
                                 dest_addr += x_offset;
                                 z_addr += xz_offset;
-                                virge->pixel_count++;
+                                state->pixel_count++;
                         }
                 }
 tri_skip_line:
@@ -3298,6 +3471,20 @@ tri_skip_line:
         }
 }
 
+#define TRI_FUNC(name, mode)                                                                    \
+        static void tri_ ## name(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state,            \
+                                 int yc, int32_t dx1, int32_t dx2)                              \
+        {                                                                                       \
+                tri(virge, s3d_tri, state, yc, dx1, dx2, mode);                                 \
+        }
+
+/*Span functions for each shading mode*/
+TRI_FUNC(gouraud, DEST_GOURAUD)
+TRI_FUNC(unlit_texture, DEST_UNLIT_TEXTURE)
+TRI_FUNC(lit_decal, DEST_LIT_DECAL)
+TRI_FUNC(lit_reflection, DEST_LIT_REFLECTION)
+TRI_FUNC(lit_modulate, DEST_LIT_MODULATE)
+
 static int tex_size[8] =
 {
         4*2,
@@ -3310,12 +3497,13 @@ static int tex_size[8] =
         1*2
 };
 
-static void s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
+static void s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri, int thread)
 {
         s3d_state_t state;
+        void (*tri_func)(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2);
 
         uint32_t tex_base;
-        int c;
+        int c, sample, format;
 
         uint64_t start_time = plat_timer_read();
         uint64_t end_time;
@@ -3338,6 +3526,11 @@ static void s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
         state.base_a = (int32_t)s3d_tri->tas;
         state.base_d = s3d_tri->tds;
         state.base_w = s3d_tri->tws;
+
+        state.dither = virge->dithering_enabled;
+        state.thread = thread;
+        state.threads = virge->render_threads;
+        state.pixel_count = 0;
         
         tex_base = s3d_tri->tex_base;
         for (c = 9; c >= 0; c--)
@@ -3350,20 +3543,20 @@ static void s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
         switch ((s3d_tri->cmd_set >> 27) & 0xf)
         {
                 case 0:
-                dest_pixel = dest_pixel_gouraud_shaded_triangle;
+                tri_func = tri_gouraud;
                 break;
                 case 1:
                 case 5:
                 switch ((s3d_tri->cmd_set >> 15) & 0x3)
                 {
                         case 0:
-                        dest_pixel = dest_pixel_lit_texture_reflection;
+                        tri_func = tri_lit_reflection;
                         break;
                         case 1:
-                        dest_pixel = dest_pixel_lit_texture_modulate;
+                        tri_func = tri_lit_modulate;
                         break;
                         case 2:
-                        dest_pixel = dest_pixel_lit_texture_decal;
+                        tri_func = tri_lit_decal;
                         break;
                         default:
                         s3_virge_log("bad triangle type %x\n", (s3d_tri->cmd_set >> 27) & 0xf);
@@ -3372,7 +3565,7 @@ static void s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
                 break;
                 case 2:
                 case 6:
-                dest_pixel = dest_pixel_unlit_texture_triangle;
+                tri_func = tri_unlit_texture;
                 break;
                 default:
                 s3_virge_log("bad triangle type %x\n", (s3d_tri->cmd_set >> 27) & 0xf);
@@ -3382,109 +3575,134 @@ static void s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
         switch (((s3d_tri->cmd_set >> 12) & 7) | ((s3d_tri->cmd_set & (1 << 29)) ? 8 : 0))
         {
                 case 0: case 1:
-                tex_sample = tex_sample_mipmap;
+                sample = SAMPLE_MIPMAP;
                 break;
                 case 2: case 3:
-                tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
+                sample = virge->bilinear_enabled ? SAMPLE_MIPMAP_FILTER : SAMPLE_MIPMAP;
                 break;
                 case 4: case 5:
-                tex_sample = tex_sample_normal;
+                sample = SAMPLE_NORMAL;
                 break;
                 case 6: case 7:
-                tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
+                sample = virge->bilinear_enabled ? SAMPLE_NORMAL_FILTER : SAMPLE_NORMAL;
                 break;
                 case (0 | 8): case (1 | 8):
                 if (virge->chip == S3_VIRGEDX)
-                        tex_sample = tex_sample_persp_mipmap_375;
+                        sample = SAMPLE_PERSP_MIPMAP_375;
                 else
-                        tex_sample = tex_sample_persp_mipmap;
+                        sample = SAMPLE_PERSP_MIPMAP;
                 break;
                 case (2 | 8): case (3 | 8):
                 if (virge->chip == S3_VIRGEDX)
-                        tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 : tex_sample_persp_mipmap_375;
+                        sample = virge->bilinear_enabled ? SAMPLE_PERSP_MIPMAP_FILTER_375 : SAMPLE_PERSP_MIPMAP_375;
                 else
-                        tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter : tex_sample_persp_mipmap;
+                        sample = virge->bilinear_enabled ? SAMPLE_PERSP_MIPMAP_FILTER : SAMPLE_PERSP_MIPMAP;
                 break;
                 case (4 | 8): case (5 | 8):
                 if (virge->chip == S3_VIRGEDX)
-                        tex_sample = tex_sample_persp_normal_375;
+                        sample = SAMPLE_PERSP_NORMAL_375;
                 else
-                        tex_sample = tex_sample_persp_normal;
+                        sample = SAMPLE_PERSP_NORMAL;
                 break;
                 case (6 | 8): case (7 | 8):
+                default:
                 if (virge->chip == S3_VIRGEDX)
-                        tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 : tex_sample_persp_normal_375;
+                        sample = virge->bilinear_enabled ? SAMPLE_PERSP_NORMAL_FILTER_375 : SAMPLE_PERSP_NORMAL_375;
                 else
-                        tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter : tex_sample_persp_normal;
+                        sample = virge->bilinear_enabled ? SAMPLE_PERSP_NORMAL_FILTER : SAMPLE_PERSP_NORMAL;
                 break;
         }
         
         switch ((s3d_tri->cmd_set >> 5) & 7)
         {
                 case 0:
-                tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
+                format = 0;
                 break;
                 case 1:
-                tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
+                format = 2;
                 break;
                 case 2:
-                tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+                format = 4;
                 break;
                 default:
-                s3_virge_log("bad texture type %i\n", (s3d_tri->cmd_set >> 5) & 7);
-                tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+                if (!thread)
+                        s3_virge_log("bad texture type %i\n", (s3d_tri->cmd_set >> 5) & 7);
+                format = 4;
                 break;
         }
+        if (!(s3d_tri->cmd_set & CMD_SET_TWE))
+                format++;
+        state.tex_sample = tex_samplers[format][sample];
 
         state.y  = s3d_tri->tys;
         state.x1 = s3d_tri->txs;
         state.x2 = s3d_tri->txend01;
-        tri(virge, s3d_tri, &state, s3d_tri->ty01, s3d_tri->TdXdY02, s3d_tri->TdXdY01);
+        tri_func(virge, s3d_tri, &state, s3d_tri->ty01, s3d_tri->TdXdY02, s3d_tri->TdXdY01);
         state.x2 = s3d_tri->txend12;
-        tri(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
+        tri_func(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
 
-        virge->tri_count++;
+        virge->pixel_count[thread] += state.pixel_count;
+        if (!thread)
+        {
+                virge->tri_count++;
 
-        end_time = plat_timer_read();
+                end_time = plat_timer_read();
         
-        virge_time += end_time - start_time;
+                virge_time += end_time - start_time;
+        }
 }
 
 static void render_thread(void *param)
 {
-        virge_t *virge = (virge_t *)param;
+        virge_t *virge = ((virge_render_ctx_t *)param)->virge;
+        int thread = ((virge_render_ctx_t *)param)->thread;
         
         while (1)
         {
-                thread_wait_event(virge->wake_render_thread, -1);
-                thread_reset_event(virge->wake_render_thread);
-                virge->s3d_busy = 1;
-                while (!RB_EMPTY)
+                thread_wait_event(virge->wake_render_thread[thread], -1);
+                thread_reset_event(virge->wake_render_thread[thread]);
+                virge->s3d_busy[thread] = 1;
+                while (virge->s3d_read_idx[thread] != virge->s3d_write_idx)
                 {
-                        s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx & RB_MASK]);
-                        virge->s3d_read_idx++;
+                        s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx[thread] & RB_MASK], thread);
+                        virge->s3d_read_idx[thread]++;
                         
-                        if (RB_ENTRIES == RB_SIZE - 1)
+                        if (virge->s3d_full_wait)
                                 thread_set_event(virge->not_full_event);
                 }
-                virge->s3d_busy = 0;
-                virge->subsys_stat |= INT_S3D_DONE;
-                s3_virge_update_irqs(virge);
+                virge->s3d_busy[thread] = 0;
+
+                /*Without the fence, two threads finishing together could
+                  each still see the other busy, and nobody raises the IRQ*/
+                s3d_fence();
+                if (!s3d_is_busy(virge))
+                {
+                        virge->subsys_stat |= INT_S3D_DONE;
+                        s3_virge_update_irqs(virge);
+                }
         }
 }
 
 static void queue_triangle(virge_t *virge)
 {
-        if (RB_FULL)
+        int c;
+
+        while (RB_FULL)
         {
+                virge->s3d_full_wait = 1;
                 thread_reset_event(virge->not_full_event);
                 if (RB_FULL)
-                        thread_wait_event(virge->not_full_event, -1); /*Wait for room in ringbuffer*/
+                        thread_wait_event(virge->not_full_event, 1); /*Wait for room in ringbuffer*/
         }
+        virge->s3d_full_wait = 0;
         virge->s3d_buffer[virge->s3d_write_idx & RB_MASK] = virge->s3d_tri;
         virge->s3d_write_idx++;
-        if (!virge->s3d_busy)
-                thread_set_event(virge->wake_render_thread); /*Wake up render thread if moving from idle*/
+        s3d_fence();
+        for (c = 0; c < virge->render_threads; c++)
+        {
+                if (!virge->s3d_busy[c])
+                        thread_set_event(virge->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
+        }
 }
 
 static void s3_virge_hwcursor_draw(svga_t *svga, int displine)
@@ -3947,12 +4165,16 @@ static priv_t
 s3_virge_init(const device_t *info, UNUSED(void *parent))
 {
     virge_t *virge;
+    int c;
 
     virge = (virge_t *)mem_alloc(sizeof(virge_t));
     memset(virge, 0, sizeof(virge_t));
 
     virge->bilinear_enabled = device_get_config_int("bilinear");
     virge->dithering_enabled = device_get_config_int("dithering");
+    virge->render_threads = device_get_config_int("render_threads");
+    if (virge->render_threads < 1 || virge->render_threads > VIRGE_MAX_THREADS)
+	virge->render_threads = 1;
     virge->memory_size = device_get_config_int("memory");
 
     svga_init(&virge->svga, virge, virge->memory_size << 20,
@@ -4048,10 +4270,14 @@ s3_virge_init(const device_t *info, UNUSED(void *parent))
         virge->card = pci_add_card(PCI_ADD_VIDEO,
 				   s3_virge_pci_read,s3_virge_pci_write, virge);
 
-    virge->wake_render_thread = thread_create_event();
     virge->wake_main_thread = thread_create_event();
     virge->not_full_event = thread_create_event();
-    virge->render_thread = thread_create(render_thread, virge);
+    for (c = 0; c < virge->render_threads; c++) {
+	virge->render_ctx[c].virge = virge;
+	virge->render_ctx[c].thread = c;
+	virge->wake_render_thread[c] = thread_create_event();
+	virge->render_thread[c] = thread_create(render_thread, &virge->render_ctx[c]);
+    }
 
     virge->wake_fifo_thread = thread_create_event();
     virge->fifo_not_full_event = thread_create_event();
@@ -4068,11 +4294,14 @@ static void
 s3_virge_close(priv_t priv)
 {
     virge_t *virge = (virge_t *)priv;
+    int c;
 
-    thread_kill(virge->render_thread);
+    for (c = 0; c < virge->render_threads; c++) {
+	thread_kill(virge->render_thread[c]);
+	thread_destroy_event(virge->wake_render_thread[c]);
+    }
     thread_destroy_event(virge->not_full_event);
     thread_destroy_event(virge->wake_main_thread);
-    thread_destroy_event(virge->wake_render_thread);
 
     thread_kill(virge->fifo_thread);
     thread_destroy_event(virge->wake_fifo_thread);
@@ -4127,6 +4356,26 @@ static const device_config_t s3_virge_config[] =
         {
                 "dithering", "Dithering", CONFIG_BINARY, "", 1
         },
+        {
+                "render_threads", "Render threads", CONFIG_SELECTION, "", 2,
+                {
+                        {
+                                "1", 1
+                        },
+                        {
+                                "2", 2
+                        },
+                        {
+                                "4", 4
+                        },
+                        {
+                                "8", 8
+                        },
+                        {
+                                NULL
+                        }
+                }
+        },
         {
                 NULL
         }
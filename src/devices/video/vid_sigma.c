@@ -54,7 +54,7 @@
  *		is well, but some strange mishaps with cursor positioning
  *		occur.
  *
- * Version:	@(#)vid_sigma.c	1.0.12	2019/05/21
+ * Version:	@(#)vid_sigma.c	1.0.13	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -520,7 +520,6 @@ sigma_poll(priv_t priv)
 	if (dev->cgadispon) {
 		if (dev->displine < dev->firstline) {
 			dev->firstline = dev->displine;
-			video_blit_wait_buffer();
 		}
 		dev->lastline = dev->displine;
 
@@ -11,14 +11,14 @@
  *		This is intended to be used by another VGA/SVGA driver,
  *		and not as a card in it's own right.
  *
- * Version:	@(#)vid_svga.c	1.0.31	2021/09/30
+ * Version:	@(#)vid_svga.c	1.0.32	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		TheCollector1995, <mariogplayer@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2021 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -650,7 +650,6 @@ svga_poll(priv_t priv)
 		svga->ma &= svga->vram_display_mask;
 		if (svga->firstline == 2000) {
 			svga->firstline = svga->displine;
-			video_blit_wait_buffer();
 		}
 
 		if (svga->hwcursor_on || svga->dac_hwcursor_on  || svga->overlay_on) {
@@ -1325,10 +1324,18 @@ svga_doblit(int y1, int y2, int wx, int wy, svga_t *svga)
 
 	if (video_force_resize_get())
 		video_force_resize_set(0);
+
+	video_damage_all();
     }
 
     if (enable_overscan && !suppress_overscan) {
 	if ((wx >= 160) && ((wy + 1) >= 120)) {
+		/* The border is not in the damage list, redo it all. */
+		if (svga->overscan_color != svga->overscan_drawn) {
+			svga->overscan_drawn = svga->overscan_color;
+			video_damage_all();
+		}
+
 		/* Draw (overscan_size - scroll size) lines of overscan on top. */
 		for (i  = 0; i < (y_add >> 1); i++) {
 			for (j = 0; j < (xsize + x_add); j++)
@@ -8,13 +8,13 @@
  *
  *		Definitions for the generic SVGA driver.
  *
- * Version:	@(#)vid_svga.h	1.0.13	2021/09/21
+ * Version:	@(#)vid_svga.h	1.0.14	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2021 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -104,7 +104,7 @@ typedef struct svga_t
 	     extra_banks[2],
 	     banked_mask,
 	     ca, ca_adj, 
-	     overscan_color,
+	     overscan_color, overscan_drawn,
 	     *map8, pallook[512];
 
     latch_t latch;
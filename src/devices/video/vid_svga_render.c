@@ -8,13 +8,13 @@
  *
  *		SVGA renderers.
  *
- * Version:	@(#)vid_svga_render.c	1.0.20	2021/10/21
+ * Version:	@(#)vid_svga_render.c	1.0.21	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2020 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -48,6 +48,40 @@
 #include "vid_svga_render.h"
 #include "vid_svga_render_remap.h"
 
+
+/*
+ * Note that the current line was drawn, and tell the blitter
+ * which part of it changed.
+ *
+ * If we know how many bits of VRAM make up a pixel, and the
+ * line lies within the two pages the renderer checked, only
+ * the part in the page(s) that actually changed is reported.
+ */
+static void
+line_drawn(svga_t *svga, int x, uint32_t addr, int bits)
+{
+    int y_add = enable_overscan ? (overscan_y >> 1) : 0;
+    int x1 = x, x2 = x + svga->hdisp + 16;
+    int bytes;
+
+    if (svga->firstline_draw == 2000)
+	svga->firstline_draw = svga->displine;
+    svga->lastline_draw = svga->displine;
+
+    if (bits && !svga->fullchange && !svga->remap_required &&
+	((addr & 0x0fff) + (((svga->hdisp + 16) * bits) >> 3)) <= 0x2000) {
+	/* Bytes of this line in the first page. */
+	bytes = 0x1000 - (addr & 0x0fff);
+
+	if (! svga->changedvram[(addr >> 12) + 1])
+		x2 = MIN(x2, x + (((bytes << 3) + bits - 1) / bits));
+	else if (! svga->changedvram[addr >> 12])
+		x1 = x + ((bytes << 3) / bits);
+    }
+
+    video_damage_line(svga->displine + y_add, x1, x2);
+}
+
 void 
 svga_render_null(svga_t *svga)
 {
@@ -63,9 +97,7 @@ svga_render_blank(svga_t *svga)
     int x_add = enable_overscan ? 8 : 0;
     int x, xx;
 
-    if (svga->firstline_draw == 2000) 
-	svga->firstline_draw = svga->displine;
-    svga->lastline_draw = svga->displine;
+    line_drawn(svga, 32 + x_add, 0, 0);
 	
     for (x = 0; x < svga->hdisp; x++) switch (svga->seqregs[1] & 9) {
 	case 0:
@@ -110,6 +142,8 @@ svga_render_text_40(svga_t *svga)
     if (svga->fullchange) {
 	p = &screen->line[svga->displine + y_add][32 + x_add];
 
+	line_drawn(svga, 32 + x_add, 0, 0);
+
 	for (x = 0; x < svga->hdisp; x += xinc) {
 		uint32_t addr = svga->remap_func(svga, svga->ma) & svga->vram_display_mask;
 		drawcursor = ((svga->ma == svga->ca) && svga->con && svga->cursoron);
@@ -174,6 +208,8 @@ svga_render_text_80(svga_t *svga)
     if (svga->fullchange) {
 	p = &screen->line[svga->displine + y_add][32 + x_add];
 
+	line_drawn(svga, 32 + x_add, 0, 0);
+
 	for (x = 0; x < svga->hdisp; x += xinc) {
 		uint32_t addr = svga->remap_func(svga, svga->ma) & svga->vram_display_mask;
 		drawcursor = ((svga->ma == svga->ca) && svga->con && svga->cursoron);
@@ -240,6 +276,8 @@ svga_render_text_80_ksc5601(svga_t *svga)
     if (svga->fullchange) {
 	p = &screen->line[svga->displine + y_add][32 + x_add];
 
+	line_drawn(svga, 32 + x_add, 0, 0);
+
 	for (x = 0; x < svga->hdisp; x += xinc) {
 		uint32_t addr = svga->remap_func(svga, svga->ma) & svga->vram_display_mask;
 		drawcursor = ((svga->ma == svga->ca) && svga->con && svga->cursoron);
@@ -357,9 +395,7 @@ svga_render_2bpp_lowres(svga_t *svga)
 	offset = ((8 - svga->scrollcache) << 1) + 16;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 		
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 		       
 	for (x = 0; x <= svga->hdisp; x += 16) {
 		uint32_t addr = svga->remap_func(svga, svga->ma);
@@ -399,9 +435,7 @@ svga_render_2bpp_highres(svga_t *svga)
 	offset = (8 - svga->scrollcache) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 4);
 
 	for (x = 0; x <= svga->hdisp; x += 8) {
 		uint32_t addr = svga->remap_func(svga, svga->ma);
@@ -438,9 +472,7 @@ svga_render_4bpp_lowres(svga_t *svga)
 	offset = ((8 - svga->scrollcache) << 1) + 16;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 	for (x = 0; x <= svga->hdisp; x += 16) {
 		uint32_t addr = svga->remap_func(svga, svga->ma);
@@ -483,9 +515,7 @@ svga_render_4bpp_highres(svga_t *svga)
 	offset = (8 - svga->scrollcache) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 4);
 
 	for (x = 0; x <= svga->hdisp; x += 8) {
 		uint32_t addr = svga->remap_func(svga, svga->ma);
@@ -524,9 +554,7 @@ svga_render_8bpp_lowres(svga_t *svga)
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 8) {
@@ -565,8 +593,8 @@ svga_render_8bpp_highres(svga_t *svga)
 {
     int y_add = enable_overscan ? (overscan_y >> 1) : 0;
     int x_add = enable_overscan ? 8 : 0;
-    int offset, x;
-    uint32_t dat;
+    int offset, x, n;
+    uint32_t dat, addr;
     pel_t *p;
     uint32_t changed_addr = svga->remap_func(svga, svga->ma);
 
@@ -574,11 +602,15 @@ svga_render_8bpp_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000)
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 8);
 
-	if (!svga->remap_required) {
+	/* If the line does not wrap, convert it in one go. */
+	n = ((svga->hdisp >> 3) + 1) << 3;
+	addr = svga->ma & svga->vram_display_mask;
+	if (!svga->remap_required && (addr + n) <= (svga->vram_display_mask + 1)) {
+		video_pel_8to32(p, &svga->vram[addr], svga->pallook, n);
+		svga->ma += n;
+	} else if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 8) {
 			dat = *(uint32_t *)(&svga->vram[svga->ma & svga->vram_display_mask]);
 			p++->val = svga->pallook[dat & 0xff];
@@ -625,9 +657,7 @@ void svga_render_8bpp_gs_lowres(svga_t *svga) /* FIXME */
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 8) {
@@ -673,9 +703,7 @@ void svga_render_8bpp_gs_highres(svga_t *svga) /* FIXME */
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000)
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 8);
 
 	if (!svga->remap_required) {	
 		for (x = 0; x <= svga->hdisp; x += 8) {
@@ -725,9 +753,7 @@ void svga_render_8bpp_rgb_lowres(svga_t *svga)
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 		if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 8) {
@@ -773,9 +799,7 @@ void svga_render_8bpp_rgb_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 8);
 
 	if (!svga->remap_required) {	
 		for (x = 0; x <= svga->hdisp; x += 8) {
@@ -825,9 +849,7 @@ svga_render_15bpp_lowres(svga_t *svga)
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 	
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
  
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 4) {
@@ -864,7 +886,7 @@ svga_render_15bpp_highres(svga_t *svga)
 {
     int y_add = enable_overscan ? (overscan_y >> 1) : 0;
     int x_add = enable_overscan ? 8 : 0;
-    int offset, x;
+    int offset, x, n;
     uint32_t dat, addr;
     pel_t *p;
     uint32_t changed_addr = svga->remap_func(svga, svga->ma);
@@ -873,11 +895,15 @@ svga_render_15bpp_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 16);
 
-	if (!svga->remap_required) {
+	/* If the line does not wrap, convert it in one go. */
+	n = ((svga->hdisp >> 3) + 1) << 3;
+	addr = svga->ma & svga->vram_display_mask;
+	if (!svga->remap_required && (addr + (n << 1)) <= (svga->vram_display_mask + 1)) {
+		video_pel_15to32(p, &svga->vram[addr], n);
+		svga->ma += n << 1;
+	} else if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 8) {
 			dat = *(uint32_t *)(&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
 			p++->val = video_15to32[dat & 0xffff];
@@ -927,9 +953,7 @@ svga_render_mixed_lowres(svga_t *svga)
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 4) {
@@ -978,9 +1002,7 @@ svga_render_mixed_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 16);
 
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 8) {
@@ -1067,9 +1089,7 @@ svga_render_16bpp_lowres(svga_t *svga)
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 	if (!svga->remap_required){
 		for (x = 0; x <= svga->hdisp; x += 4) {
@@ -1107,8 +1127,8 @@ svga_render_16bpp_highres(svga_t *svga)
 {
     int y_add = enable_overscan ? (overscan_y >> 1) : 0;
     int x_add = enable_overscan ? 8 : 0;
-    int offset, x;
-    uint32_t dat;
+    int offset, x, n;
+    uint32_t dat, addr;
     pel_t *p;
     uint32_t changed_addr = svga->remap_func(svga, svga->ma);
 
@@ -1116,11 +1136,15 @@ svga_render_16bpp_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 16);
 
-	if (!svga->remap_required) {
+	/* If the line does not wrap, convert it in one go. */
+	n = ((svga->hdisp >> 3) + 1) << 3;
+	addr = svga->ma & svga->vram_display_mask;
+	if (!svga->remap_required && (addr + (n << 1)) <= (svga->vram_display_mask + 1)) {
+		video_pel_16to32(p, &svga->vram[addr], n);
+		svga->ma += n << 1;
+	} else if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 8) {
 			dat = *(uint32_t *)(&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
 			p++->val     = video_16to32[dat & 0xffff];
@@ -1156,9 +1180,7 @@ svga_render_24bpp_lowres(svga_t *svga)
     uint32_t changed_addr = svga->remap_func(svga, svga->ma);
 
     if (svga->changedvram[changed_addr >> 12] || svga->changedvram[(changed_addr >> 12) + 1] || svga->fullchange) {
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, 32 + x_add, changed_addr, 0);
 
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
@@ -1202,7 +1224,7 @@ svga_render_24bpp_highres(svga_t *svga)
 {
     int y_add = enable_overscan ? (overscan_y >> 1) : 0;
     int x_add = enable_overscan ? 8 : 0;
-    int offset, x;
+    int offset, x, n;
     uint32_t dat0, dat1, dat2, addr;
     pel_t *p;
     uint32_t changed_addr = svga->remap_func(svga, svga->ma);
@@ -1211,11 +1233,15 @@ svga_render_24bpp_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 24);
 
-	if (!svga->remap_required) {
+	/* If the line does not wrap, convert it in one go. */
+	n = ((svga->hdisp >> 2) + 1) << 2;
+	addr = svga->ma & svga->vram_display_mask;
+	if (!svga->remap_required && (addr + (n * 3)) <= (svga->vram_display_mask + 1)) {
+		video_pel_24to32(p, &svga->vram[addr], n);
+		svga->ma += n * 3;
+	} else if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x += 4) {
 			dat0 = *(uint32_t *)(&svga->vram[svga->ma & svga->vram_display_mask]);
 			dat1 = *(uint32_t *)(&svga->vram[(svga->ma + 4) & svga->vram_display_mask]);
@@ -1262,9 +1288,7 @@ svga_render_32bpp_lowres(svga_t *svga)
     pel_t *p;
 
     if (svga->changedvram[changed_addr >> 12] || svga->changedvram[(changed_addr >> 12) + 1] || svga->fullchange) {
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, 32 + x_add, changed_addr, 0);
 
 	offset = (8 - (svga->scrollcache & 6)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
@@ -1306,9 +1330,7 @@ svga_render_32bpp_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 32);
 
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x++) {
@@ -1343,9 +1365,7 @@ svga_render_ABGR8888_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000)
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x++) {
@@ -1380,9 +1400,7 @@ svga_render_RGBA8888_highres(svga_t *svga)
 	offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
 	p = &screen->line[svga->displine + y_add][offset + x_add];
 
-	if (svga->firstline_draw == 2000) 
-		svga->firstline_draw = svga->displine;
-	svga->lastline_draw = svga->displine;
+	line_drawn(svga, offset + x_add, changed_addr, 0);
 
 	if (!svga->remap_required) {
 		for (x = 0; x <= svga->hdisp; x++) {
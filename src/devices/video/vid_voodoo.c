@@ -8,14 +8,14 @@
  *
  *		Emulation of the 3DFX Voodoo Graphics controller.
  *
- * Version:	@(#)vid_voodoo.c	1.0.27	2021/11/02
+ * Version:	@(#)vid_voodoo.c	1.0.28	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		leilei,
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2021 Miran Grca.
  *		Copyright 2008-2018 leilei.
  *		Copyright 2008-2020 Sarah Walker.
@@ -857,7 +857,8 @@ void *voodoo_card_init()
         voodoo->fb_size = device_get_config_int("framebuffer_memory");
         voodoo->fb_mask = (voodoo->fb_size << 20) - 1;
         voodoo->render_threads = device_get_config_int("render_threads");
-        voodoo->odd_even_mask = voodoo->render_threads - 1;
+        voodoo->texture_entries = device_get_config_int("texture_cache");
+        voodoo->texture_budget = device_get_config_int("texture_budget") << 20;
 #ifndef NO_CODEGEN
         voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif                        
@@ -890,16 +891,7 @@ void *voodoo_card_init()
         voodoo->tex_mem_w[0] = (uint16_t *)voodoo->tex_mem[0];
         voodoo->tex_mem_w[1] = (uint16_t *)voodoo->tex_mem[1];
         
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
-                voodoo->texture_cache[0][c].data = (uint32_t *)mem_alloc((256*256 + 256*256 + 128*128 + 64*64 + 32*32 + 16*16 + 8*8 + 4*4 + 2*2) * 4);
-                voodoo->texture_cache[0][c].base = -1; /*invalid*/
-                voodoo->texture_cache[0][c].refcount = 0;
-                if (voodoo->dual_tmus) {
-                        voodoo->texture_cache[1][c].data = (uint32_t *)mem_alloc((256*256 + 256*256 + 128*128 + 64*64 + 32*32 + 16*16 + 8*8 + 4*4 + 2*2) * 4);
-                        voodoo->texture_cache[1][c].base = -1; /*invalid*/
-                        voodoo->texture_cache[1][c].refcount = 0;
-                }
-        }
+        voodoo_tex_init(voodoo);
 
         timer_add(voodoo_callback, voodoo,
 		  &voodoo->timer_count, TIMER_ALWAYS_ENABLED);
@@ -908,24 +900,10 @@ void *voodoo_card_init()
         voodoo->fbiInit0 = 0;
 
         voodoo->wake_fifo_thread = thread_create_event();
-        voodoo->wake_render_thread[0] = thread_create_event();
-        voodoo->wake_render_thread[1] = thread_create_event();
-        voodoo->wake_render_thread[2] = thread_create_event();
-        voodoo->wake_render_thread[3] = thread_create_event();
         voodoo->wake_main_thread = thread_create_event();
         voodoo->fifo_not_full_event = thread_create_event();
-        voodoo->render_not_full_event[0] = thread_create_event();
-        voodoo->render_not_full_event[1] = thread_create_event();
-        voodoo->render_not_full_event[2] = thread_create_event();
-        voodoo->render_not_full_event[3] = thread_create_event();
         voodoo->fifo_thread = thread_create(voodoo_fifo_thread, voodoo);
-        voodoo->render_thread[0] = thread_create(voodoo_render_thread_1, voodoo);
-        if (voodoo->render_threads >= 2)
-                voodoo->render_thread[1] = thread_create(voodoo_render_thread_2, voodoo);
-        if (voodoo->render_threads == 4) {
-		voodoo->render_thread[2] = thread_create(voodoo_render_thread_3, voodoo);
-		voodoo->render_thread[3] = thread_create(voodoo_render_thread_4, voodoo);
-	}
+        voodoo_render_start(voodoo);
 
         voodoo->swap_mutex = thread_create_mutex(L"VARCem.VoodooMutex");
 
@@ -1005,7 +983,8 @@ void *voodoo_2d3d_card_init(int type)
     voodoo->dithersub_enabled = device_get_config_int("dithersub");
     voodoo->scrfilter = device_get_config_int("dacfilter");
     voodoo->render_threads = device_get_config_int("render_threads");
-    voodoo->odd_even_mask = voodoo->render_threads - 1;
+    voodoo->texture_entries = device_get_config_int("texture_cache");
+    voodoo->texture_budget = device_get_config_int("texture_budget") << 20;
 #ifndef NO_CODEGEN
     voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif
@@ -1015,16 +994,7 @@ void *voodoo_2d3d_card_init(int type)
     /*generate filter lookup tables*/
     voodoo_generate_filter_v2(voodoo);
 
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-	voodoo->texture_cache[0][c].data = (uint32_t *)mem_alloc((256*256 + 256*256 + 128*128 + 64*64 + 32*32 + 16*16 + 8*8 + 4*4 + 2*2) * 4);
-	voodoo->texture_cache[0][c].base = -1; /*invalid*/
-	voodoo->texture_cache[0][c].refcount = 0;
-	if (voodoo->dual_tmus) {
-		voodoo->texture_cache[1][c].data = (uint32_t *)mem_alloc((256*256 + 256*256 + 128*128 + 64*64 + 32*32 + 16*16 + 8*8 + 4*4 + 2*2) * 4);
-		voodoo->texture_cache[1][c].base = -1; /*invalid*/
-		voodoo->texture_cache[1][c].refcount = 0;
-	}
-    }
+    voodoo_tex_init(voodoo);
 
     voodoo->swap_mutex = thread_create_mutex(L"VARCem.Voodoo2DMutex");
 
@@ -1034,24 +1004,10 @@ void *voodoo_2d3d_card_init(int type)
     voodoo->fbiInit0 = 0;
 
     voodoo->wake_fifo_thread = thread_create_event();
-    voodoo->wake_render_thread[0] = thread_create_event();
-    voodoo->wake_render_thread[1] = thread_create_event();
-    voodoo->wake_render_thread[2] = thread_create_event();
-    voodoo->wake_render_thread[3] = thread_create_event();
     voodoo->wake_main_thread = thread_create_event();
     voodoo->fifo_not_full_event = thread_create_event();
-    voodoo->render_not_full_event[0] = thread_create_event();
-    voodoo->render_not_full_event[1] = thread_create_event();
-    voodoo->render_not_full_event[2] = thread_create_event();
-    voodoo->render_not_full_event[3] = thread_create_event();
     voodoo->fifo_thread = thread_create(voodoo_fifo_thread, voodoo);
-    voodoo->render_thread[0] = thread_create(voodoo_render_thread_1, voodoo);
-    if (voodoo->render_threads >= 2)
-	voodoo->render_thread[1] = thread_create(voodoo_render_thread_2, voodoo);
-    if (voodoo->render_threads == 4) {
-	voodoo->render_thread[2] = thread_create(voodoo_render_thread_3, voodoo);
-	voodoo->render_thread[3] = thread_create(voodoo_render_thread_4, voodoo);
-    }
+    voodoo_render_start(voodoo);
 
     timer_add(voodoo_wake_timer, voodoo,
 	  &voodoo->wake_timer, &voodoo->wake_timer);
@@ -1182,7 +1138,6 @@ voodoo_card_close(voodoo_t *voodoo)
 #ifndef RELEASE_BUILD
         FILE *f;
 #endif
-        int c;
         
 #ifndef RELEASE_BUILD        
 	if (voodoo->tex_mem[0]) {
@@ -1202,26 +1157,12 @@ voodoo_card_close(voodoo_t *voodoo)
 #endif
 
         thread_kill(voodoo->fifo_thread);
-        thread_kill(voodoo->render_thread[0]);
-        if (voodoo->render_threads >= 2)
-                thread_kill(voodoo->render_thread[1]);
-	if (voodoo->render_threads == 4) {
-		thread_kill(voodoo->render_thread[2]);
-		thread_kill(voodoo->render_thread[3]);
-	}
+        voodoo_render_stop(voodoo);
         thread_destroy_event(voodoo->fifo_not_full_event);
         thread_destroy_event(voodoo->wake_main_thread);
         thread_destroy_event(voodoo->wake_fifo_thread);
-        thread_destroy_event(voodoo->wake_render_thread[0]);
-        thread_destroy_event(voodoo->wake_render_thread[1]);
-        thread_destroy_event(voodoo->render_not_full_event[0]);
-        thread_destroy_event(voodoo->render_not_full_event[1]);
-
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
-                if (voodoo->dual_tmus)
-                        free(voodoo->texture_cache[1][c].data);
-                free(voodoo->texture_cache[0][c].data);
-        }
+
+        voodoo_tex_close(voodoo);
 #ifndef NO_CODEGEN
         voodoo_codegen_close(voodoo);
 #endif
@@ -1324,6 +1265,58 @@ static const device_config_t voodoo_config[] =
 			{
                                 "4",4
                         },
+                        {
+                                "8",8
+                        },
+                        {
+                                "12",12
+                        },
+                        {
+                                "16",16
+                        },
+                        {
+                                NULL
+                        }
+                },
+        },
+        {
+                "texture_cache","Texture cache entries",CONFIG_SELECTION,"",128,
+                {
+                        {
+                                "64",64
+                        },
+                        {
+                                "128",128
+                        },
+                        {
+                                "256",256
+                        },
+                        {
+                                "512",512
+                        },
+                        {
+                                NULL
+                        }
+                },
+        },
+        {
+                "texture_budget","Texture cache memory",CONFIG_SELECTION,"",64,
+                {
+                        {
+                                "16 MB",16
+                        },
+                        {
+                                "32 MB",32
+                        },
+                        {
+                                "64 MB",64
+                        },
+                        {
+                                "128 MB",128
+                        },
+                        {
+                                "256 MB",256
+                        },
                         {
                                 NULL
                         }
@@ -8,13 +8,13 @@
  *
  *		Emulation of the 3DFX Voodoo Graphics Banshee controller.
  *
- * Version:	@(#)vid_voodoo_banshee.c	1.0.5	2021/11/04
+ * Version:	@(#)vid_voodoo_banshee.c	1.0.6	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2021 Miran Grca.
  *		Copyright 2008-2020 Sarah Walker.
  *
@@ -719,9 +719,7 @@ static uint32_t banshee_status(banshee_t *banshee)
     int swap_count = voodoo->swap_count;
     int written = voodoo->cmd_written + voodoo->cmd_written_fifo;
     int busy = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) ||
-                voodoo->render_voodoo_busy[0] || voodoo->render_voodoo_busy[1] ||
-                voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3] ||
-                voodoo->voodoo_busy;
+                voodoo_render_busy(voodoo) || voodoo->voodoo_busy;
     uint32_t ret;
 
     ret = 0;
@@ -2577,6 +2575,58 @@ static const device_config_t banshee_config[] =
                         {
                                 "4",4
                         },
+                        {
+                                "8",8
+                        },
+                        {
+                                "12",12
+                        },
+                        {
+                                "16",16
+                        },
+                        {
+                                NULL
+                        }
+                },
+        },
+        {
+                "texture_cache","Texture cache entries",CONFIG_SELECTION,"",128,
+                {
+                        {
+                                "64",64
+                        },
+                        {
+                                "128",128
+                        },
+                        {
+                                "256",256
+                        },
+                        {
+                                "512",512
+                        },
+                        {
+                                NULL
+                        }
+                },
+        },
+        {
+                "texture_budget","Texture cache memory",CONFIG_SELECTION,"",64,
+                {
+                        {
+                                "16 MB",16
+                        },
+                        {
+                                "32 MB",32
+                        },
+                        {
+                                "64 MB",64
+                        },
+                        {
+                                "128 MB",128
+                        },
+                        {
+                                "256 MB",256
+                        },
                         {
                                 NULL
                         }
@@ -2615,6 +2665,58 @@ static const device_config_t voodoo3_config[] =
                         {
                                 "4",4
                         },
+                        {
+                                "8",8
+                        },
+                        {
+                                "12",12
+                        },
+                        {
+                                "16",16
+                        },
+                        {
+                                NULL
+                        }
+                },
+        },
+        {
+                "texture_cache","Texture cache entries",CONFIG_SELECTION,"",128,
+                {
+                        {
+                                "64",64
+                        },
+                        {
+                                "128",128
+                        },
+                        {
+                                "256",256
+                        },
+                        {
+                                "512",512
+                        },
+                        {
+                                NULL
+                        }
+                },
+        },
+        {
+                "texture_budget","Texture cache memory",CONFIG_SELECTION,"",64,
+                {
+                        {
+                                "16 MB",16
+                        },
+                        {
+                                "32 MB",32
+                        },
+                        {
+                                "64 MB",64
+                        },
+                        {
+                                "128 MB",128
+                        },
+                        {
+                                "256 MB",256
+                        },
                         {
                                 NULL
                         }
@@ -0,0 +1,388 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Block cache for the Voodoo Recompiler.
+ *
+ *		Each render thread has its own cache of compiled pixel
+ *		pipelines, found through a hash on the render state that
+ *		the generated code depends on, and replaced LRU. The
+ *		states compiled during a run are saved to a file in the
+ *		machine's NVR directory, and compiled again at startup
+ *		so the next run does not have to.
+ *
+ *		This file is included by the x86 and x86-64 recompilers,
+ *		after their voodoo_generate() function.
+ *
+ * Version:	@(#)vid_voodoo_codegen.h	1.0.1	2026/10/17
+ *
+ * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *		Sarah Walker, <tommowalker@tommowalker.co.uk>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *		Copyright 2008-2021 Sarah Walker.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#ifndef VIDEO_VOODOO_CODEGEN_H
+# define VIDEO_VOODOO_CODEGEN_H
+
+
+#define JIT_BLOCKS	256			/*blocks per render thread*/
+#define JIT_HASH_SIZE	512
+#define JIT_FILE	L"voodoo.jit"
+#define JIT_MAGIC	0x5449454aU		/*"JEIT"*/
+#define JIT_VERSION	3
+
+#define LOD_MASK (LOD_TMIRROR_S | LOD_TMIRROR_T)
+
+/*Everything the generated code depends on, besides the card config*/
+typedef struct voodoo_jit_key_t
+{
+        int32_t xdir;
+        uint32_t alphaMode;
+        uint32_t fbzMode;
+        uint32_t fogMode;
+        uint32_t fbzColorPath;
+        uint32_t textureMode[2];
+        uint32_t tLOD[2];
+        uint32_t tDetail[2];                    /*detail max/bias/scale, packed as in the register*/
+        uint32_t trexInit1;
+        uint32_t tmuConfig;
+        uint32_t col_tiled;
+        uint32_t aux_tiled;
+} voodoo_jit_key_t;
+
+typedef struct voodoo_jit_block_t
+{
+        uint8_t code_block[BLOCK_SIZE];
+        voodoo_jit_key_t key;
+        int hash_next;
+        int lru_prev, lru_next;
+} voodoo_jit_block_t;
+
+typedef struct voodoo_jit_cache_t
+{
+        voodoo_jit_block_t *blocks;
+        int hash[JIT_HASH_SIZE];
+        int lru_head, lru_tail;
+        int used;
+        int last;
+} voodoo_jit_cache_t;
+
+typedef struct voodoo_jit_t
+{
+        voodoo_jit_block_t *mem;
+        size_t mem_size;
+        voodoo_jit_cache_t cache[VOODOO_MAX_THREADS];
+} voodoo_jit_t;
+
+
+int voodoo_recomp = 0;
+
+
+static inline void voodoo_jit_make_key(voodoo_jit_key_t *key, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state)
+{
+        key->xdir = state->xdir;
+        key->alphaMode = params->alphaMode;
+        key->fbzMode = params->fbzMode;
+        key->fogMode = params->fogMode;
+        key->fbzColorPath = params->fbzColorPath;
+        key->textureMode[0] = params->textureMode[0];
+        key->textureMode[1] = params->textureMode[1];
+        key->tLOD[0] = params->tLOD[0] & LOD_MASK;
+        key->tLOD[1] = params->tLOD[1] & LOD_MASK;
+        key->tDetail[0] = params->detail_max[0] | (params->detail_bias[0] << 8) | (params->detail_scale[0] << 14);
+        key->tDetail[1] = params->detail_max[1] | (params->detail_bias[1] << 8) | (params->detail_scale[1] << 14);
+        key->trexInit1 = voodoo->trexInit1[0] & (1 << 18);
+        key->tmuConfig = voodoo->tmuConfig;
+        key->col_tiled = params->col_tiled ? 1 : 0;
+        key->aux_tiled = params->aux_tiled ? 1 : 0;
+}
+
+static inline int voodoo_jit_hash(const voodoo_jit_key_t *key)
+{
+        uint32_t h = key->fbzMode;
+
+        h = (h * 0x9e3779b1) ^ key->alphaMode;
+        h = (h * 0x9e3779b1) ^ key->fbzColorPath;
+        h = (h * 0x9e3779b1) ^ key->textureMode[0] ^ (key->textureMode[1] << 1);
+        h = (h * 0x9e3779b1) ^ key->fogMode ^ key->tLOD[0] ^ (key->tLOD[1] << 2);
+        h = (h * 0x9e3779b1) ^ key->tDetail[0] ^ (key->tDetail[1] << 17);
+        h = (h * 0x9e3779b1) ^ key->trexInit1 ^ key->tmuConfig ^ (key->col_tiled << 3) ^ (key->aux_tiled << 4) ^ (key->xdir & 0x80000000);
+
+        return (h ^ (h >> 15)) & (JIT_HASH_SIZE-1);
+}
+
+/*Compile the pipeline for a key into a block of this thread's cache, replacing the least recently used one if it is full*/
+static voodoo_jit_block_t *voodoo_jit_compile(voodoo_t *voodoo, voodoo_jit_cache_t *cache, const voodoo_jit_key_t *key, voodoo_params_t *params, voodoo_state_t *state)
+{
+        voodoo_jit_block_t *data;
+        int b, h, *p;
+
+        if (cache->used < JIT_BLOCKS)
+                b = cache->used++;
+        else
+        {
+                b = cache->lru_tail;
+                data = &cache->blocks[b];
+
+                p = &cache->hash[voodoo_jit_hash(&data->key)];
+                while (*p != b)
+                        p = &cache->blocks[*p].hash_next;
+                *p = data->hash_next;
+
+                cache->lru_tail = data->lru_prev;
+                cache->blocks[cache->lru_tail].lru_next = -1;
+        }
+        data = &cache->blocks[b];
+
+        voodoo_generate(data->code_block, voodoo, params, state, (params->fbzMode >> 5) & 7);
+        data->key = *key;
+
+        h = voodoo_jit_hash(key);
+        data->hash_next = cache->hash[h];
+        cache->hash[h] = b;
+
+        data->lru_prev = -1;
+        data->lru_next = cache->lru_head;
+        if (cache->lru_head != -1)
+                cache->blocks[cache->lru_head].lru_prev = b;
+        else
+                cache->lru_tail = b;
+        cache->lru_head = b;
+        cache->last = b;
+
+        return data;
+}
+
+static inline void *voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
+{
+        voodoo_jit_cache_t *cache = &((voodoo_jit_t *)voodoo->codegen_data)->cache[odd_even];
+        voodoo_jit_block_t *data;
+        voodoo_jit_key_t key;
+        int b;
+
+        voodoo_jit_make_key(&key, voodoo, params, state);
+
+        /*Most triangles use the same state as the one before*/
+        if (cache->last != -1 && !memcmp(&cache->blocks[cache->last].key, &key, sizeof(key)))
+                return cache->blocks[cache->last].code_block;
+
+        for (b = cache->hash[voodoo_jit_hash(&key)]; b != -1; b = cache->blocks[b].hash_next)
+        {
+                data = &cache->blocks[b];
+
+                if (!memcmp(&data->key, &key, sizeof(key)))
+                {
+                        if (cache->lru_head != b)
+                        {
+                                cache->blocks[data->lru_prev].lru_next = data->lru_next;
+                                if (data->lru_next != -1)
+                                        cache->blocks[data->lru_next].lru_prev = data->lru_prev;
+                                else
+                                        cache->lru_tail = data->lru_prev;
+                                data->lru_prev = -1;
+                                data->lru_next = cache->lru_head;
+                                cache->blocks[cache->lru_head].lru_prev = b;
+                                cache->lru_head = b;
+                        }
+                        cache->last = b;
+                        return data->code_block;
+                }
+        }
+
+voodoo_recomp++;
+        return voodoo_jit_compile(voodoo, cache, &key, params, state)->code_block;
+}
+
+
+/*Compile the states saved by the last run, for all render threads*/
+static void voodoo_jit_load(voodoo_t *voodoo, voodoo_jit_t *jit)
+{
+        voodoo_params_t *params;
+        voodoo_state_t *state;
+        voodoo_jit_key_t key;
+        uint32_t hdr[3], c;
+        uint32_t trexInit1 = voodoo->trexInit1[0];
+        uint32_t tmuConfig = voodoo->tmuConfig;
+        int t;
+        FILE *f;
+
+        f = plat_fopen(nvr_path(JIT_FILE), L"rb");
+        if (f == NULL)
+                return;
+
+        if (fread(hdr, sizeof(hdr), 1, f) != 1 || hdr[0] != JIT_MAGIC || hdr[1] != JIT_VERSION)
+        {
+                (void)fclose(f);
+                return;
+        }
+
+        params = (voodoo_params_t *)mem_alloc(sizeof(voodoo_params_t));
+        state = (voodoo_state_t *)mem_alloc(sizeof(voodoo_state_t));
+        memset(params, 0x00, sizeof(voodoo_params_t));
+        memset(state, 0x00, sizeof(voodoo_state_t));
+
+        for (c = 0; c < hdr[2] && c < JIT_BLOCKS; c++)
+        {
+                if (fread(&key, sizeof(key), 1, f) != 1)
+                        break;
+
+                state->xdir = key.xdir;
+                params->alphaMode = key.alphaMode;
+                params->fbzMode = key.fbzMode;
+                params->fogMode = key.fogMode;
+                params->fbzColorPath = key.fbzColorPath;
+                params->textureMode[0] = key.textureMode[0];
+                params->textureMode[1] = key.textureMode[1];
+                params->tLOD[0] = key.tLOD[0];
+                params->tLOD[1] = key.tLOD[1];
+                for (t = 0; t < 2; t++)
+                {
+                        params->detail_max[t] = key.tDetail[t] & 0xff;
+                        params->detail_bias[t] = (key.tDetail[t] >> 8) & 0x3f;
+                        params->detail_scale[t] = (key.tDetail[t] >> 14) & 7;
+
+                        /*The generator reads these from the state, which voodoo_triangle() would have set up*/
+                        state->clamp_s[t] = key.textureMode[t] & TEXTUREMODE_TCLAMPS;
+                        state->clamp_t[t] = key.textureMode[t] & TEXTUREMODE_TCLAMPT;
+                }
+                params->col_tiled = key.col_tiled;
+                params->aux_tiled = key.aux_tiled;
+                voodoo->trexInit1[0] = key.trexInit1;
+                voodoo->tmuConfig = key.tmuConfig;
+
+                for (t = 0; t < voodoo->render_threads; t++)
+                        (void)voodoo_jit_compile(voodoo, &jit->cache[t], &key, params, state);
+        }
+        (void)fclose(f);
+
+        voodoo->trexInit1[0] = trexInit1;
+        voodoo->tmuConfig = tmuConfig;
+        free(state);
+        free(params);
+
+        INFO("VOODOO: precompiled %u pipelines\n", c);
+}
+
+/*Save the states in the caches, most recently used first*/
+static void voodoo_jit_save(voodoo_t *voodoo, voodoo_jit_t *jit)
+{
+        voodoo_jit_key_t *keys;
+        uint32_t hdr[3], n = 0, c;
+        int t, b;
+        FILE *f;
+
+        keys = (voodoo_jit_key_t *)mem_alloc(sizeof(voodoo_jit_key_t) * JIT_BLOCKS);
+
+        for (t = 0; t < voodoo->render_threads && n < JIT_BLOCKS; t++)
+        {
+                voodoo_jit_cache_t *cache = &jit->cache[t];
+
+                for (b = cache->lru_head; b != -1 && n < JIT_BLOCKS; b = cache->blocks[b].lru_next)
+                {
+                        for (c = 0; c < n; c++)
+                        {
+                                if (!memcmp(&keys[c], &cache->blocks[b].key, sizeof(voodoo_jit_key_t)))
+                                        break;
+                        }
+                        if (c == n)
+                                keys[n++] = cache->blocks[b].key;
+                }
+        }
+
+        if (n != 0)
+        {
+                f = plat_fopen(nvr_path(JIT_FILE), L"wb");
+                if (f != NULL)
+                {
+                        hdr[0] = JIT_MAGIC;
+                        hdr[1] = JIT_VERSION;
+                        hdr[2] = n;
+                        (void)fwrite(hdr, sizeof(hdr), 1, f);
+                        (void)fwrite(keys, sizeof(voodoo_jit_key_t), n, f);
+                        (void)fclose(f);
+                }
+        }
+
+        free(keys);
+}
+
+static void voodoo_jit_init(voodoo_t *voodoo)
+{
+        voodoo_jit_t *jit;
+        int t, c;
+
+        jit = (voodoo_jit_t *)mem_alloc(sizeof(voodoo_jit_t));
+        memset(jit, 0x00, sizeof(voodoo_jit_t));
+
+        jit->mem_size = sizeof(voodoo_jit_block_t) * JIT_BLOCKS * voodoo->render_threads;
+#if defined(_WIN32)
+        jit->mem = VirtualAlloc(NULL, jit->mem_size, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+#elif defined(__linux__)
+        jit->mem = mmap(NULL, jit->mem_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (jit->mem == MAP_FAILED)
+                jit->mem = NULL;
+#else
+        jit->mem = mem_alloc(jit->mem_size);
+#endif
+        if (jit->mem == NULL)
+                fatal("VOODOO: unable to allocate %lu bytes for recompiler\n", (unsigned long)jit->mem_size);
+
+        for (t = 0; t < voodoo->render_threads; t++)
+        {
+                jit->cache[t].blocks = &jit->mem[t * JIT_BLOCKS];
+                for (c = 0; c < JIT_HASH_SIZE; c++)
+                        jit->cache[t].hash[c] = -1;
+                jit->cache[t].lru_head = jit->cache[t].lru_tail = -1;
+                jit->cache[t].last = -1;
+        }
+
+        voodoo->codegen_data = jit;
+
+        voodoo_jit_load(voodoo, jit);
+}
+
+static void voodoo_jit_close(voodoo_t *voodoo)
+{
+        voodoo_jit_t *jit = (voodoo_jit_t *)voodoo->codegen_data;
+
+        if (jit == NULL)
+                return;
+
+        voodoo_jit_save(voodoo, jit);
+
+#if defined(_WIN32)
+        VirtualFree(jit->mem, 0, MEM_RELEASE);
+#elif defined(__linux__)
+        munmap(jit->mem, jit->mem_size);
+#else
+        free(jit->mem);
+#endif
+        free(jit);
+        voodoo->codegen_data = NULL;
+}
+
+
+#endif	/*VIDEO_VOODOO_CODEGEN_H*/
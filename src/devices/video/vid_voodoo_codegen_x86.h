@@ -8,7 +8,7 @@
  *
  *		Implementation of the Voodoo Recompiler (32bit.)
  *
- * Version:	@(#)vid_voodoo_codegen_x86.h	1.0.6	2021/09/15
+ * Version:	@(#)vid_voodoo_codegen_x86.h	1.0.7	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -61,29 +61,8 @@
 
 #include <xmmintrin.h>
 
-#define BLOCK_NUM 8
-#define BLOCK_MASK (BLOCK_NUM-1)
 #define BLOCK_SIZE 8192
 
-#define LOD_MASK (LOD_TMIRROR_S | LOD_TMIRROR_T)
-
-typedef struct voodoo_x86_data_t
-{
-        uint8_t code_block[BLOCK_SIZE];
-        int xdir;
-        uint32_t alphaMode;
-        uint32_t fbzMode;
-        uint32_t fogMode;
-        uint32_t fbzColorPath;
-        uint32_t textureMode[2];
-        uint32_t tLOD[2];
-        uint32_t trexInit1;
-	int is_tiled;
-} voodoo_x86_data_t;
-
-static int last_block[4] = {0, 0};
-static int next_block_to_write[4] = {0, 0};
-
 #define addbyte(val)                                            \
         do {                                                    \
                 code_block[block_pos++] = val;                  \
@@ -3308,85 +3287,11 @@ static inline void voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo
                 cs = cs;
 }
 
-int voodoo_recomp = 0;
-
-static inline void *voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
-{
-        int c;
-        int b = last_block[odd_even];
-        voodoo_x86_data_t *data;
-        voodoo_x86_data_t *codegen_data = (voodoo_x86_data_t *)voodoo->codegen_data;
-        
-        for (c = 0; c < 8; c++)
-        {
-                data = &codegen_data[odd_even + b*4];
-                
-                if (state->xdir == data->xdir &&
-                    params->alphaMode == data->alphaMode &&
-                    params->fbzMode == data->fbzMode &&
-                    params->fogMode == data->fogMode &&
-                    params->fbzColorPath == data->fbzColorPath &&
-                    (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1 &&
-                    params->textureMode[0] == data->textureMode[0] &&
-                    params->textureMode[1] == data->textureMode[1] &&
-                    (params->tLOD[0] & LOD_MASK) == data->tLOD[0] &&
-                    (params->tLOD[1] & LOD_MASK) == data->tLOD[1] &&
-                    ((params->col_tiled || params->aux_tiled) ? 1 : 0) == data->is_tiled)
-                {
-                        last_block[odd_even] = b;
-                        return data->code_block;
-                }
-                
-                b = (b + 1) & 7;
-        }
-voodoo_recomp++;
-        data = &codegen_data[odd_even + next_block_to_write[odd_even]*4];
-//      code_block = data->code_block;
-        
-        voodoo_generate(data->code_block, voodoo, params, state, depth_op);
-
-        data->xdir = state->xdir;
-        data->alphaMode = params->alphaMode;
-        data->fbzMode = params->fbzMode;
-        data->fogMode = params->fogMode;
-        data->fbzColorPath = params->fbzColorPath;
-        data->trexInit1 = voodoo->trexInit1[0] & (1 << 18);
-        data->textureMode[0] = params->textureMode[0];
-        data->textureMode[1] = params->textureMode[1];
-        data->tLOD[0] = params->tLOD[0] & LOD_MASK;
-        data->tLOD[1] = params->tLOD[1] & LOD_MASK;
-        data->is_tiled = (params->col_tiled || params->aux_tiled) ? 1 : 0;
-
-        next_block_to_write[odd_even] = (next_block_to_write[odd_even] + 1) & 7;
-        
-        return data->code_block;
-}
+#include "vid_voodoo_codegen.h"
 
 void voodoo_codegen_init(voodoo_t *voodoo)
 {
         int c;
-#ifdef __linux__
-	void *start;
-	size_t len;
-	long pagesize = sysconf(_SC_PAGESIZE);
-	long pagemask = ~(pagesize - 1);
-#endif
-
-#if defined WIN32 || defined _WIN32 || defined _WIN32
-        voodoo->codegen_data = VirtualAlloc(NULL, sizeof(voodoo_x86_data_t) * BLOCK_NUM*4, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-#else
-        voodoo->codegen_data = mem_alloc(sizeof(voodoo_x86_data_t) * BLOCK_NUM*4);
-#endif
-
-#ifdef __linux__
-	start = (void *)((long)voodoo->codegen_data & pagemask);
-	len = ((sizeof(voodoo_x86_data_t) * BLOCK_NUM*4) + pagesize) & pagemask;
-	if (mprotect(start, len, PROT_READ | PROT_WRITE | PROT_EXEC) != 0)
-	{
-		perror("mprotect");
-		exit(-1);
-	}
-#endif
 
         for (c = 0; c < 256; c++)
         {
@@ -3408,15 +3313,13 @@ void voodoo_codegen_init(voodoo_t *voodoo)
         alookup[256] = _mm_set_epi32(0, 0, 256 | (256 << 16), 256 | (256 << 16));
         xmm_00_ff_w[0] = _mm_set_epi32(0, 0, 0, 0);
         xmm_00_ff_w[1] = _mm_set_epi32(0, 0, 0xff | (0xff << 16), 0xff | (0xff << 16));
+
+        voodoo_jit_init(voodoo);
 }
 
 void voodoo_codegen_close(voodoo_t *voodoo)
 {
-#if defined WIN32 || defined _WIN32 || defined _WIN32
-        VirtualFree(voodoo->codegen_data, 0, MEM_RELEASE);
-#else
-        free(voodoo->codegen_data);
-#endif
+        voodoo_jit_close(voodoo);
 }
 
 
@@ -9,12 +9,12 @@
  *		Header for the 3DFX Voodoo Graphics Controller
  *		Common functions.
  *
- * Version:	@(#)vid_voodoo_common.h	1.0.1	2021/09/14
+ * Version:	@(#)vid_voodoo_common.h	1.0.2	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2021 Fred N. van Kempen.
+ *		Copyright 2021-2026 Fred N. van Kempen.
  *		Copyright 2020 Sarah Walker.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -54,7 +54,19 @@
 
 #define TEX_DIRTY_SHIFT 10
 
-#define TEX_CACHE_MAX 64
+/*
+ * Decoded textures are kept in a cache of up to texture_entries
+ * slabs of TEX_DATA_SIZE bytes, found through a hash on (base, tLOD,
+ * palette), and limited to texture_budget bytes over both TMUs. To
+ * find the textures hit by a texture memory write, each 64K range
+ * of texture memory has a bitmap of the entries using it.
+ */
+#define TEX_CACHE_MAX 512
+#define TEX_CACHE_WORDS (TEX_CACHE_MAX / 32)
+#define TEX_HASH_SIZE 1024
+#define TEX_RANGE_SHIFT 16
+#define TEX_RANGE_MAX 256
+#define TEX_DATA_SIZE ((256*256 + 256*256 + 128*128 + 64*64 + 32*32 + 16*16 + 8*8 + 4*4 + 2*2) * 4)
 
 enum
 {
@@ -103,6 +115,14 @@ enum
         FIFO_WRITEL_2DREG = (0x05 << 24)
 };
 
+/*
+ * Render threads each draw their own bands of VOODOO_BAND_LINES
+ * lines, so bands are dealt out round-robin over the threads.
+ */
+#define VOODOO_MAX_THREADS	16
+#define VOODOO_BAND_SHIFT	3
+#define VOODOO_BAND_LINES	(1 << VOODOO_BAND_SHIFT)
+
 #define PARAM_SIZE 1024
 #define PARAM_MASK (PARAM_SIZE - 1)
 #define PARAM_ENTRY_SIZE (1 << 31)
@@ -189,17 +209,21 @@ typedef struct voodoo_params_t
         uint32_t stipple;
         int col_tiled, aux_tiled;
         int row_width, aux_row_width;
+
+        uint32_t render_mask;	/*threads with bands in this triangle*/
 } voodoo_params_t;
 
 typedef struct texture_t
 {
         uint32_t base;
         uint32_t tLOD;
-        volatile int refcount, refcount_r[4];
+        volatile int refcount, refcount_r[VOODOO_MAX_THREADS];
         int is16;
         uint32_t palette_checksum;
         uint32_t addr_start[4], addr_end[4];
         uint32_t *data;
+        int hash_next;			/*next entry in hash chain*/
+        int lru_prev, lru_next;		/*LRU list, or free list*/
 } texture_t;
 
 typedef struct vert_t
@@ -217,6 +241,11 @@ typedef struct clip_t
         int y_min, y_max;
 } clip_t;
 
+typedef struct {
+        struct voodoo_t *voodoo;
+        int thread;
+} voodoo_render_ctx_t;
+
 typedef struct voodoo_t
 {
 	mem_map_t mapping;
@@ -290,21 +319,22 @@ typedef struct voodoo_t
 	int ncc_dirty[2];
 
 	thread_t *fifo_thread;
-	thread_t *render_thread[4];
+	thread_t *render_thread[VOODOO_MAX_THREADS];
 	event_t *wake_fifo_thread;
 	event_t *wake_main_thread;
 	event_t *fifo_not_full_event;
-	event_t *render_not_full_event[4];
-	event_t *wake_render_thread[4];
+	event_t *render_not_full_event[VOODOO_MAX_THREADS];
+	event_t *wake_render_thread[VOODOO_MAX_THREADS];
 
 	int voodoo_busy;
-	int render_voodoo_busy[4];
+	int render_voodoo_busy[VOODOO_MAX_THREADS];
 
 	int render_threads;
-	int odd_even_mask;
+	voodoo_render_ctx_t render_ctx[VOODOO_MAX_THREADS];
 
-	int pixel_count[4], texel_count[4], tri_count, frame_count;
-	int pixel_count_old[4], texel_count_old[4];
+	int pixel_count[VOODOO_MAX_THREADS], texel_count[VOODOO_MAX_THREADS];
+	int tri_count, frame_count;
+	int pixel_count_old[VOODOO_MAX_THREADS], texel_count_old[VOODOO_MAX_THREADS];
 	int wr_count, rd_count, tex_count;
 
 	int retrace_count;
@@ -329,7 +359,7 @@ typedef struct voodoo_t
 	volatile int cmd_read, cmd_written, cmd_written_fifo;
 
 	voodoo_params_t params_buffer[PARAM_SIZE];
-	volatile int params_read_idx[4], params_write_idx;
+	volatile int params_read_idx[VOODOO_MAX_THREADS], params_write_idx;
 
 	uint32_t cmdfifo_base, cmdfifo_end, cmdfifo_size;
 	int cmdfifo_rp, cmdfifo_ret_addr;
@@ -501,14 +531,22 @@ typedef struct voodoo_t
         uint16_t purpleline[256][3];
 
         texture_t texture_cache[2][TEX_CACHE_MAX];
-        uint8_t texture_present[2][16384];
-        int texture_last_removed;
+        uint16_t texture_present[2][16384];	/*entries using each 1K page*/
+        int texture_entries;
+        uint32_t texture_budget, texture_bytes;
+        int tex_hash[2][TEX_HASH_SIZE];
+        int tex_lru_head[2], tex_lru_tail[2];
+        int tex_free[2];
+        uint32_t tex_range[2][TEX_RANGE_MAX][TEX_CACHE_WORDS];
+
+        uint64_t tex_hits, tex_misses, tex_evictions, tex_flushes;
+        uint64_t tex_decode_time;
         
         uint32_t palette_checksum[2];
         int palette_dirty[2];
 
         uint64_t time;
-        int render_time[4];
+        int render_time[VOODOO_MAX_THREADS];
         
         int use_recompiler;
         void *codegen_data;
@@ -8,12 +8,12 @@
  *
  *		Emulation of the 3DFX Voodoo Graphics Display.
  *
- * Version:	@(#)vid_voodoo_display.c	1.0.1	2021/09/14
+ * Version:	@(#)vid_voodoo_display.c	1.0.2	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2021 Fred N. van Kempen.
+ *		Copyright 2021-2026 Fred N. van Kempen.
  *		Copyright 2020 Sarah Walker.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -547,7 +547,6 @@ void voodoo_callback(void *priv)
                                 
                                 if (voodoo->line < voodoo->dirty_line_low) {
                                         voodoo->dirty_line_low = voodoo->line;
-                                        video_blit_wait_buffer();
                                 }
                                 if (voodoo->line > voodoo->dirty_line_high)
                                         voodoo->dirty_line_high = voodoo->line;
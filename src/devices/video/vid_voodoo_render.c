@@ -8,12 +8,12 @@
  *
  *		Emulation of the 3DFX Voodoo Graphics Renderer.
  *
- * Version:	@(#)vid_voodoo_render.c	1.0.1	2021/09/14
+ * Version:	@(#)vid_voodoo_render.c	1.0.3	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2021 Fred N. van Kempen.
+ *		Copyright 2021-2026 Fred N. van Kempen.
  *		Copyright 2020 Sarah Walker.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -45,6 +45,7 @@
 #include "../../timer.h"
 #include "../../cpu/cpu.h"
 #include "../../mem.h"
+#include "../../nvr.h"
 #include "../../device.h"
 #include "../../plat.h"
 #include "video.h"
@@ -664,6 +665,13 @@ static int voodoo_recomp = 0;
 #endif
 
 
+/*Render thread that draws a band. Lines can be negative, so this is a floor
+  modulo*/
+static inline int voodoo_band_thread(voodoo_t *voodoo, int band)
+{
+        return ((band % voodoo->render_threads) + voodoo->render_threads) % voodoo->render_threads;
+}
+
 static void voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
 {
 /*      int rgb_sel                 = params->fbzColorPath & 3;
@@ -829,13 +837,9 @@ static void voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, vood
                 else
                         real_y >>= 4;
 
-                if (SLI_ENABLED) {
-                        if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
-                                goto next_line;
-                } else {
-                        if ((real_y & voodoo->odd_even_mask) != odd_even)
-                                goto next_line;
-                }
+                /*Bands are in unflipped lines, see voodoo_render_mask()*/
+                if (voodoo_band_thread(voodoo, state->y >> VOODOO_BAND_SHIFT) != odd_even)
+                        goto next_line;
 
                 start_x = x;
 
@@ -1561,10 +1565,37 @@ void voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
         voodoo_half_triangle(voodoo, params, &state, vertexAy_adjusted, vertexCy_adjusted, odd_even);
 }
 
-static void render_thread(void *param, int odd_even)
+/*Work out which threads have bands in a triangle's lines*/
+static uint32_t voodoo_render_mask(voodoo_t *voodoo, voodoo_params_t *params)
 {
-        voodoo_t *voodoo = (voodoo_t *)param;
-        
+        int ystart, yend, band, last;
+        uint32_t mask = 0;
+
+        if (voodoo->render_threads == 1)
+                return 1;
+
+        /*Same lines as voodoo_triangle() and voodoo_half_triangle()*/
+        ystart = ((int16_t)(params->vertexAy & 0xffff) + 7) >> 4;
+        yend = ((int16_t)(params->vertexCy & 0xffff) + 7) >> 4;
+        if (yend <= ystart)
+                return 1;
+
+        last = (yend - 1) >> VOODOO_BAND_SHIFT;
+        for (band = ystart >> VOODOO_BAND_SHIFT; band <= last; band++) {
+                mask |= 1 << voodoo_band_thread(voodoo, band);
+                if (mask == (1u << voodoo->render_threads) - 1)
+                        break;
+        }
+
+        return mask;
+}
+
+static void render_thread(void *param)
+{
+        voodoo_render_ctx_t *ctx = (voodoo_render_ctx_t *)param;
+        voodoo_t *voodoo = ctx->voodoo;
+        int odd_even = ctx->thread;
+
         while (1) {
                 thread_set_event(voodoo->render_not_full_event[odd_even]);
                 thread_wait_event(voodoo->wake_render_thread[odd_even], -1);
@@ -1576,7 +1607,13 @@ static void render_thread(void *param, int odd_even)
                         uint64_t end_time;
                         voodoo_params_t *params = &voodoo->params_buffer[voodoo->params_read_idx[odd_even] & PARAM_MASK];
                         
-                        voodoo_triangle(voodoo, params, odd_even);
+                        if (params->render_mask & (1 << odd_even))
+                                voodoo_triangle(voodoo, params, odd_even);
+                        else {
+                                /*None of our bands, but still drop the texture references*/
+                                voodoo->texture_cache[0][params->tex_entry[0]].refcount_r[odd_even]++;
+                                voodoo->texture_cache[1][params->tex_entry[1]].refcount_r[odd_even]++;
+                        }
 
                         voodoo->params_read_idx[odd_even]++;                                                
                         
@@ -1591,45 +1628,47 @@ static void render_thread(void *param, int odd_even)
         }
 }
 
-void voodoo_render_thread_1(void *param)
-{
-        render_thread(param, 0);
-}
-void voodoo_render_thread_2(void *param)
+void voodoo_render_start(voodoo_t *voodoo)
 {
-        render_thread(param, 1);
-}
-void voodoo_render_thread_3(void *param)
-{
-        render_thread(param, 2);
+        int c;
+
+        if (voodoo->render_threads < 1)
+                voodoo->render_threads = 1;
+        if (voodoo->render_threads > VOODOO_MAX_THREADS)
+                voodoo->render_threads = VOODOO_MAX_THREADS;
+
+        for (c = 0; c < voodoo->render_threads; c++) {
+                voodoo->render_ctx[c].voodoo = voodoo;
+                voodoo->render_ctx[c].thread = c;
+                voodoo->wake_render_thread[c] = thread_create_event();
+                voodoo->render_not_full_event[c] = thread_create_event();
+        }
+        for (c = 0; c < voodoo->render_threads; c++)
+                voodoo->render_thread[c] = thread_create(render_thread, &voodoo->render_ctx[c]);
 }
-void voodoo_render_thread_4(void *param)
+
+void voodoo_render_stop(voodoo_t *voodoo)
 {
-        render_thread(param, 3);
+        int c;
+
+        for (c = 0; c < voodoo->render_threads; c++) {
+                thread_kill(voodoo->render_thread[c]);
+                thread_destroy_event(voodoo->wake_render_thread[c]);
+                thread_destroy_event(voodoo->render_not_full_event[c]);
+        }
 }
 
 void queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
         voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
+        int c;
 
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) ||
-                (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3))))
-        {
-                thread_reset_event(voodoo->render_not_full_event[0]);
-                if (voodoo->render_threads >= 2)
-                        thread_reset_event(voodoo->render_not_full_event[1]);
-                if (voodoo->render_threads == 4) {
-                        thread_reset_event(voodoo->render_not_full_event[2]);
-                        thread_reset_event(voodoo->render_not_full_event[3]);
-		}
-		if (PARAM_FULL(0))
-			thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-                if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-			thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-		if (voodoo->render_threads == 4 && PARAM_FULL(2))
-			thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-		if (voodoo->render_threads == 4 && PARAM_FULL(3))	
-			thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
+        for (c = 0; c < voodoo->render_threads; c++) {
+                while (PARAM_FULL(c)) {
+                        thread_reset_event(voodoo->render_not_full_event[c]);
+                        if (PARAM_FULL(c))
+                                thread_wait_event(voodoo->render_not_full_event[c], -1); /*Wait for room in ringbuffer*/
+                }
         }
         
         use_texture(voodoo, params, 0);
@@ -1637,11 +1676,14 @@ void queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
                 use_texture(voodoo, params, 1);
 
         memcpy(params_new, params, sizeof(voodoo_params_t));
+        params_new->render_mask = voodoo_render_mask(voodoo, params_new);
         
         voodoo->params_write_idx++;
         
-        if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) ||
-		(voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
-                voodoo_wake_render_thread(voodoo);
+        for (c = 0; c < voodoo->render_threads; c++) {
+                if (PARAM_ENTRIES(c) < 4) {
+                        voodoo_wake_render_thread(voodoo);
+                        break;
+                }
+        }
 }
-
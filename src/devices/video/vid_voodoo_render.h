@@ -8,12 +8,12 @@
  *
  *		Header for the 3DFX Voodoo Graphics Renderer
  *
- * Version:	@(#)vid_voodoo_render.h	1.0.1	2021/09/14
+ * Version:	@(#)vid_voodoo_render.h	1.0.2	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2021 Fred N. van Kempen.
+ *		Copyright 2021-2026 Fred N. van Kempen.
  *		Copyright 2020 Sarah Walker.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -334,10 +334,8 @@ void voodoo_codegen_close(voodoo_t *voodoo);
                 src_b = CLAMP(src_b);                                   \
         } while(0)
 
-void voodoo_render_thread_1(void *param);
-void voodoo_render_thread_2(void *param);
-void voodoo_render_thread_3(void *param);
-void voodoo_render_thread_4(void *param);
+void voodoo_render_start(voodoo_t *voodoo);
+void voodoo_render_stop(voodoo_t *voodoo);
 void queue_triangle(voodoo_t *voodoo, voodoo_params_t *params);
 
 extern int voodoo_recomp;
@@ -345,32 +343,47 @@ extern int tris;
 
 static inline void voodoo_wake_render_thread(voodoo_t *voodoo)
 {
-        thread_set_event(voodoo->wake_render_thread[0]); /*Wake up render thread if moving from idle*/
-        if (voodoo->render_threads >= 2)
-                thread_set_event(voodoo->wake_render_thread[1]); /*Wake up render thread if moving from idle*/
-	if (voodoo->render_threads == 4) {
-		thread_set_event(voodoo->wake_render_thread[2]); /*Wake up render thread if moving from idle*/
-		thread_set_event(voodoo->wake_render_thread[3]); /*Wake up render thread if moving from idle*/
-	}
+        int c;
+
+        for (c = 0; c < voodoo->render_threads; c++)
+                thread_set_event(voodoo->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
+}
+
+static inline int voodoo_render_busy(voodoo_t *voodoo)
+{
+        int c;
+
+        for (c = 0; c < voodoo->render_threads; c++) {
+                if (!PARAM_EMPTY(c) || voodoo->render_voodoo_busy[c])
+                        return 1;
+        }
+
+        return 0;
+}
+
+/*Texture is still referenced by a queued or running triangle*/
+static inline int voodoo_texture_in_use(voodoo_t *voodoo, texture_t *t)
+{
+        int c;
+
+        for (c = 0; c < voodoo->render_threads; c++) {
+                if (t->refcount != t->refcount_r[c])
+                        return 1;
+        }
+
+        return 0;
 }
 
 static inline void voodoo_wait_for_render_thread_idle(voodoo_t *voodoo)
 {
+        int c;
 
-    while (!PARAM_EMPTY(0) || (voodoo->render_threads >= 2 && !PARAM_EMPTY(1)) ||
-                (voodoo->render_threads == 4 && (!PARAM_EMPTY(2) || !PARAM_EMPTY(3))) ||
-                voodoo->render_voodoo_busy[0] || (voodoo->render_threads >= 2 && voodoo->render_voodoo_busy[1]) ||
-                (voodoo->render_threads == 4 && (voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3])))
-        {
+        while (voodoo_render_busy(voodoo)) {
                 voodoo_wake_render_thread(voodoo);
-                if (!PARAM_EMPTY(0) || voodoo->render_voodoo_busy[0])
-                        thread_wait_event(voodoo->render_not_full_event[0], 1);
-                if (voodoo->render_threads >= 2 && (!PARAM_EMPTY(1) || voodoo->render_voodoo_busy[1]))
-                        thread_wait_event(voodoo->render_not_full_event[1], 1);
-		if (voodoo->render_threads == 4 && (!PARAM_EMPTY(2) || voodoo->render_voodoo_busy[2]))
-                        thread_wait_event(voodoo->render_not_full_event[2], 1);
-		if (voodoo->render_threads == 4 && (!PARAM_EMPTY(3) || voodoo->render_voodoo_busy[3]))
-                        thread_wait_event(voodoo->render_not_full_event[3], 1);
+                for (c = 0; c < voodoo->render_threads; c++) {
+                        if (!PARAM_EMPTY(c) || voodoo->render_voodoo_busy[c])
+                                thread_wait_event(voodoo->render_not_full_event[c], 1);
+                }
         }
 }
 
@@ -8,12 +8,12 @@
  *
  *		Emulation of the 3DFX Voodoo Graphics Setup.
  *
- * Version:	@(#)vid_voodoo_setup.c	1.0.2	2021/11/02
+ * Version:	@(#)vid_voodoo_setup.c	1.0.3	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2021 Fred N. van Kempen.
+ *		Copyright 2021-2026 Fred N. van Kempen.
  *		Copyright 2020 Sarah Walker.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -149,13 +149,141 @@ void voodoo_recalc_tex(voodoo_t *voodoo, int tmu)
     voodoo->params.tex_width[tmu] = width;
 }
 
+static int
+tex_hash(uint32_t base, uint32_t tLOD, uint32_t palette_checksum)
+{
+        uint32_t h = base ^ (tLOD * 0x9e3779b1) ^ (palette_checksum * 0x85ebca6b);
+
+        return (h ^ (h >> 10) ^ (h >> 20)) & (TEX_HASH_SIZE-1);
+}
+
+/*Add (delta=1) or remove (delta=-1) an entry in the page counts and range bitmaps*/
+static void
+tex_mark(voodoo_t *voodoo, int tmu, int c, int delta)
+{
+        texture_t *tex = &voodoo->texture_cache[tmu][c];
+        uint32_t addr, bit = 1u << (c & 31);
+        int d, w = c >> 5;
+
+        for (d = 0; d < 4; d++)
+        {
+                uint32_t addr_start = tex->addr_start[d] & ~((1 << TEX_DIRTY_SHIFT) - 1);
+                uint32_t addr_end = tex->addr_end[d];
+
+                if (addr_end == 0)
+                        continue;
+
+                for (addr = addr_start; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
+                        voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] += delta;
+
+                /*Range bits are only ever set; tex_unlink() clears them*/
+                if (delta > 0)
+                {
+                        for (addr = addr_start & ~((1 << TEX_RANGE_SHIFT) - 1); addr <= addr_end; addr += (1 << TEX_RANGE_SHIFT))
+                                voodoo->tex_range[tmu][(addr & voodoo->texture_mask) >> TEX_RANGE_SHIFT][w] |= bit;
+                }
+        }
+}
+
+static void
+tex_lru_remove(voodoo_t *voodoo, int tmu, int c)
+{
+        texture_t *tex = &voodoo->texture_cache[tmu][c];
+
+        if (tex->lru_prev != -1)
+                voodoo->texture_cache[tmu][tex->lru_prev].lru_next = tex->lru_next;
+        else
+                voodoo->tex_lru_head[tmu] = tex->lru_next;
+        if (tex->lru_next != -1)
+                voodoo->texture_cache[tmu][tex->lru_next].lru_prev = tex->lru_prev;
+        else
+                voodoo->tex_lru_tail[tmu] = tex->lru_prev;
+}
+
+static void
+tex_lru_add(voodoo_t *voodoo, int tmu, int c)
+{
+        texture_t *tex = &voodoo->texture_cache[tmu][c];
+
+        tex->lru_prev = -1;
+        tex->lru_next = voodoo->tex_lru_head[tmu];
+        if (tex->lru_next != -1)
+                voodoo->texture_cache[tmu][tex->lru_next].lru_prev = c;
+        else
+                voodoo->tex_lru_tail[tmu] = c;
+        voodoo->tex_lru_head[tmu] = c;
+}
+
+/*Take a cached texture out of the hash, the LRU list and the range index*/
+static void
+tex_unlink(voodoo_t *voodoo, int tmu, int c)
+{
+        texture_t *tex = &voodoo->texture_cache[tmu][c];
+        int *p = &voodoo->tex_hash[tmu][tex_hash(tex->base, tex->tLOD, tex->palette_checksum)];
+        int r;
+
+        while (*p != c)
+                p = &voodoo->texture_cache[tmu][*p].hash_next;
+        *p = tex->hash_next;
+
+        tex_lru_remove(voodoo, tmu, c);
+        tex_mark(voodoo, tmu, c, -1);
+
+        for (r = 0; r < TEX_RANGE_MAX; r++)
+                voodoo->tex_range[tmu][r][c >> 5] &= ~(1u << (c & 31));
+
+        tex->base = -1;
+}
+
+/*Find an entry for a new texture - a free one if the budget allows, else the least recently used idle one*/
+static int
+tex_alloc(voodoo_t *voodoo, int tmu)
+{
+        texture_t *tex;
+        int c;
+
+        c = voodoo->tex_free[tmu];
+        if (c != -1)
+        {
+                tex = &voodoo->texture_cache[tmu][c];
+                if (tex->data == NULL && voodoo->tex_lru_tail[tmu] != -1 &&
+                    (voodoo->texture_bytes + TEX_DATA_SIZE) > voodoo->texture_budget)
+                        c = -1;
+                else
+                {
+                        voodoo->tex_free[tmu] = tex->lru_next;
+                        if (tex->data == NULL)
+                        {
+                                tex->data = (uint32_t *)mem_alloc(TEX_DATA_SIZE);
+                                voodoo->texture_bytes += TEX_DATA_SIZE;
+                        }
+                        return c;
+                }
+        }
+
+        for (;;)
+        {
+                for (c = voodoo->tex_lru_tail[tmu]; c != -1; c = voodoo->texture_cache[tmu][c].lru_prev)
+                {
+                        if (!voodoo_texture_in_use(voodoo, &voodoo->texture_cache[tmu][c]))
+                        {
+                                tex_unlink(voodoo, tmu, c);
+                                voodoo->tex_evictions++;
+                                return c;
+                        }
+                }
+                voodoo_wait_for_render_thread_idle(voodoo);
+        }
+}
+
 void use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 {
-        int c, d;
+        int c, h;
         int lod;
         int lod_min, lod_max;
-        uint32_t addr = 0, addr_end;
+        uint32_t addr = 0;
         uint32_t palette_checksum;
+        uint64_t start_time;
 
         lod_min = (params->tLOD[tmu] >> 2) & 15;
         lod_max = (params->tLOD[tmu] >> 8) & 15;
@@ -184,37 +312,30 @@ void use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
                 addr = params->texBaseAddr[tmu];
 
         /*Try to find texture in cache*/
-        for (c = 0; c < TEX_CACHE_MAX; c++)
+        h = tex_hash(addr, params->tLOD[tmu] & 0xf00fff, palette_checksum);
+        for (c = voodoo->tex_hash[tmu][h]; c != -1; c = voodoo->texture_cache[tmu][c].hash_next)
         {
                 if (voodoo->texture_cache[tmu][c].base == addr &&
                     voodoo->texture_cache[tmu][c].tLOD == (params->tLOD[tmu] & 0xf00fff) &&
                     voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum)
                 {
+                        if (voodoo->tex_lru_head[tmu] != c)
+                        {
+                                tex_lru_remove(voodoo, tmu, c);
+                                tex_lru_add(voodoo, tmu, c);
+                        }
                         params->tex_entry[tmu] = c;
                         voodoo->texture_cache[tmu][c].refcount++;
+                        voodoo->tex_hits++;
                         return;
                 }
         }
         
-        /*Texture not found, search for unused texture*/
-        do
-        {
-                for (c = 0; c < TEX_CACHE_MAX; c++)
-                {
-                        voodoo->texture_last_removed++;
-                        voodoo->texture_last_removed &= (TEX_CACHE_MAX-1);
-                        if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] &&
-                            (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
-                                break;
-                }
-                if (c == TEX_CACHE_MAX)
-                        voodoo_wait_for_render_thread_idle(voodoo);
-        } while (c == TEX_CACHE_MAX);
-        if (c == TEX_CACHE_MAX)
-                fatal("Texture cache full!\n");
+        /*Texture not found, get a free or least recently used entry*/
+        voodoo->tex_misses++;
+        c = tex_alloc(voodoo, tmu);
+        start_time = plat_timer_read();
 
-        c = voodoo->texture_last_removed;
-        
 
         if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
                 voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
@@ -491,71 +612,119 @@ void use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
         else        
                 voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->texture_cache[tmu][c].addr_end[3] = 0;
 
+        voodoo->texture_cache[tmu][c].hash_next = voodoo->tex_hash[tmu][h];
+        voodoo->tex_hash[tmu][h] = c;
+        tex_lru_add(voodoo, tmu, c);
+        tex_mark(voodoo, tmu, c, 1);
+        voodoo->tex_decode_time += plat_timer_read() - start_time;
 
-        for (d = 0; d < 4; d++)
-        {
-                addr = voodoo->texture_cache[tmu][c].addr_start[d];
-                addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
-
-                if (addr_end != 0)
-                {
-                        for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
-                                voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-                }
-        }
-       
         params->tex_entry[tmu] = c;
         voodoo->texture_cache[tmu][c].refcount++;
 }
 
 void flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
 {
+        uint32_t *range = voodoo->tex_range[tmu][dirty_addr >> TEX_RANGE_SHIFT];
         int wait_for_idle = 0;
-        int c;
-        
-        memset(voodoo->texture_present[tmu], 0, sizeof(voodoo->texture_present[0]));
-//        DEBUG("Evict %08x %i\n", dirty_addr, sizeof(voodoo->texture_present));
-        for (c = 0; c < TEX_CACHE_MAX; c++)
+        int w, b;
+
+        voodoo->tex_flushes++;
+//        DEBUG("Evict %08x\n", dirty_addr);
+        for (w = 0; w < TEX_CACHE_WORDS; w++)
         {
-                if (voodoo->texture_cache[tmu][c].base != -1)
+                uint32_t bits = range[w];
+
+                for (b = 0; bits; b++, bits >>= 1)
                 {
-                        int d;
-                        
+                        int c = (w << 5) + b;
+                        texture_t *tex = &voodoo->texture_cache[tmu][c];
+                        int d, hit = 0;
+
+                        if (!(bits & 1))
+                                continue;
+
                         for (d = 0; d < 4; d++)
                         {
-                                uint32_t addr_start = voodoo->texture_cache[tmu][c].addr_start[d];
-                                uint32_t addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
-                                
+                                uint32_t addr_start = tex->addr_start[d];
+                                uint32_t addr_end = tex->addr_end[d];
+
                                 if (addr_end != 0)
                                 {
                                         uint32_t addr_start_masked = addr_start & voodoo->texture_mask & ~0x3ff;
                                         uint32_t addr_end_masked = ((addr_end & voodoo->texture_mask) + 0x3ff) & ~0x3ff;
-                                        
+
                                         if (addr_end_masked < addr_start_masked)
                                                 addr_end_masked = voodoo->texture_mask+1;
                                         if (dirty_addr >= addr_start_masked && dirty_addr < addr_end_masked)
-                                        {
-//                                DEBUG("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
-
-                                                if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] ||
-                                                    (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
-                                                        wait_for_idle = 1;
-                                        
-                                                voodoo->texture_cache[tmu][c].base = -1;
-                                        }
-                                        else
-                                        {
-                                                for (; addr_start <= addr_end; addr_start += (1 << TEX_DIRTY_SHIFT))
-                                                        voodoo->texture_present[tmu][(addr_start & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-                                        }
+                                                hit = 1;
                                 }
                         }
+
+                        if (hit)
+                        {
+//                                DEBUG("  Evict texture %i %08x\n", c, tex->base);
+                                if (voodoo_texture_in_use(voodoo, tex))
+                                        wait_for_idle = 1;
+
+                                tex_unlink(voodoo, tmu, c);
+                                tex->lru_next = voodoo->tex_free[tmu];
+                                voodoo->tex_free[tmu] = c;
+                        }
                 }
         }
         if (wait_for_idle)
                 voodoo_wait_for_render_thread_idle(voodoo);
 }
 
+void voodoo_tex_init(voodoo_t *voodoo)
+{
+        int tmu, c;
+
+        if (voodoo->texture_entries <= 0 || voodoo->texture_entries > TEX_CACHE_MAX)
+                voodoo->texture_entries = TEX_CACHE_MAX;
+        if (voodoo->texture_budget < 2 * TEX_DATA_SIZE)
+                voodoo->texture_budget = 2 * TEX_DATA_SIZE;
+        voodoo->texture_bytes = 0;
+
+        for (tmu = 0; tmu < 2; tmu++)
+        {
+                for (c = 0; c < TEX_HASH_SIZE; c++)
+                        voodoo->tex_hash[tmu][c] = -1;
+                voodoo->tex_lru_head[tmu] = voodoo->tex_lru_tail[tmu] = -1;
+                voodoo->tex_free[tmu] = -1;
+
+                for (c = voodoo->texture_entries-1; c >= 0; c--)
+                {
+                        voodoo->texture_cache[tmu][c].data = NULL; /*allocated on first use*/
+                        voodoo->texture_cache[tmu][c].base = -1; /*invalid*/
+                        voodoo->texture_cache[tmu][c].refcount = 0;
+                        voodoo->texture_cache[tmu][c].lru_next = voodoo->tex_free[tmu];
+                        voodoo->tex_free[tmu] = c;
+                }
+        }
+}
+
+void voodoo_tex_close(voodoo_t *voodoo)
+{
+        int tmu, c;
+
+        INFO("VOODOO: texture cache %llu hits, %llu misses, %llu evictions, %llu flushes, %u KB used, %.1f ms decoding\n",
+             (unsigned long long)voodoo->tex_hits, (unsigned long long)voodoo->tex_misses,
+             (unsigned long long)voodoo->tex_evictions, (unsigned long long)voodoo->tex_flushes,
+             voodoo->texture_bytes >> 10,
+             (double)voodoo->tex_decode_time * 1000.0 / (double)plat_timer_freq());
+
+        for (tmu = 0; tmu < 2; tmu++)
+        {
+                for (c = 0; c < TEX_CACHE_MAX; c++)
+                {
+                        if (voodoo->texture_cache[tmu][c].data != NULL)
+                                free(voodoo->texture_cache[tmu][c].data);
+                        voodoo->texture_cache[tmu][c].data = NULL;
+                }
+        }
+}
+
 void voodoo_tex_writel(uint32_t addr, uint32_t val, void *p)
 {
     int lod, s, t;
@@ -8,12 +8,12 @@
  *
  *		Header for the 3DFX Voodoo Graphics Texture
  *
- * Version:	@(#)vid_voodoo_texture.h	1.0.1	2021/09/14
+ * Version:	@(#)vid_voodoo_texture.h	1.0.2	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2021 Fred N. van Kempen.
+ *		Copyright 2021-2026 Fred N. van Kempen.
  *		Copyright 2020 Sarah Walker.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -56,5 +56,7 @@ void voodoo_recalc_tex(voodoo_t *voodoo, int tmu);
 void use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu);
 void voodoo_tex_writel(uint32_t addr, uint32_t val, void *priv);
 void flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu);
+void voodoo_tex_init(voodoo_t *voodoo);
+void voodoo_tex_close(voodoo_t *voodoo);
 
 #endif
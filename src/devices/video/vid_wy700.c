@@ -53,13 +53,13 @@
  *		What doesn't work, is untested or not well understood:
  *		  - Cursor detach (commands 4 and 5)
  *
- * Version:	@(#)vid_wy700.c	1.0.14	2019/05/17
+ * Version:	@(#)vid_wy700.c	1.0.15	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -760,9 +760,6 @@ wy700_poll(priv_t priv)
 	dev->mda_stat |= 1;
 	dev->linepos = 1;
 	if (dev->dispon) {
-		if (dev->displine == 0)
-			video_blit_wait_buffer();
-	
 		if (dev->wy700_mode & 0x80) 
 			mode = dev->wy700_mode & 0xF0;
 		else
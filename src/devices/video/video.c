@@ -8,13 +8,13 @@
  *
  *		Main video-rendering module.
  *
- * Version:	@(#)video.c	1.0.35	2021/10/22
+ * Version:	@(#)video.c	1.0.36	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2019 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -84,6 +84,8 @@ int		xsize = 1,
 int		cga_palette = 0;
 int		changeframecount = 2;
 int		frames = 0;
+uint32_t	video_blits = 0;		/* screen updates sent to blitter */
+uint32_t	video_blit_drops = 0;		/* frames dropped by blitter queue */
 int		fullchange = 0;
 int		displine = 0;
 int		enable_overscan,
@@ -386,37 +388,86 @@ static int	card_type;
 static const video_timings_t *video_timing;
 
 
-static struct blitter {
+/*
+ * Frames on their way to the host blitter.
+ *
+ * The renderers draw into the screen buffer, and when a frame
+ * is done, video_blit_start() copies the changed band into one
+ * of these frames and queues it for the blitter thread. If the
+ * queue is full, the oldest waiting frame is dropped, and its
+ * damage is added to the next one, so the emulation never has
+ * to wait for the host.
+ */
+#define FRAME_FREE	0			// frame is available
+#define FRAME_BUSY	1			// frame is being filled
+#define FRAME_QUEUED	2			// frame is waiting for blit
+#define FRAME_SHOWN	3			// frame is being blitted
+
+typedef struct {
+    int		state;
+
     int		x, y, y1, y2, w, h;
 
-    volatile int busy;
-    event_t	*busy_ev;
+    video_damage_t damage;			// changed areas of this frame
 
-    volatile int inuse;
-    event_t	*inuse_ev;
+    bitmap_t	*bm;				// copy of the screen band
+    int		size;				// pels allocated in bm
+} frame_t;
 
+static struct blitter {
     thread_t	*thread;
     event_t	*wake_ev;
+    mutex_t	*lock;
+
+    frame_t	frame[VIDEO_FRAMES];
+    int		queue[VIDEO_FRAMES];		// queued frames, oldest first
+    int		queued;
+    frame_t	*shown;				// frame being blitted
+
+    video_damage_t damage;			// damage of the shown frame
 
     void	(*func)(bitmap_t *,int x, int y, int y1, int y2, int w, int h);
 }		blitter;
 
+/* Damage collected by the renderer for the next frame. */
+static video_damage_t	damage;
+static int		damage_all;
+
 
 static void
 blit_thread(void *param)
 {
     struct blitter *blit = (struct blitter *)param;
+    frame_t *f;
+    int i;
 
     for (;;) {
 	thread_wait_event(blit->wake_ev, -1);
 	thread_reset_event(blit->wake_ev);
 
-	if (blit->func != NULL)
-		blit->func(screen, blit->x, blit->y,
-			   blit->y1, blit->y2, blit->w, blit->h);
+	for (;;) {
+		/* Take the oldest frame off the queue. */
+		thread_wait_mutex(blit->lock);
+		if (blit->queued == 0) {
+			thread_release_mutex(blit->lock);
+			break;
+		}
+		f = &blit->frame[blit->queue[0]];
+		for (i = 1; i < blit->queued; i++)
+			blit->queue[i - 1] = blit->queue[i];
+		blit->queued--;
+		f->state = FRAME_SHOWN;
+		blit->shown = f;
+		thread_release_mutex(blit->lock);
+
+		memcpy(&blit->damage, &f->damage, sizeof(video_damage_t));
 
-	blit->busy = 0;
-	thread_set_event(blit->busy_ev);
+		if (blit->func != NULL)
+			blit->func(f->bm, f->x, f->y,
+				   f->y1, f->y2, f->w, f->h);
+
+		video_blit_done();
+	}
     }
 }
 
@@ -429,33 +480,24 @@ video_blit_set(void(*blit)(bitmap_t *,int,int,int,int,int,int))
 }
 
 
-/* Renderer blit function is done. */
+/* Renderer blit function is done with the frame's pels. */
 void
 video_blit_done(void)
 {
-    blitter.inuse = 0;
-
-    thread_set_event(blitter.inuse_ev);
-}
-
-
-void
-video_blit_wait_buffer(void)
-{
-    while (blitter.inuse)
-	thread_wait_event(blitter.inuse_ev, -1);
-
-    thread_reset_event(blitter.inuse_ev);
+    thread_wait_mutex(blitter.lock);
+    if (blitter.shown != NULL) {
+	blitter.shown->state = FRAME_FREE;
+	blitter.shown = NULL;
+    }
+    thread_release_mutex(blitter.lock);
 }
 
 
-void
-video_blit_wait(void)
+/* Return the number of frames waiting for the blitter. */
+int
+video_blit_queued(void)
 {
-    while (blitter.busy)
-	thread_wait_event(blitter.busy_ev, -1);
-
-    thread_reset_event(blitter.busy_ev);
+    return(blitter.queued);
 }
 
 
@@ -522,42 +564,294 @@ video_blend(int x, int y)
 }
 
 
-/* Set up the blitter, and then wake it up to process the screen buffer. */
+/*
+ * Record that (part of) a screen line has changed.
+ *
+ * Renderers that know which lines they redrew call this for
+ * each of them, in screen coordinates. Consecutive lines with
+ * overlapping column ranges are merged into one rectangle. If
+ * a renderer never calls this, the whole band is assumed to
+ * have changed, as before.
+ */
 void
-video_blit_start(int pal, int x, int y, int y1, int y2, int w, int h)
+video_damage_line(int y, int x1, int x2)
 {
-    uint32_t val;
-    int yy, xx;
+    video_rect_t *r;
+
+    if (x2 <= x1)
+	return;
+
+    if (damage.count > 0) {
+	r = &damage.rect[damage.count - 1];
+
+	if ((y == (r->y + r->h)) && (x1 <= (r->x + r->w)) && (x2 >= r->x)) {
+		/* Extends the last rectangle down. */
+		if (x1 < r->x) {
+			r->w += (r->x - x1);
+			r->x = x1;
+		}
+		if (x2 > (r->x + r->w))
+			r->w = x2 - r->x;
+		r->h++;
+		return;
+	}
+
+	if (damage.count == VIDEO_DAMAGE_MAX) {
+		/* Out of slots, grow the last one to cover it. */
+		if (x1 < r->x) {
+			r->w += (r->x - x1);
+			r->x = x1;
+		}
+		if (x2 > (r->x + r->w))
+			r->w = x2 - r->x;
+		if (y < r->y) {
+			r->h += (r->y - y);
+			r->y = y;
+		}
+		if (y >= (r->y + r->h))
+			r->h = y - r->y + 1;
+		return;
+	}
+    }
+
+    r = &damage.rect[damage.count++];
+    r->x = x1;
+    r->y = y;
+    r->w = x2 - x1;
+    r->h = 1;
+}
+
+
+/* The next frame must be sent in full. */
+void
+video_damage_all(void)
+{
+    damage_all = 1;
+}
+
+
+/* Get the changed areas of the frame being blitted. */
+const video_damage_t *
+video_blit_damage(void)
+{
+    return(&blitter.damage);
+}
+
+
+/* Convert the collected damage to blit coordinates, and clip it. */
+static void
+damage_clip(video_damage_t *d, int x, int y, int y1, int y2, int w)
+{
+    video_rect_t *r;
+    int i, x1, x2, ry1, ry2;
+
+    d->count = 0;
+
+    if (damage_all || (damage.count == 0)) {
+	/* Nothing known, so assume the whole band changed. */
+	if (y2 > y1) {
+		d->rect[0].x = 0;
+		d->rect[0].y = y1;
+		d->rect[0].w = w;
+		d->rect[0].h = y2 - y1;
+		d->count = 1;
+	}
+	return;
+    }
+
+    for (i = 0; i < damage.count; i++) {
+	r = &damage.rect[i];
+
+	x1 = MAX(r->x - x, 0);
+	x2 = MIN(r->x - x + r->w, w);
+	ry1 = MAX(r->y - y, y1);
+	ry2 = MIN(r->y - y + r->h, y2);
+	if ((x1 >= x2) || (ry1 >= ry2))
+		continue;
+
+	d->rect[d->count].x = x1;
+	d->rect[d->count].y = ry1;
+	d->rect[d->count].w = x2 - x1;
+	d->rect[d->count].h = ry2 - ry1;
+	d->count++;
+    }
+}
+
+
+/*
+ * Add the damage of a dropped frame to the next one.
+ *
+ * If the bands differ, the next frame is widened to cover both,
+ * and the caller must copy it again from the screen, since the
+ * lines only the dropped frame had are not in its copy.
+ */
+static int
+damage_merge(frame_t *f, const frame_t *old)
+{
+    video_damage_t *d = &f->damage;
+    const video_rect_t *r;
+    int i, j, y1, y2;
+
+    if ((f->x != old->x) || (f->y != old->y) || (f->w != old->w) ||
+	(f->y1 != old->y1) || (f->y2 != old->y2) ||
+	((d->count + old->damage.count) > VIDEO_DAMAGE_MAX)) {
+	/* Take the union of both bands, in our coordinates. */
+	y1 = f->y1;
+	y2 = f->y2;
+	if (old->y2 > old->y1) {
+		y1 = MIN(y1, old->y + old->y1 - f->y);
+		y2 = MAX(y2, old->y + old->y2 - f->y);
+	}
+	y1 = MAX(y1, 0);
+	y2 = MIN(y2, f->h);
+
+	/* Does not fit, so send all of the widened band. */
+	f->y1 = y1;
+	f->y2 = y2;
+	d->count = 0;
+	if (f->y2 > f->y1) {
+		d->rect[0].x = 0;
+		d->rect[0].y = f->y1;
+		d->rect[0].w = f->w;
+		d->rect[0].h = f->y2 - f->y1;
+		d->count = 1;
+	}
+	return(1);
+    }
+
+    /* Insert the old rectangles, keeping them sorted by y. */
+    for (i = 0; i < old->damage.count; i++) {
+	r = &old->damage.rect[i];
+	for (j = d->count; j > 0 && d->rect[j - 1].y > r->y; j--)
+		d->rect[j] = d->rect[j - 1];
+	d->rect[j] = *r;
+	d->count++;
+    }
+
+    return(0);
+}
+
+
+/* Copy the band to be blitted from the screen buffer. */
+static void
+frame_copy(frame_t *f)
+{
+    int r, r1, r2, w, sz;
     pel_t *p;
 
-    if (h <= 0)
+    r1 = MAX(f->y + f->y1, 0);
+    r2 = MIN(f->y + f->y2, screen->h);
+    w = MIN(f->w, screen->w - f->x);
+    if ((r1 >= r2) || (w <= 0) || (f->x < 0))
 	return;
 
+    /* Lines are x + w pels, so the blitter can use [x] as usual. */
+    sz = (r2 - r1) * (f->x + w);
+    if (sz > f->size) {
+	if (f->bm->pels != NULL)
+		free(f->bm->pels);
+	f->bm->pels = (pel_t *)mem_alloc(sz * sizeof(pel_t));
+	f->size = sz;
+    }
+
+    for (r = 0; r < f->bm->h; r++)
+	f->bm->line[r] = f->bm->pels;
+
+    p = f->bm->pels;
+    for (r = r1; r < r2; r++) {
+	f->bm->line[r] = p;
+	memcpy(&p[f->x], &screen->line[r][f->x], w * sizeof(pel_t));
+	p += (f->x + w);
+    }
+}
+
+
+/* Get a frame to fill, dropping the oldest queued one if needed. */
+static frame_t *
+frame_get(void)
+{
+    frame_t *f = NULL;
+    int i;
+
+    thread_wait_mutex(blitter.lock);
+
+    for (i = 0; i < VIDEO_FRAMES; i++) {
+	if (blitter.frame[i].state == FRAME_FREE) {
+		f = &blitter.frame[i];
+		break;
+	}
+    }
+
+    if (f == NULL) {
+	/* All in use, so drop the oldest waiting frame. */
+	f = &blitter.frame[blitter.queue[0]];
+	for (i = 1; i < blitter.queued; i++)
+		blitter.queue[i - 1] = blitter.queue[i];
+	blitter.queued--;
+
+	/*
+	 * The blitter cannot take a queued frame while we hold
+	 * the lock, so it is safe to copy the widened band here.
+	 */
+	if (blitter.queued > 0) {
+		if (damage_merge(&blitter.frame[blitter.queue[0]], f))
+			frame_copy(&blitter.frame[blitter.queue[0]]);
+	} else
+		damage_all = 1;
+
+	video_blit_drops++;
+    }
+
+    f->state = FRAME_BUSY;
+
+    thread_release_mutex(blitter.lock);
+
+    return(f);
+}
+
+
+/* Queue the finished frame, and wake up the blitter to process it. */
+void
+video_blit_start(int pal, int x, int y, int y1, int y2, int w, int h)
+{
+    frame_t *f;
+    int yy;
+
+    if (h <= 0) {
+	damage.count = 0;
+	damage_all = 0;
+	return;
+    }
+
+    video_blits++;
+
     if (pal) {
 	/* In palette mode, first convert the values. */
 	for (yy = 0; yy < h; yy++) {
-		if ((y + yy) >= 0 && (y + yy) < screen->h) {
-			for (xx = 0; xx < w; xx++) {
-				p = &screen->line[y + yy][x + xx];
-				val = pal_lookup[p->pal];
-				p->val = val;
-			}
-		}
+		if ((y + yy) >= 0 && (y + yy) < screen->h)
+			video_pel_pal(&screen->line[y + yy][x], pal_lookup, w);
 	}
     }
 
-    /* Wait for access to the blitter. */
-    video_blit_wait();
+    f = frame_get();
+
+    f->x = x;
+    f->y = y;
+    f->y1 = y1;
+    f->y2 = y2;
+    f->w = w;
+    f->h = h;
+
+    frame_copy(f);
 
-    blitter.busy = 1;
-    blitter.inuse = 1;
+    damage_clip(&f->damage, x, y, y1, y2, w);
+    damage.count = 0;
+    damage_all = 0;
 
-    blitter.x = x;
-    blitter.y = y;
-    blitter.y1 = y1;
-    blitter.y2 = y2;
-    blitter.w = w;
-    blitter.h = h;
+    thread_wait_mutex(blitter.lock);
+    f->state = FRAME_QUEUED;
+    blitter.queue[blitter.queued++] = (int)(f - blitter.frame);
+    thread_release_mutex(blitter.lock);
 
     /* Wake up the blitter. */
     thread_set_event(blitter.wake_ev);
@@ -807,12 +1101,27 @@ video_init(void)
     for (c = 0; c < 65536; c++)
 	video_16to32[c] = calc_16to32(c);
 
+    /* Select the pel conversion kernels for this host. */
+    video_pel_init();
+
     /* Create the screen buffer. */
     screen = create_bitmap(2048, 2048);
 
+    /* Create the frames for the blitter queue. */
+    for (c = 0; c < VIDEO_FRAMES; c++) {
+	blitter.frame[c].bm = (bitmap_t *)mem_alloc(sizeof(bitmap_t) +
+					(screen->h * sizeof(pel_t *)));
+	blitter.frame[c].bm->w = screen->w;
+	blitter.frame[c].bm->h = screen->h;
+	blitter.frame[c].bm->pels = NULL;
+	blitter.frame[c].size = 0;
+	blitter.frame[c].state = FRAME_FREE;
+    }
+    blitter.queued = 0;
+    blitter.shown = NULL;
+
+    blitter.lock = thread_create_mutex(NULL);
     blitter.wake_ev = thread_create_event();
-    blitter.busy_ev = thread_create_event();
-    blitter.inuse_ev = thread_create_event();
     blitter.thread = thread_create(blit_thread, &blitter);
 }
 
@@ -820,10 +1129,14 @@ video_init(void)
 void
 video_close(void)
 {
+    int c;
+
     thread_kill(blitter.thread);
-    thread_destroy_event(blitter.inuse_ev);
-    thread_destroy_event(blitter.busy_ev);
     thread_destroy_event(blitter.wake_ev);
+    thread_close_mutex(blitter.lock);
+
+    for (c = 0; c < VIDEO_FRAMES; c++)
+	destroy_bitmap(blitter.frame[c].bm);
 
     free(video_6to8);
     free(video_8togs);
@@ -856,6 +1169,10 @@ video_reset(void)
     update_overscan = 0;
     suppress_overscan = 0;
 
+    /* Start out with a full frame. */
+    damage.count = 0;
+    damage_all = 1;
+
     /* Do not initialize internal cards here. */
     if ((config.video_card == VID_NONE) ||
 	(config.video_card == VID_INTERNAL) || \
@@ -8,13 +8,13 @@
  *
  *		Definitions for the video controller module.
  *
- * Version:	@(#)video.h	1.0.43	2021/11/04
+ * Version:	@(#)video.h	1.0.44	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -110,6 +110,22 @@ typedef struct {
 
 typedef rgb_t PALETTE[256];
 
+/* A changed area of the screen, in blit coordinates. */
+typedef struct {
+    int		x, y, w, h;
+} video_rect_t;
+
+/* Frames the blitter queue can hold (one shown, the rest waiting.) */
+#define VIDEO_FRAMES		3
+
+/* All changed areas of a frame, sorted by y. */
+#define VIDEO_DAMAGE_MAX	32
+
+typedef struct {
+    int		count;
+    video_rect_t rect[VIDEO_DAMAGE_MAX];
+} video_damage_t;
+
 typedef struct {
     uint8_t	chr[32];
 } dbcs_font_t;
@@ -130,6 +146,15 @@ extern uint32_t		*video_6to8,
 			*video_15to32,
 			*video_16to32;
 extern uint32_t		pal_lookup[256];
+extern void		(*video_pel_8to32)(pel_t *dst, const uint8_t *src,
+					   const uint32_t *pal, int n);
+extern void		(*video_pel_15to32)(pel_t *dst, const uint8_t *src,
+					    int n);
+extern void		(*video_pel_16to32)(pel_t *dst, const uint8_t *src,
+					    int n);
+extern void		(*video_pel_24to32)(pel_t *dst, const uint8_t *src,
+					    int n);
+extern void		(*video_pel_pal)(pel_t *p, const uint32_t *pal, int n);
 extern int		fullchange;
 extern int		xsize,ysize;		// TBR
 extern int		enable_overscan,
@@ -150,6 +175,8 @@ extern int		cga_palette;
 
 extern float		cpuclock;
 extern int		frames;
+extern uint32_t		video_blits,
+			video_blit_drops;
 
 
 #ifdef EMU_DEVICE_H
@@ -363,12 +390,16 @@ extern const device_t	*video_card_getdevice(int card);
 
 extern void		video_blit_set(void(*)(bitmap_t *,int,int,int,int,int,int));
 extern void		video_blit_done(void);
-extern void		video_blit_wait(void);
-extern void		video_blit_wait_buffer(void);
+extern int		video_blit_queued(void);
 extern void		video_blit_start(int pal, int x, int y,
 					 int y1, int y2, int w, int h);
+extern const video_damage_t *video_blit_damage(void);
+extern void		video_damage_line(int y, int x1, int x2);
+extern void		video_damage_all(void);
 extern void		video_blend(int x, int y);
 extern void		video_palette_rebuild(void);
+extern void		video_pel_init(void);
+extern void		video_pel_bench(void);
 
 extern void		video_log(int level, const char *fmt, ...);
 extern void		video_init(void);
@@ -0,0 +1,528 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Pel conversion kernels for the renderers.
+ *
+ *		The SVGA renderers spend much of their time expanding
+ *		VRAM pixels into screen pels, one table lookup at a
+ *		time. These kernels do whole runs of pixels at once,
+ *		using SSE2 or AVX2 where the host has it, and a plain
+ *		C version everywhere else. All versions give exactly
+ *		the same results as the lookup tables in video.c.
+ *
+ *		SSE2 has no gather or byte shuffle, so for the 8bpp,
+ *		24bpp and palette kernels, the C version is used if
+ *		the host does not have AVX2.
+ *
+ * Version:	@(#)video_pel.c	1.0.1	2026/10/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *		Redistribution and  use  in source  and binary forms, with
+ *		or  without modification, are permitted  provided that the
+ *		following conditions are met:
+ *
+ *		1. Redistributions of  source  code must retain the entire
+ *		   above notice, this list of conditions and the following
+ *		   disclaimer.
+ *
+ *		2. Redistributions in binary form must reproduce the above
+ *		   copyright  notice,  this list  of  conditions  and  the
+ *		   following disclaimer in  the documentation and/or other
+ *		   materials provided with the distribution.
+ *
+ *		3. Neither the  name of the copyright holder nor the names
+ *		   of  its  contributors may be used to endorse or promote
+ *		   products  derived from  this  software without specific
+ *		   prior written permission.
+ *
+ * THIS SOFTWARE  IS  PROVIDED BY THE  COPYRIGHT  HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND  ANY EXPRESS  OR  IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE  ARE  DISCLAIMED. IN  NO  EVENT  SHALL THE COPYRIGHT
+ * HOLDER OR  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE  GOODS OR SERVICES;  LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED  AND ON  ANY
+ * THEORY OF  LIABILITY, WHETHER IN  CONTRACT, STRICT  LIABILITY, OR  TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "../../emu.h"
+#include "../../plat.h"
+#include "../../misc/random.h"
+#include "video.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+# define USE_SSE2
+# include <emmintrin.h>
+# if defined(_MSC_VER) || defined(__GNUC__)
+#  define USE_AVX2
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#   include <intrin.h>
+#   define AVX2_FUNC
+#  else
+#   define AVX2_FUNC	__attribute__((target("avx2")))
+#  endif
+# endif
+#endif
+
+
+#define BENCH_W		1024			// benchmark frame size
+#define BENCH_H		768
+#define BENCH_FRAMES	50
+
+
+typedef struct {
+    const char	*name;
+
+    void	(*p8)(pel_t *, const uint8_t *, const uint32_t *, int);
+    void	(*p15)(pel_t *, const uint8_t *, int);
+    void	(*p16)(pel_t *, const uint8_t *, int);
+    void	(*p24)(pel_t *, const uint8_t *, int);
+    void	(*pal)(pel_t *, const uint32_t *, int);
+} pel_impl_t;
+
+
+void	(*video_pel_8to32)(pel_t *, const uint8_t *, const uint32_t *, int);
+void	(*video_pel_15to32)(pel_t *, const uint8_t *, int);
+void	(*video_pel_16to32)(pel_t *, const uint8_t *, int);
+void	(*video_pel_24to32)(pel_t *, const uint8_t *, int);
+void	(*video_pel_pal)(pel_t *, const uint32_t *, int);
+
+
+static void
+pel_8to32_c(pel_t *dst, const uint8_t *src, const uint32_t *pal, int n)
+{
+    while (n-- > 0)
+	dst++->val = pal[*src++];
+}
+
+
+static void
+pel_15to32_c(pel_t *dst, const uint8_t *src, int n)
+{
+    while (n-- > 0) {
+	dst++->val = video_15to32[*(uint16_t *)src];
+	src += 2;
+    }
+}
+
+
+static void
+pel_16to32_c(pel_t *dst, const uint8_t *src, int n)
+{
+    while (n-- > 0) {
+	dst++->val = video_16to32[*(uint16_t *)src];
+	src += 2;
+    }
+}
+
+
+static void
+pel_24to32_c(pel_t *dst, const uint8_t *src, int n)
+{
+    while (n-- > 0) {
+	dst++->val = src[0] | (src[1] << 8) | (src[2] << 16);
+	src += 3;
+    }
+}
+
+
+static void
+pel_pal_c(pel_t *p, const uint32_t *pal, int n)
+{
+    while (n-- > 0) {
+	p->val = pal[p->pal];
+	p++;
+    }
+}
+
+
+#ifdef USE_SSE2
+/*
+ * The lookup tables scale each channel with floor(c * 255 / max),
+ * which we can do exactly in 16 bits:
+ *
+ *   5 bits:  (c * 1053) >> 7
+ *   6 bits:  (c * 259 + 3) >> 6
+ */
+static void
+pel_15to32_sse2(pel_t *dst, const uint8_t *src, int n)
+{
+    const __m128i mask = _mm_set1_epi16(0x1f);
+    const __m128i mul = _mm_set1_epi16(1053);
+    __m128i c, r, g, b;
+
+    for (; n >= 8; n -= 8) {
+	c = _mm_loadu_si128((const __m128i *)src);
+
+	b = _mm_and_si128(c, mask);
+	g = _mm_and_si128(_mm_srli_epi16(c, 5), mask);
+	r = _mm_and_si128(_mm_srli_epi16(c, 10), mask);
+	b = _mm_srli_epi16(_mm_mullo_epi16(b, mul), 7);
+	g = _mm_srli_epi16(_mm_mullo_epi16(g, mul), 7);
+	r = _mm_srli_epi16(_mm_mullo_epi16(r, mul), 7);
+
+	/* Now combine into 00RRGGBB. */
+	b = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(b, r));
+	_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(b, r));
+
+	src += 16;
+	dst += 8;
+    }
+
+    pel_15to32_c(dst, src, n);
+}
+
+
+static void
+pel_16to32_sse2(pel_t *dst, const uint8_t *src, int n)
+{
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+    const __m128i mul5 = _mm_set1_epi16(1053);
+    const __m128i mul6 = _mm_set1_epi16(259);
+    const __m128i add6 = _mm_set1_epi16(3);
+    __m128i c, r, g, b;
+
+    for (; n >= 8; n -= 8) {
+	c = _mm_loadu_si128((const __m128i *)src);
+
+	b = _mm_and_si128(c, mask5);
+	g = _mm_and_si128(_mm_srli_epi16(c, 5), mask6);
+	r = _mm_srli_epi16(c, 11);
+	b = _mm_srli_epi16(_mm_mullo_epi16(b, mul5), 7);
+	g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, mul6), add6), 6);
+	r = _mm_srli_epi16(_mm_mullo_epi16(r, mul5), 7);
+
+	b = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(b, r));
+	_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(b, r));
+
+	src += 16;
+	dst += 8;
+    }
+
+    pel_16to32_c(dst, src, n);
+}
+#endif
+
+
+#ifdef USE_AVX2
+static AVX2_FUNC void
+pel_8to32_avx2(pel_t *dst, const uint8_t *src, const uint32_t *pal, int n)
+{
+    __m256i idx;
+
+    for (; n >= 8; n -= 8) {
+	idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src));
+	_mm256_storeu_si256((__m256i *)dst,
+			    _mm256_i32gather_epi32((const int *)pal, idx, 4));
+
+	src += 8;
+	dst += 8;
+    }
+
+    pel_8to32_c(dst, src, pal, n);
+}
+
+
+/*
+ * The AVX2 unpack/pack instructions work within each 128-bit
+ * half, so we first put pixels 0-3 and 8-11 in the low half,
+ * and pixels 4-7 and 12-15 in the high half.
+ */
+static AVX2_FUNC void
+pel_15to32_avx2(pel_t *dst, const uint8_t *src, int n)
+{
+    const __m256i mask = _mm256_set1_epi16(0x1f);
+    const __m256i mul = _mm256_set1_epi16(1053);
+    __m256i c, r, g, b;
+
+    for (; n >= 16; n -= 16) {
+	c = _mm256_loadu_si256((const __m256i *)src);
+	c = _mm256_permute4x64_epi64(c, 0xd8);
+
+	b = _mm256_and_si256(c, mask);
+	g = _mm256_and_si256(_mm256_srli_epi16(c, 5), mask);
+	r = _mm256_and_si256(_mm256_srli_epi16(c, 10), mask);
+	b = _mm256_srli_epi16(_mm256_mullo_epi16(b, mul), 7);
+	g = _mm256_srli_epi16(_mm256_mullo_epi16(g, mul), 7);
+	r = _mm256_srli_epi16(_mm256_mullo_epi16(r, mul), 7);
+
+	b = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+	_mm256_storeu_si256((__m256i *)dst, _mm256_unpacklo_epi16(b, r));
+	_mm256_storeu_si256((__m256i *)(dst + 8), _mm256_unpackhi_epi16(b, r));
+
+	src += 32;
+	dst += 16;
+    }
+
+    pel_15to32_sse2(dst, src, n);
+}
+
+
+static AVX2_FUNC void
+pel_16to32_avx2(pel_t *dst, const uint8_t *src, int n)
+{
+    const __m256i mask5 = _mm256_set1_epi16(0x1f);
+    const __m256i mask6 = _mm256_set1_epi16(0x3f);
+    const __m256i mul5 = _mm256_set1_epi16(1053);
+    const __m256i mul6 = _mm256_set1_epi16(259);
+    const __m256i add6 = _mm256_set1_epi16(3);
+    __m256i c, r, g, b;
+
+    for (; n >= 16; n -= 16) {
+	c = _mm256_loadu_si256((const __m256i *)src);
+	c = _mm256_permute4x64_epi64(c, 0xd8);
+
+	b = _mm256_and_si256(c, mask5);
+	g = _mm256_and_si256(_mm256_srli_epi16(c, 5), mask6);
+	r = _mm256_srli_epi16(c, 11);
+	b = _mm256_srli_epi16(_mm256_mullo_epi16(b, mul5), 7);
+	g = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(g, mul6), add6), 6);
+	r = _mm256_srli_epi16(_mm256_mullo_epi16(r, mul5), 7);
+
+	b = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+	_mm256_storeu_si256((__m256i *)dst, _mm256_unpacklo_epi16(b, r));
+	_mm256_storeu_si256((__m256i *)(dst + 8), _mm256_unpackhi_epi16(b, r));
+
+	src += 32;
+	dst += 16;
+    }
+
+    pel_16to32_sse2(dst, src, n);
+}
+
+
+/*
+ * We load 32 bytes to get 8 pixels (24 bytes), so stop while
+ * there are still at least 32 bytes left in the source.
+ */
+static AVX2_FUNC void
+pel_24to32_avx2(pel_t *dst, const uint8_t *src, int n)
+{
+    const __m256i perm = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i shuf = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+					  6, 7, 8, -1, 9, 10, 11, -1,
+					  0, 1, 2, -1, 3, 4, 5, -1,
+					  6, 7, 8, -1, 9, 10, 11, -1);
+    __m256i c;
+
+    for (; n >= 11; n -= 8) {
+	c = _mm256_loadu_si256((const __m256i *)src);
+	c = _mm256_permutevar8x32_epi32(c, perm);
+	_mm256_storeu_si256((__m256i *)dst, _mm256_shuffle_epi8(c, shuf));
+
+	src += 24;
+	dst += 8;
+    }
+
+    pel_24to32_c(dst, src, n);
+}
+
+
+static AVX2_FUNC void
+pel_pal_avx2(pel_t *p, const uint32_t *pal, int n)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i idx;
+
+    for (; n >= 8; n -= 8) {
+	idx = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)p), mask);
+	_mm256_storeu_si256((__m256i *)p,
+			    _mm256_i32gather_epi32((const int *)pal, idx, 4));
+
+	p += 8;
+    }
+
+    pel_pal_c(p, pal, n);
+}
+
+
+/* See if the host (and its OS) can do AVX2. */
+static int
+have_avx2(void)
+{
+# ifdef _MSC_VER
+    int regs[4];
+
+    __cpuid(regs, 1);
+    if (!(regs[2] & (1 << 27)) || ((_xgetbv(0) & 6) != 6))
+	return(0);
+
+    __cpuidex(regs, 7, 0);
+
+    return((regs[1] >> 5) & 1);
+# else
+    __builtin_cpu_init();
+
+    return(__builtin_cpu_supports("avx2") ? 1 : 0);
+# endif
+}
+#endif
+
+
+static const pel_impl_t impls[] = {
+    { "C",
+      pel_8to32_c, pel_15to32_c, pel_16to32_c, pel_24to32_c, pel_pal_c },
+#ifdef USE_SSE2
+    { "SSE2",
+      pel_8to32_c, pel_15to32_sse2, pel_16to32_sse2, pel_24to32_c, pel_pal_c },
+#endif
+#ifdef USE_AVX2
+    { "AVX2",
+      pel_8to32_avx2, pel_15to32_avx2, pel_16to32_avx2, pel_24to32_avx2,
+      pel_pal_avx2 },
+#endif
+    { NULL }
+};
+
+
+/* Select the best kernels for this host. */
+void
+video_pel_init(void)
+{
+    const pel_impl_t *impl = &impls[0];
+
+#ifdef USE_SSE2
+    impl = &impls[1];
+#endif
+#ifdef USE_AVX2
+    if (have_avx2())
+	impl = &impls[2];
+#endif
+
+    video_pel_8to32 = impl->p8;
+    video_pel_15to32 = impl->p15;
+    video_pel_16to32 = impl->p16;
+    video_pel_24to32 = impl->p24;
+    video_pel_pal = impl->pal;
+
+    INFO("VIDEO: using %s pel conversion\n", impl->name);
+}
+
+
+/* Run one kernel over a test frame, return its speed in Mpels/s. */
+static double
+bench_run(const pel_impl_t *impl, int mode, pel_t *dst, const uint8_t *src)
+{
+    uint64_t start, ticks;
+    int f, y;
+
+    start = plat_timer_read();
+
+    for (f = 0; f < BENCH_FRAMES; f++) for (y = 0; y < BENCH_H; y++) {
+	switch (mode) {
+		case 8:
+			impl->p8(&dst[y * BENCH_W], &src[y * BENCH_W],
+				 pal_lookup, BENCH_W);
+			break;
+
+		case 15:
+			impl->p15(&dst[y * BENCH_W], &src[y * BENCH_W * 2],
+				  BENCH_W);
+			break;
+
+		case 16:
+			impl->p16(&dst[y * BENCH_W], &src[y * BENCH_W * 2],
+				  BENCH_W);
+			break;
+
+		case 24:
+			impl->p24(&dst[y * BENCH_W], &src[y * BENCH_W * 3],
+				  BENCH_W);
+			break;
+
+		default:
+			impl->pal(&dst[y * BENCH_W], pal_lookup, BENCH_W);
+			break;
+	}
+    }
+
+    ticks = plat_timer_read() - start;
+    if (ticks == 0)
+	ticks = 1;
+
+    return(((double)BENCH_W * BENCH_H * BENCH_FRAMES) /
+	   ((double)ticks / plat_timer_freq()) / 1000000.0);
+}
+
+
+/*
+ * Measure all available kernels.
+ *
+ * For each mode, every version is run over a 1024x768 frame
+ * of random data, and its output is checked against the C
+ * version, so this also tells us if a kernel is broken.
+ */
+void
+video_pel_bench(void)
+{
+    static const int modes[] = { 8, 15, 16, 24, 0 };
+    const pel_impl_t *impl;
+    pel_t *dst, *ref;
+    uint8_t *src;
+    double mpels;
+    int i, m, sz;
+
+    sz = BENCH_W * BENCH_H;
+    src = (uint8_t *)mem_alloc(sz * 3 + 32);
+    dst = (pel_t *)mem_alloc(sz * sizeof(pel_t));
+    ref = (pel_t *)mem_alloc(sz * sizeof(pel_t));
+    for (i = 0; i < (sz * 3 + 32); i++)
+	src[i] = random_generate();
+
+    for (m = 0; m < (int)(sizeof(modes) / sizeof(int)); m++) {
+	for (impl = impls; impl->name != NULL; impl++) {
+#ifdef USE_AVX2
+		if (!strcmp(impl->name, "AVX2") && !have_avx2())
+			continue;
+#endif
+		/* The palette kernel works in place. */
+		for (i = 0; i < sz; i++)
+			dst[i].val = src[i];
+
+		mpels = bench_run(impl, modes[m], dst, src);
+
+		/* The in-place one ran many times, so redo it once. */
+		if (modes[m] == 0) {
+			for (i = 0; i < sz; i++)
+				dst[i].val = src[i];
+			impl->pal(dst, pal_lookup, sz);
+		}
+
+		/* The first one is the C version. */
+		if (impl == impls)
+			memcpy(ref, dst, sz * sizeof(pel_t));
+
+		INFO("VIDEO: %-4s %2ibpp %8.1f Mpels/s%s\n",
+		     impl->name, modes[m] ? modes[m] : 8, mpels,
+		     modes[m] ? "" : " (palette)");
+
+		if (memcmp(ref, dst, sz * sizeof(pel_t)))
+			ERRLOG("VIDEO: %s %ibpp kernel does not match C version!\n",
+			       impl->name, modes[m]);
+	}
+    }
+
+    free(ref);
+    free(dst);
+    free(src);
+}
@@ -8,11 +8,11 @@
  *
  *		Main include file for the application.
  *
- * Version:	@(#)emu.h	1.0.39	2021/09/30
+ * Version:	@(#)emu.h	1.0.41	2026/10/17
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -178,8 +178,12 @@ extern int	video_fps;			// (O) render speed in fps
 extern int	config_ro;			// (O) dont modify cfg file
 extern int	config_keep_space;		// (O) keep spaces in cfg
 extern int	settings_only;			// (O) only the settings dlg
+extern int	bench_secs;			// (O) benchmark run time
+extern int	bench_port;			// (O) benchmark 'done' port
 extern int	log_level;			// (O) global logging level
 extern wchar_t	log_path[1024];			// (O) full path of logfile
+extern wchar_t	state_load_path[1024];		// (O) state to restore
+extern wchar_t	state_save_path[1024];		// (O) state to save
 
 /* Global variables. */
 extern char	emu_title[64];			// full name of application
@@ -252,6 +256,7 @@ extern void		pc_reset(int hard);
 extern void		pc_reload(const wchar_t *fn);
 extern void		pc_set_speed(int);
 extern void		pc_thread(void *param);
+extern int		pc_bench(void);
 extern void		pc_pause(int p);
 extern void		pc_onesec(void);
 extern void		set_screen_size(int x, int y);
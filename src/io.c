@@ -8,13 +8,13 @@
  *
  *		Implement I/O ports and their operations.
  *
- * Version:	@(#)io.c	1.0.6	2019/05/17
+ * Version:	@(#)io.c	1.0.7	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -40,10 +40,12 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <wchar.h>
 #include "emu.h"
 #include "io.h"
 #include "cpu/cpu.h"
+#include "plat.h"
 
 
 #define NPORTS		65536		/* PC/AT supports 64K ports */
@@ -64,10 +66,75 @@ typedef struct _io_ {
     struct _io_ *prev, *next;
 } io_t;
 
+/*
+ * Compiled dispatch entry for a port.
+ *
+ * Nearly every port has only one handler, so for each access
+ * width we keep a direct pointer to the handler that serves
+ * it. Byte accesses go to all handlers of a port, so only if
+ * more than one of them has a byte handler do we flag it, and
+ * walk the chain. For the wider accesses only the first one
+ * counts, and a NULL pointer means the access gets split.
+ */
+typedef struct {
+    io_t	*inb, *outb;
+    io_t	*inw, *outw;
+    io_t	*inl, *outl;
+    uint8_t	flags;
+#define IO_MULTI_IN	0x01			// more than one inb handler
+#define IO_MULTI_OUT	0x02			// more than one outb handler
+} iodisp_t;
+
+
+/* Per-port profiling counters. */
+typedef struct {
+    uint32_t	rd[3],				// reads, per width
+		wr[3];				// writes, per width
+    uint64_t	ticks;				// host time in handlers
+} ioprof_t;
+
+
+int		io_prof_enabled = 0;
+
 
 static io_t	**io = NULL,
 		**io_last = NULL;
-  
+static iodisp_t	*io_disp = NULL;
+static ioprof_t	*io_prof = NULL;
+
+
+/* (Re-)build the dispatch entry for a port from its chain. */
+static void
+io_compile(int c)
+{
+    iodisp_t *d = &io_disp[c];
+    io_t *p;
+
+    memset(d, 0x00, sizeof(iodisp_t));
+
+    for (p = io[c]; p != NULL; p = p->next) {
+	if (p->inb != NULL) {
+		if (d->inb != NULL)
+			d->flags |= IO_MULTI_IN;
+		else
+			d->inb = p;
+	}
+	if (p->outb != NULL) {
+		if (d->outb != NULL)
+			d->flags |= IO_MULTI_OUT;
+		else
+			d->outb = p;
+	}
+	if ((p->inw != NULL) && (d->inw == NULL))
+		d->inw = p;
+	if ((p->outw != NULL) && (d->outw == NULL))
+		d->outw = p;
+	if ((p->inl != NULL) && (d->inl == NULL))
+		d->inl = p;
+	if ((p->outl != NULL) && (d->outl == NULL))
+		d->outl = p;
+    }
+}
 
 /* Add an I/O handler to the chain. */
 static void
@@ -194,6 +261,8 @@ io_reset(void)
 	memset(io, 0x00, c);
 	io_last = (io_t **)mem_alloc(c);
 	memset(io_last, 0x00, c);
+	c = sizeof(iodisp_t) * NPORTS;
+	io_disp = (iodisp_t *)mem_alloc(c);
     }
 
     /* Clear both arrays. */
@@ -215,6 +284,8 @@ io_reset(void)
 	/* Add a default (catch) handler. */
 	catch_add(c);
 #endif
+
+	io_compile(c);
     }
 }
 
@@ -248,6 +319,8 @@ io_sethandler(uint16_t base, int size,
 
 	/* Insert this new handler. */
 	io_insert(base + c, p);
+
+	io_compile(base + c);
     }
 }
 
@@ -276,6 +349,7 @@ io_removehandler(uint16_t base, int size,
 		    (p->outw == f_outw) && (p->outl == f_outl) &&
 		    (p->priv == priv)) {
 			io_unlink(base + c);
+			io_compile(base + c);
 			p = NULL;
 			break;
 		}
@@ -316,6 +390,8 @@ io_sethandler_interleaved(uint16_t base, int size,
 	q->outb = f_outb; q->outw = f_outw; q->outl = f_outl;
 
 	q->priv = priv;
+
+	io_compile(base + c);
     }
 }
 
@@ -348,6 +424,7 @@ io_removehandler_interleaved(uint16_t base, int size,
 			if (p->next != NULL)
 				p->next->prev = p->prev;
 			free(p);
+			io_compile(base + c);
 			break;
 		}
 		p = p->next;
@@ -357,18 +434,21 @@ io_removehandler_interleaved(uint16_t base, int size,
 #endif
 
 
-uint8_t
-inb(uint16_t port)
+static uint8_t
+io_inb(uint16_t port)
 {
+    iodisp_t *d = &io_disp[port];
     uint8_t r = 0xff;
     io_t *p;
 
-    p = io[port];
-    while(p != NULL) {
-	if (p->inb != NULL)
-		r &= p->inb(port, p->priv);
-	p = p->next;
-    }
+    if (d->flags & IO_MULTI_IN) {
+	/* Shared port, collect from all handlers. */
+	for (p = io[port]; p != NULL; p = p->next) {
+		if (p->inb != NULL)
+			r &= p->inb(port, p->priv);
+	}
+    } else if (d->inb != NULL)
+	r = d->inb->inb(port, d->inb->priv);
 
 #ifdef IO_TRACE
     if (CS == IO_TRACE)
@@ -379,19 +459,20 @@ inb(uint16_t port)
 }
 
 
-void
-outb(uint16_t port, uint8_t val)
+static void
+io_outb(uint16_t port, uint8_t val)
 {
+    iodisp_t *d = &io_disp[port];
     io_t *p;
 
-    if (io[port] != NULL) {
-	p = io[port];
-	while (p != NULL) {
+    if (d->flags & IO_MULTI_OUT) {
+	/* Shared port, send to all handlers. */
+	for (p = io[port]; p != NULL; p = p->next) {
 		if (p->outb != NULL)
 			p->outb(port, val, p->priv);
-		p = p->next;
 	}
-    }
+    } else if (d->outb != NULL)
+	d->outb->outb(port, val, d->outb->priv);
 
 #ifdef IO_TRACE
     if (CS == IO_TRACE)
@@ -400,71 +481,260 @@ outb(uint16_t port, uint8_t val)
 }
 
 
+static uint16_t
+io_inw(uint16_t port)
+{
+    io_t *p = io_disp[port].inw;
+
+    if (p != NULL)
+	return(p->inw(port, p->priv));
+
+    return(io_inb(port) | (io_inb(port + 1) << 8));
+}
+
+
+static void
+io_outw(uint16_t port, uint16_t val)
+{
+    io_t *p = io_disp[port].outw;
+
+    if (p != NULL) {
+	p->outw(port, val, p->priv);
+	return;
+    }
+
+    io_outb(port,val & 0xff);
+    io_outb(port+1,val>>8);
+}
+
+
+static uint32_t
+io_inl(uint16_t port)
+{
+    io_t *p = io_disp[port].inl;
+
+    if (p != NULL)
+	return(p->inl(port, p->priv));
+
+    return(io_inw(port) | (io_inw(port + 2) << 16));
+}
+
+
+static void
+io_outl(uint16_t port, uint32_t val)
+{
+    io_t *p = io_disp[port].outl;
+
+    if (p != NULL) {
+	p->outl(port, val, p->priv);
+	return;
+    }
+
+    io_outw(port, val);
+    io_outw(port + 2, val >> 16);
+}
+
+
+/* Account for one access to a port. */
+static void
+prof_add(uint16_t port, int wr, int width, uint64_t ticks)
+{
+    ioprof_t *p = &io_prof[port];
+
+    if (wr)
+	p->wr[width]++;
+    else
+	p->rd[width]++;
+    p->ticks += ticks;
+}
+
+
+uint8_t
+inb(uint16_t port)
+{
+    uint64_t start;
+    uint8_t r;
+
+    if (! io_prof_enabled)
+	return(io_inb(port));
+
+    start = plat_timer_read();
+    r = io_inb(port);
+    prof_add(port, 0, 0, plat_timer_read() - start);
+
+    return(r);
+}
+
+
+void
+outb(uint16_t port, uint8_t val)
+{
+    uint64_t start;
+
+    if (! io_prof_enabled) {
+	io_outb(port, val);
+	return;
+    }
+
+    start = plat_timer_read();
+    io_outb(port, val);
+    prof_add(port, 1, 0, plat_timer_read() - start);
+}
+
+
 uint16_t
 inw(uint16_t port)
 {
-    io_t *p;
+    uint64_t start;
+    uint16_t r;
 
-    p = io[port];
-    while(p != NULL) {
-	if (p->inw != NULL)
-		return(p->inw(port, p->priv));
-	p = p->next;
-    }
+    if (! io_prof_enabled)
+	return(io_inw(port));
 
-    return(inb(port) | (inb(port + 1) << 8));
+    start = plat_timer_read();
+    r = io_inw(port);
+    prof_add(port, 0, 1, plat_timer_read() - start);
+
+    return(r);
 }
 
 
 void
 outw(uint16_t port, uint16_t val)
 {
-    io_t *p;
+    uint64_t start;
 
-    p = io[port];
-    while(p != NULL) {
-	if (p->outw != NULL) {
-		p->outw(port, val, p->priv);
-		return;
-	}
-	p = p->next;
+    if (! io_prof_enabled) {
+	io_outw(port, val);
+	return;
     }
 
-    outb(port,val & 0xff);
-    outb(port+1,val>>8);
+    start = plat_timer_read();
+    io_outw(port, val);
+    prof_add(port, 1, 1, plat_timer_read() - start);
 }
 
 
 uint32_t
 inl(uint16_t port)
 {
-    io_t *p;
+    uint64_t start;
+    uint32_t r;
 
-    p = io[port];
-    while(p != NULL) {
-	if (p->inl != NULL)
-		return(p->inl(port, p->priv));
-	p = p->next;
-    }
+    if (! io_prof_enabled)
+	return(io_inl(port));
+
+    start = plat_timer_read();
+    r = io_inl(port);
+    prof_add(port, 0, 2, plat_timer_read() - start);
 
-    return(inw(port) | (inw(port + 2) << 16));
+    return(r);
 }
 
 
 void
 outl(uint16_t port, uint32_t val)
 {
-    io_t *p;
+    uint64_t start;
 
-    p = io[port];
-    while(p != NULL) {
-	if (p->outl != NULL) {
-		p->outl(port, val, p->priv);
-		return;
+    if (! io_prof_enabled) {
+	io_outl(port, val);
+	return;
+    }
+
+    start = plat_timer_read();
+    io_outl(port, val);
+    prof_add(port, 1, 2, plat_timer_read() - start);
+}
+
+
+/* Start profiling port accesses, with fresh counters. */
+void
+io_prof_start(void)
+{
+    int c = sizeof(ioprof_t) * NPORTS;
+
+    if (io_prof == NULL)
+	io_prof = (ioprof_t *)mem_alloc(c);
+    memset(io_prof, 0x00, c);
+
+    io_prof_enabled = 1;
+}
+
+
+/* Stop profiling, but keep the counters for a report. */
+void
+io_prof_stop(void)
+{
+    io_prof_enabled = 0;
+}
+
+
+/* Convert host timer ticks to nanoseconds. */
+static uint64_t
+prof_ns(uint64_t ticks, uint64_t freq)
+{
+    return(((ticks / freq) * 1000000000ULL) +
+	   (((ticks % freq) * 1000000000ULL) / freq));
+}
+
+
+static int
+prof_cmp(const void *a, const void *b)
+{
+    const ioprof_t *p = &io_prof[*(const uint16_t *)a];
+    const ioprof_t *q = &io_prof[*(const uint16_t *)b];
+
+    if (p->ticks != q->ticks)
+	return((p->ticks < q->ticks) ? 1 : -1);
+
+    return(*(const uint16_t *)a - *(const uint16_t *)b);
+}
+
+
+/* Write a report of all accessed ports, busiest first. */
+void
+io_prof_dump(void)
+{
+    uint64_t freq, total = 0;
+    uint32_t hits;
+    uint16_t *ports;
+    ioprof_t *p;
+    int c, n = 0;
+
+    if (io_prof == NULL)
+	return;
+
+    ports = (uint16_t *)mem_alloc(sizeof(uint16_t) * NPORTS);
+    for (c = 0; c < NPORTS; c++) {
+	p = &io_prof[c];
+	if (p->rd[0] || p->rd[1] || p->rd[2] ||
+	    p->wr[0] || p->wr[1] || p->wr[2]) {
+		ports[n++] = (uint16_t)c;
+		total += p->ticks;
 	}
-	p = p->next;
+    }
+    qsort(ports, n, sizeof(uint16_t), prof_cmp);
+
+    freq = plat_timer_freq();
+    if (freq == 0)
+	freq = 1;
+
+    INFO("IO: port profile, %i ports, %" PRIu64 " ns in handlers:\n",
+	 n, prof_ns(total, freq));
+    INFO("IO:  port   inb/inw/inl                 outb/outw/outl"
+	 "              time(ns)    avg   %%\n");
+    for (c = 0; c < n; c++) {
+	p = &io_prof[ports[c]];
+	hits = p->rd[0] + p->rd[1] + p->rd[2] +
+	       p->wr[0] + p->wr[1] + p->wr[2];
+	INFO("IO:  %04x   %-8u/%-8u/%-8u  %-8u/%-8u/%-8u  %-12" PRIu64 "%-6" PRIu64 "%3i\n",
+	     ports[c], p->rd[0], p->rd[1], p->rd[2],
+	     p->wr[0], p->wr[1], p->wr[2],
+	     prof_ns(p->ticks, freq),
+	     prof_ns(p->ticks, freq) / hits,
+	     total ? (int)((p->ticks * 100) / total) : 0);
     }
 
-    outw(port, val);
-    outw(port + 2, val >> 16);
+    free(ports);
 }
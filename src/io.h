@@ -8,13 +8,13 @@
  *
  *		Definitions for the I/O handler.
  *
- * Version:	@(#)io.h	1.0.3	2019/05/13
+ * Version:	@(#)io.h	1.0.4	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -40,6 +40,9 @@
 # define EMU_IO_H
 
 
+extern int	io_prof_enabled;
+
+
 extern void	io_reset(void);
 
 extern void	io_sethandler(uint16_t base, int size,
@@ -87,5 +90,9 @@ extern void	outw(uint16_t port, uint16_t val);
 extern uint32_t	inl(uint16_t port);
 extern void	outl(uint16_t port, uint32_t val);
 
+extern void	io_prof_start(void);
+extern void	io_prof_stop(void);
+extern void	io_prof_dump(void);
+
 
 #endif	/*EMU_IO_H*/
@@ -25,13 +25,13 @@
  *		 by the ROS.
  *  PPC:	MDA Monitor results in half-screen, half-cell-height display??
  *
- * Version:	@(#)m_amstrad_vid.c	1.0.9	2021/05/24
+ * Version:	@(#)m_amstrad_vid.c	1.0.10	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		John Elliott, <jce@seasip.info>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2017-2019 John Elliott.
  *
@@ -344,7 +344,6 @@ pc1512_poll(priv_t priv)
 	if (dev->dispon) {
 		if (dev->displine < dev->firstline) {
 			dev->firstline = dev->displine;
-			video_blit_wait_buffer();
 		}
 		dev->lastline = dev->displine;
 
@@ -997,7 +996,6 @@ lcd_poll_mda(vid_t *dev)
 	if (mda->dispon) {
 		if (mda->displine < mda->firstline) {
 			mda->firstline = mda->displine;
-			video_blit_wait_buffer();
 		}
 		mda->lastline = mda->displine;
 
@@ -1141,7 +1139,6 @@ lcd_poll_cga(vid_t *dev)
 	if (cga->cgadispon) {
 		if (cga->displine < cga->firstline) {
 			cga->firstline = cga->displine;
-			video_blit_wait_buffer();
 		}
 		cga->lastline = cga->displine;
 
@@ -19,14 +19,14 @@
  *		plasma display. The code for this was taken from the code
  *		for the Toshiba 3100e machine, which used a similar display.
  *
- * Version:	@(#)m_compaq_vid.c	1.0.4	2019/05/17
+ * Version:	@(#)m_compaq_vid.c	1.0.5	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		TheCollector1995, <mariogplayer@gmail.com>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -273,7 +273,6 @@ vid_poll_plasma(priv_t priv)
 	if (dev->dispon) {
                 if (cga->displine < cga->firstline) {
                         cga->firstline = cga->displine;
-                        video_blit_wait_buffer();
                 }
                 cga->lastline = cga->displine;
 
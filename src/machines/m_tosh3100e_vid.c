@@ -22,13 +22,13 @@
  *		61 50 52 0F 19 06 19 19 02 0D 0B 0C   MONO
  *		2D 28 22 0A 67 00 64 67 02 03 06 07   640x400
  *
- * Version:	@(#)m_t3100e_vid.c	1.0.15	2021/03/18
+ * Version:	@(#)m_t3100e_vid.c	1.0.16	2026/10/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -591,9 +591,6 @@ vid_poll(priv_t priv)
 	dev->cga.cgastat |= 1;
 	dev->linepos = 1;
 	if (dev->dispon) {
-		if (dev->displine == 0)
-			video_blit_wait_buffer();
-
 		/* Graphics */
 		if (dev->cga.cgamode & 0x02)	{
 			if (dev->cga.cgamode & 0x10)
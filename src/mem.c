@@ -10,13 +10,13 @@
  *
  * **NOTES**	The cpu-specific MMU code should be moved to cpu/mmu.c.
  *
- * Version:	@(#)mem.c	1.0.41	2021/03/16
+ * Version:	@(#)mem.c	1.0.43	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2021 Miran Grca.
  *		Copyright 2008-2020 Sarah Walker.
  *
@@ -52,6 +52,7 @@
 #include "io.h"
 #include "mem.h"
 #include "rom.h"
+#include "state.h"
 #include "plat.h"
 #ifdef USE_DYNAREC
 # include "cpu/codegen.h"
@@ -109,8 +110,11 @@ static mem_map_t	*read_mapping[0x40000];
 static mem_map_t	*write_mapping[0x40000];
 static uint8_t		*_mem_exec[0x40000];
 static int		_mem_state[0x40000];
+static size_t		ram_size;		/* size of RAM block */
 
 static uint8_t		ff_pccache[4] = { 0xff, 0xff, 0xff, 0xff };
+static int		readlnum,		/* #slots used since flush */
+			writelnum;
 
 
 int
@@ -143,22 +147,31 @@ resetreadlookup(void)
     memset(readlookup2, 0xff, (1<<20)*sizeof(uintptr_t));
     memset(writelookup2, 0xff, (1<<20)*sizeof(uintptr_t));
 
-    readlnext = 0;
-    writelnext = 0;
+    readlnext = readlnum = 0;
+    writelnext = writelnum = 0;
     pccache = 0xffffffff;
 }
 
 
-void
-flushmmucache(void)
+/*
+ * Drop all entries from the software TLB.
+ *
+ * The lookup rings are refilled from slot 0 after each flush,
+ * so we only have to visit the slots used since the last one.
+ */
+static void
+mmu_flush_tlb(void)
 {
     int c;
 
-    for (c = 0; c < 256; c++) {
+    for (c = 0; c < readlnum; c++) {
 	if (readlookup[c] != (int)0xffffffff) {
 		readlookup2[readlookup[c]] = -1;
 		readlookup[c] = 0xffffffff;
 	}
+    }
+
+    for (c = 0; c < writelnum; c++) {
 	if (writelookup[c] != (int)0xffffffff) {
 		page_lookup[writelookup[c]] = NULL;
 		writelookup2[writelookup[c]] = -1;
@@ -166,6 +179,21 @@ flushmmucache(void)
 	}
     }
 
+    readlnext = readlnum = 0;
+    writelnext = writelnum = 0;
+
+#ifdef USE_DYNAREC
+    /* Chained code blocks assume an unchanged mapping. */
+    codegen_chain_break = 1;
+#endif
+}
+
+
+void
+flushmmucache(void)
+{
+    mmu_flush_tlb();
+
     pccache = (uint32_t)0xffffffff;
 #ifdef _MSC_VER
     pccache2 = (uint8_t *)0xffffffffffffffff;
@@ -182,38 +210,14 @@ flushmmucache(void)
 void
 flushmmucache_nopc(void)
 {
-    int c;
-
-    for (c = 0; c < 256; c++) {
-	if (readlookup[c] != (int)0xffffffff) {
-		readlookup2[readlookup[c]] = -1;
-		readlookup[c] = 0xffffffff;
-	}
-	if (writelookup[c] != (int)0xffffffff) {
-		page_lookup[writelookup[c]] = NULL;
-		writelookup2[writelookup[c]] = -1;
-		writelookup[c] = 0xffffffff;
-	}
-    }
+    mmu_flush_tlb();
 }
 
 
 void
 flushmmucache_cr3(void)
 {
-    int c;
-
-    for (c = 0; c < 256; c++) {
-	if (readlookup[c] != (int)0xffffffff) {
-		readlookup2[readlookup[c]] = -1;
-		readlookup[c] = 0xffffffff;
-	}
-	if (writelookup[c] != (int)0xffffffff) {
-		page_lookup[writelookup[c]] = NULL;
-		writelookup2[writelookup[c]] = -1;
-		writelookup[c] = 0xffffffff;
-	}
-    }
+    mmu_flush_tlb();
 }
 
 
@@ -221,12 +225,13 @@ void
 mem_flush_write_page(uint32_t addr, uint32_t virt)
 {
     page_t *page_target = &pages[addr >> 12];
+    uintptr_t target;
     int c;
 
-    for (c = 0; c < 256; c++) {
-	if (writelookup[c] != (int)0xffffffff) {
-		uintptr_t target = (uintptr_t)&ram[(uintptr_t)(addr & ~0xfff) - (virt & ~0xfff)];
+    target = (uintptr_t)&ram[(uintptr_t)(addr & ~0xfff) - (virt & ~0xfff)];
 
+    for (c = 0; c < writelnum; c++) {
+	if (writelookup[c] != (int)0xffffffff) {
 		if (writelookup2[writelookup[c]] == target || page_lookup[writelookup[c]] == page_target) {
 			writelookup2[writelookup[c]] = -1;
 			page_lookup[writelookup[c]] = NULL;
@@ -335,10 +340,33 @@ mmutranslate_noabrt(uint32_t addr, int rw)
 }
 
 
+/*
+ * Invalidate the TLB entries for a single page (INVLPG.)
+ *
+ * The slot in the lookup ring keeps its (now stale) page number,
+ * which at worst costs a spurious miss when it gets recycled. We
+ * keep 4K entries only, so with large pages enabled, we cannot
+ * tell which entries belong to the 4M page, and flush them all.
+ */
 void
-mmu_invalidate(UNUSED(uint32_t addr))
+mmu_invalidate(uint32_t addr)
 {
-    flushmmucache_cr3();
+    if (cr4 & CR4_PSE) {
+	flushmmucache_cr3();
+	return;
+    }
+
+    addr >>= 12;
+    readlookup2[addr] = -1;
+    writelookup2[addr] = -1;
+    page_lookup[addr] = NULL;
+
+    if (pccache == addr)
+	pccache = 0xffffffff;
+
+#ifdef USE_DYNAREC
+    codegen_chain_break = 1;
+#endif
 }
 
 
@@ -377,6 +405,8 @@ addreadlookup(uint32_t virt, uint32_t phys)
 
     readlookupp[readlnext] = mmu_perm;
     readlookup[readlnext++] = virt >> 12;
+    if (readlnum < readlnext)
+	readlnum = readlnext;
     readlnext &= (cachesize-1);
 
     cycles -= 9;
@@ -406,6 +436,8 @@ addwritelookup(uint32_t virt, uint32_t phys)
 
     writelookupp[writelnext] = mmu_perm;
     writelookup[writelnext++] = virt >> 12;
+    if (writelnum < writelnext)
+	writelnum = writelnext;
     writelnext &= (cachesize - 1);
 
     cycles -= 9;
@@ -1002,6 +1034,85 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
 }
 
 
+/*
+ * Read a block of physical memory, for bus masters.
+ *
+ * The mappings are resolved once per 16K granule; anything with
+ * an exec pointer is plain memory and is copied in one go, and
+ * only device memory goes through its handlers byte by byte.
+ */
+void
+mem_read_phys(void *dest, uint32_t addr, int len)
+{
+    uint8_t *ptr = (uint8_t *)dest;
+    mem_map_t *map;
+    uint8_t *exec;
+    int c, i;
+
+    while (len > 0) {
+	c = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+	if (c > len)
+		c = len;
+
+	exec = _mem_exec[addr >> MEM_GRANULARITY_BITS];
+	map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+
+	if (exec != NULL)
+		memcpy(ptr, &exec[addr & MEM_GRANULARITY_MASK], c);
+	else if (map && map->read_b) {
+		for (i = 0; i < c; i++)
+			ptr[i] = map->read_b(addr + i, map->p);
+	} else
+		memset(ptr, 0xff, c);
+
+	ptr += c;
+	addr += c;
+	len -= c;
+    }
+}
+
+
+/*
+ * Write a block of physical memory, for bus masters.
+ *
+ * Only granules mapped to system RAM are copied directly, all
+ * others go through their mapping's write handler. The code
+ * pages in the range are invalidated once, at the end.
+ */
+void
+mem_write_phys(const void *src, uint32_t addr, int len)
+{
+    const uint8_t *ptr = (const uint8_t *)src;
+    uint32_t start = addr;
+    mem_map_t *map;
+    int c, i;
+
+    if (len <= 0)
+	return;
+
+    while (len > 0) {
+	c = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+	if (c > len)
+		c = len;
+
+	map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+
+	if (map && map->exec && (map->write_b == mem_write_ram))
+		memcpy(&map->exec[addr - map->base], ptr, c);
+	else if (map && map->write_b) {
+		for (i = 0; i < c; i++)
+			map->write_b(addr + i, ptr[i], map->p);
+	}
+
+	ptr += c;
+	addr += c;
+	len -= c;
+    }
+
+    mem_invalidate_range(start, addr - 1);
+}
+
+
 uint8_t
 mem_read_ram(uint32_t addr, UNUSED(priv_t priv))
 {
@@ -1501,9 +1612,11 @@ mem_reset(void)
 
     m = 1024UL * mem_size;
     if (ram != NULL)
-	free(ram);
-    ram = (uint8_t *)mem_alloc(m);	/* allocate and clear the RAM block */
-    memset(ram, 0x00, m);
+	plat_ram_free(ram, ram_size);
+    ram_size = m;
+    ram = (uint8_t *)plat_ram_alloc(ram_size);	/* comes zeroed */
+    if (ram == NULL)
+	fatal("MEM: unable to allocate %iKB of RAM!\n", mem_size);
 
     /*
      * Allocate the page table based on how much RAM we have.
@@ -1686,6 +1799,80 @@ mem_reset_page_blocks(void)
 }
 
 
+/*
+ * Save or load the state of the memory.
+ *
+ * Besides the RAM itself, this includes the memory states and
+ * the mappings as set up by the chipset and the devices, so a
+ * restored machine sees the same memory map, even if a device
+ * owning a mapping has no state hook of its own.
+ */
+void
+mem_serialize(state_t *s)
+{
+    mem_map_t *map;
+    uint32_t num, c, off;
+
+    num = 0;
+    for (map = base_mapping.next; map != NULL; map = map->next)
+	num++;
+    c = num;
+    state_var(s, c);
+    if (c != num) {
+	state_invalid(s, "memory mappings do not match");
+	return;
+    }
+    c = pages_sz;
+    state_var(s, c);
+    if (c != pages_sz) {
+	state_invalid(s, "page table does not match");
+	return;
+    }
+
+    for (map = base_mapping.next; map != NULL; map = map->next) {
+	state_var(s, map->enable);
+	state_var(s, map->base);
+	state_var(s, map->size);
+	state_var(s, map->flags);
+
+	/* The chipset can move RAM mappings around. */
+	off = (uint32_t)-1;
+	if ((map->exec >= ram) && (map->exec < (ram + ram_size)))
+		off = (uint32_t)(map->exec - ram);
+	state_var(s, off);
+	if (!state_saving(s) && (off != (uint32_t)-1))
+		map->exec = ram + off;
+    }
+
+    /* Pages that were remapped by mem_remap_top(). */
+    for (c = 0; c < pages_sz; c++) {
+	off = (uint32_t)(pages[c].mem - ram);
+	state_var(s, off);
+	if (! state_saving(s))
+		pages[c].mem = &ram[off];
+    }
+
+    state_var(s, _mem_state);
+    state_var(s, rammask);
+    state_var(s, mem_a20_key);
+    state_var(s, mem_a20_alt);
+    state_var(s, mem_a20_state);
+
+    /* Older files have the RAM unaligned, so it cannot be mapped. */
+    if (state_version(s) >= 2)
+	state_ram(s, ram, ram_size);
+    else
+	state_data(s, ram, ram_size);
+
+    if (state_saving(s)) return;
+
+    /* Rebuild the lookup tables for the whole address space. */
+    mem_map_recalc(0ULL, 0x100000000ULL);
+
+    flushmmucache();
+}
+
+
 void
 mem_a20_recalc(void)
 {
@@ -8,12 +8,12 @@
  *
  *		Definitions for the memory interface.
  *
- * Version:	@(#)mem.h	1.0.21	2021/03/16
+ * Version:	@(#)mem.h	1.0.23	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2008-2018 Sarah Walker.
  *
  * This program is free software; you can redistribute it and/or modify
@@ -122,9 +122,6 @@ typedef struct _page_ {
 		dirty_mask[4];
 
     struct codeblock_t *block[4], *block_2[4];
-
-    /*Head of codeblock tree associated with this page*/
-    struct codeblock_t *head;
 } page_t;
 
 
@@ -237,6 +234,8 @@ extern void	mem_set_mem_state(uint32_t base, uint32_t size, int state);
 extern uint8_t	mem_readb_phys(uint32_t addr);
 extern uint16_t	mem_readw_phys(uint32_t addr);
 extern void	mem_writeb_phys(uint32_t addr, uint8_t val);
+extern void	mem_read_phys(void *dest, uint32_t addr, int len);
+extern void	mem_write_phys(const void *src, uint32_t addr, int len);
 
 extern uint8_t	mem_read_ram(uint32_t addr, void *priv);
 extern uint16_t	mem_read_ramw(uint32_t addr, void *priv);
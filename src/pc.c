@@ -8,13 +8,13 @@
  *
  *		Main emulator module where most things are controlled.
  *
- * Version:	@(#)pc.c	1.0.85	2021/03/23
+ * Version:	@(#)pc.c	1.0.87	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -38,6 +38,7 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
@@ -63,6 +64,7 @@
 #include "devices/system/pic.h"
 #include "device.h"
 #include "nvr.h"
+#include "state.h"
 #include "devices/ports/game.h"
 #include "devices/ports/serial.h"
 #include "devices/ports/parallel.h"
@@ -83,6 +85,7 @@
 #include "devices/disk/mo.h"
 #include "devices/network/network.h"
 #include "devices/sound/sound.h"
+#include "devices/sound/snd_opl_nuked.h"
 #include "devices/video/video.h"
 #include "devices/misc/bugger.h"
 #include "devices/misc/isamem.h"
@@ -106,10 +109,14 @@ int		force_debug = 0;		/* (O) force debug output */
 int		video_fps = RENDER_FPS;		/* (O) render speed in fps */
 #endif
 int		settings_only = 0;		/* (O) only the settings dlg */
+int		bench_secs = 0;			/* (O) benchmark run time */
+int		bench_port = 0;			/* (O) benchmark 'done' port */
 int		config_ro = 0;			/* (O) dont modify cfg file */
 int		config_keep_space = 0;		/* (O) keep spaces in cfg */
 int		log_level = LOG_INFO;		/* (O) global logging level */
 wchar_t 	log_path[1024] = { L'\0'};	/* (O) full path of logfile */
+wchar_t		state_load_path[1024] = { L'\0'};	/* (O) state to restore */
+wchar_t		state_save_path[1024] = { L'\0'};	/* (O) state to save */
 
 /* Configuration values. */
 config_t	config;				/* (C) active configuration */
@@ -135,6 +142,7 @@ int		AT,				/* machine is AT class */
 
 /* Local variables. */
 static int	fps,				/* statistics */
+		idle,
 		framecount,
 		title_update;			/* we want title updated */
 static int	unscaled_size_x = SCREEN_RES_X,	/* current unscaled size X */
@@ -146,6 +154,9 @@ static char	logbuff[PCLOG_BUFF_SIZE];
 static int	logseen = 0;
 static int	logdetect = 1;
 
+static volatile int bench_done;			/* benchmark variables */
+static int	bench_status;
+
 
 /*
  * Log something to the logfile or stdout.
@@ -308,9 +319,12 @@ fatal(const char *fmt, ...)
     fflush(logfp);
     va_end(ap);
 
-    nvr_save();
+    /* A benchmark run leaves the configuration alone. */
+    if (! (bench_secs || bench_port)) {
+	nvr_save();
 
-    config_save();
+	config_save();
+    }
 
     pic_dump();
     cpu_dumpregs(1);
@@ -514,20 +528,38 @@ usage:
 		printf("\nUsage: %ls [options] [cfg-file]\n\n", p);
 		printf("Valid options are:\n\n");
 		printf("  -? or --help         - show this information\n");
+		printf("  -B or --bench secs   - run headless for 'secs' seconds\n");
+		printf("  --bench_port port    - stop benchmark on write to 'port'\n");
 		printf("  -C or --dumpcfg      - dump config file after loading\n");
 		printf("  -D or --debug        - force debug logging\n");
 		printf("  -F or --fullscreen   - start in fullscreen mode\n");
+		printf("  -I or --ioprof       - profile I/O port accesses\n");
 		printf("  -L or --logfile path - set 'path' to be the logfile\n");
+		printf("  --load_state path    - restore machine state from 'path'\n");
 		printf("  -P or --vmpath path  - set 'path' to be root for vm\n");
 		printf("  -q or --quiet        - set logging level to QUIET\n");
 #ifdef USE_WX
 		printf("  -R or --fps num      - set render speed to 'num' fps\n");
 #endif
 		printf("  -S or --settings     - show only the settings dialog\n");
+		printf("  --save_state path    - save machine state to 'path' on exit\n");
 		printf("  -W or --read_only    - do not modify the config file\n");
 		printf("  -K or --keep_space   - keep whitespace in config file\n");
 		printf("\nA config file can be specified. If none is, the default file will be used.\n");
 		return(ret);
+	} else if (!wcscasecmp(argv[c], L"--bench") ||
+		   !wcscasecmp(argv[c], L"-B")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		bench_secs = wcstol(argv[++c], NULL, 10);
+	} else if (!wcscasecmp(argv[c], L"--bench_port")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		bench_port = wcstol(argv[++c], NULL, 0);
 	} else if (!wcscasecmp(argv[c], L"--dumpcfg") ||
 		   !wcscasecmp(argv[c], L"-C")) {
 		do_dump_config = 1;
@@ -540,6 +572,9 @@ usage:
 	} else if (!wcscasecmp(argv[c], L"--fullscreen") ||
 		   !wcscasecmp(argv[c], L"-F")) {
 		start_in_fullscreen = 1;
+	} else if (!wcscasecmp(argv[c], L"--ioprof") ||
+		   !wcscasecmp(argv[c], L"-I")) {
+		io_prof_start();
 	} else if (!wcscasecmp(argv[c], L"--logfile") ||
 		   !wcscasecmp(argv[c], L"-L")) {
 		if ((c+1) == argc) {
@@ -547,6 +582,18 @@ usage:
 			goto usage;
 		}
 		wcscpy(log_path, argv[++c]);
+	} else if (!wcscasecmp(argv[c], L"--load_state")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		wcsncpy(state_load_path, argv[++c], sizeof_w(state_load_path) - 1);
+	} else if (!wcscasecmp(argv[c], L"--save_state")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		wcsncpy(state_save_path, argv[++c], sizeof_w(state_save_path) - 1);
 	} else if (!wcscasecmp(argv[c], L"--vmpath") ||
 		   !wcscasecmp(argv[c], L"-P")) {
 		if ((c+1) == argc) {
@@ -828,15 +875,22 @@ pc_close(thread_t *ptr)
 
     /* Terminate the main thread. */
     if (ptr != NULL) {
+	/* If it has to save the machine state, let it finish. */
+	if (state_save_path[0] != L'\0')
+		(void)thread_wait(ptr, -1);
+
 	thread_kill(ptr);
 
 	/* Wait some more. */
 	plat_delay_ms(200);
     }
 
-    nvr_save();
+    /* A benchmark run leaves the configuration alone. */
+    if (! (bench_secs || bench_port)) {
+	nvr_save();
 
-    config_save();
+	config_save();
+    }
 
     ui_mouse_capture(0);
 
@@ -844,6 +898,7 @@ pc_close(thread_t *ptr)
 
     if (dump_on_exit)
 	pic_dump();
+    io_prof_dump();
     cpu_dumpregs(0);
 
     video_close();
@@ -867,7 +922,8 @@ pc_close(thread_t *ptr)
 void
 pc_reset_hard_close(void)
 {
-    nvr_save();
+    if (! (bench_secs || bench_port))
+	nvr_save();
 
     mouse_close();
 
@@ -1069,6 +1125,18 @@ pc_reload(UNUSED(const wchar_t *fn))
 }
 
 
+/* Restore the machine state requested on the command line. */
+static void
+pc_load_state(void)
+{
+    if (state_load(state_load_path)) return;
+
+    /* We may have loaded part of it, so start over. */
+    ERRLOG("PC: unable to restore state, resetting machine!\n");
+    pc_reset_hard();
+}
+
+
 /*
  * The main thread runs the actual emulator code.
  *
@@ -1087,6 +1155,9 @@ pc_thread(void *param)
 
     INFO("PC: starting main thread...\n");
 
+    if (state_load_path[0] != L'\0')
+	pc_load_state();
+
     old_time = plat_timer_ms();
     title_update = 1;
     msec = frm = 0;
@@ -1121,6 +1192,13 @@ pc_thread(void *param)
 
 		/* One more frame done! */
 		framecount++;
+	} else {
+		/*
+		 * We are ahead of real time, which is the normal case
+		 * if the guest spends its time halted. Give the rest
+		 * of the slice back to the host instead of spinning.
+		 */
+		plat_delay_ms((msec < 0) ? -msec : 1);
 	}
 
 	/*
@@ -1136,12 +1214,13 @@ pc_thread(void *param)
 	/* If needed, update the title bar. */
 	if (title_update) {
 		if (config.title[0] != L'\0') {
-			swprintf(temp, sizeof_w(temp), L"%s %s - %3i%% - %ls",
-				 EMU_NAME, emu_version, fps, config.title);
+			swprintf(temp, sizeof_w(temp),
+				 L"%s %s - %3i%% (%i%% idle) - %ls",
+				 EMU_NAME, emu_version, fps, idle, config.title);
 		} else {
 			swprintf(temp, sizeof_w(temp),
-				 L"%s %s - %3i%% - %s - %s",
-				 EMU_NAME, emu_version, fps,
+				 L"%s %s - %3i%% (%i%% idle) - %s - %s",
+				 EMU_NAME, emu_version, fps, idle,
 				 machine_get_name(), cpu_get_name());
 		}
 		ui_window_title(temp);
@@ -1157,16 +1236,130 @@ pc_thread(void *param)
 	}
     }
 
+    /* Save the machine state, if requested. */
+    if (state_save_path[0] != L'\0')
+	(void)state_save(state_save_path);
+
     INFO("PC: main thread done.\n");
 }
 
 
+/* The guest signals the end of the benchmark. */
+static void
+bench_write(UNUSED(uint16_t port), uint8_t val, UNUSED(priv_t priv))
+{
+    bench_status = val;
+    bench_done = 1;
+}
+
+
+/*
+ * Run the machine as a benchmark.
+ *
+ * This is the headless version of pc_thread. We do not need
+ * a renderer or a GUI, and we do not pace execution at all;
+ * we just run time slices back to back until the requested
+ * number of emulated seconds has passed, or until the guest
+ * writes to the benchmark port, and then report the results.
+ */
+int
+pc_bench(void)
+{
+    uint64_t instr = 0;
+    uint32_t start, wall, blits, drops;
+    int slices = 0, secs = 0, idle_sum = 0, old_ins;
+
+    if (pc_init() != 1) {
+	ERRLOG("BENCH: unable to initialize machine!\n");
+	return(1);
+    }
+
+    pc_reset_hard_init();
+
+    if (state_load_path[0] != L'\0')
+	pc_load_state();
+
+    /* See how fast the renderer's pel conversions are on this host. */
+    video_pel_bench();
+
+    /* Same for the batched OPL3 generator, which must match the old one. */
+    nuked_bench();
+
+    if (bench_port != 0)
+	io_sethandler(bench_port, 1,
+		      NULL,NULL,NULL, bench_write,NULL,NULL, NULL);
+
+    INFO("BENCH: running %s (%s) for %i seconds, done port %04X\n",
+	 machine_get_name(), cpu_get_name(), bench_secs, bench_port);
+
+    bench_done = bench_status = 0;
+    blits = video_blits;
+    drops = video_blit_drops;
+    old_ins = ins;
+    start = plat_timer_ms();
+
+    while (! bench_done) {
+	/* Run a frame of code. */
+	cpu_exec(1000 / SLICE);
+
+	instr += (uint32_t)(ins - old_ins);
+	old_ins = ins;
+	framecount++;
+
+	/* No 1-second timer here, so drive it from emulated time. */
+	if ((++slices % (1000 / SLICE)) == 0) {
+		pc_onesec();
+		idle_sum += idle;
+		secs++;
+
+		if (bench_secs && (slices / (1000 / SLICE)) >= bench_secs)
+			break;
+	}
+    }
+
+    wall = plat_timer_ms() - start;
+    blits = video_blits - blits;
+
+    /* This is how we get a booted machine to start other runs from. */
+    if (state_save_path[0] != L'\0')
+	(void)state_save(state_save_path);
+    if (wall == 0)
+	wall = 1;
+
+    INFO("BENCH: %i.%03i emulated seconds in %u.%03u seconds\n",
+	 (slices * SLICE) / 1000, (slices * SLICE) % 1000,
+	 wall / 1000, wall % 1000);
+    INFO("BENCH: %" PRIu64 " instructions, %.2f MIPS, %u frames\n",
+	 instr, (double)instr / (wall * 1000.0), blits);
+    INFO("BENCH: guest was idle for %i%% of the time\n",
+	 secs ? (idle_sum / secs) : cpu_get_idle());
+    INFO("BENCH: %u frames dropped by the blitter, %i queued\n",
+	 video_blit_drops - drops, video_blit_queued());
+    if (bench_done)
+	INFO("BENCH: stopped by guest, status %02X\n", bench_status);
+    /* Also one line on stdout, for scripts collecting results. */
+    printf("%s,%s,%i,%u,%" PRIu64 ",%.2f,%u,%i\n",
+	   machine_get_name(), cpu_get_name(), slices * SLICE, wall,
+	   instr, (double)instr / (wall * 1000.0),
+	   blits, bench_done ? bench_status : -1);
+
+    pc_close(NULL);
+
+    return(0);
+}
+
+
 /* Handler for the 1-second timer to refresh the window title. */
 void
 pc_onesec(void)
 {
     fps = framecount;
     framecount = 0;
+    idle = cpu_get_idle();
+
+#ifdef USE_DYNAREC
+    codegen_stats_latch();
+#endif
 
     title_update = 1;
 }
@@ -8,11 +8,11 @@
  *
  *		Define the various platform support functions.
  *
- * Version:	@(#)plat.h	1.0.27	2021/02/13
+ * Version:	@(#)plat.h	1.0.29	2026/10/17
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -144,6 +144,10 @@ extern wchar_t	*fix_emu_path(const wchar_t *str);
 extern FILE	*plat_fopen(const wchar_t *path, const wchar_t *mode);
 extern FILE	*plat_fopen64(const wchar_t *path, const wchar_t *mode);
 extern void	plat_remove(const wchar_t *path);
+extern void	*plat_ram_alloc(size_t size);
+extern void	plat_ram_free(void *ptr, size_t size);
+extern int	plat_ram_map(void *ptr, size_t size,
+			     const wchar_t *path, uint64_t offset);
 extern int	plat_getcwd(wchar_t *bufp, int max);
 extern int	plat_chdir(const wchar_t *path);
 extern void	plat_tempfile(wchar_t *bufp, const wchar_t *prefix, const wchar_t *suffix);
@@ -158,6 +162,7 @@ extern int	plat_path_abs(const wchar_t *path);
 extern int	plat_dir_check(const wchar_t *path);
 extern int	plat_dir_create(const wchar_t *path);
 extern uint64_t	plat_timer_read(void);
+extern uint64_t	plat_timer_freq(void);
 extern uint32_t	plat_timer_ms(void);
 extern void	plat_delay_ms(uint32_t count);
 extern void	plat_blitter(int own);
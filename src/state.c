@@ -0,0 +1,460 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Save and restore the state of the running machine.
+ *
+ *		A state file starts with a signature and a format version,
+ *		followed by a list of chunks. Each chunk has a four-char
+ *		tag, a version and a length, so a loader can skip chunks
+ *		it does not know, and refuse chunks that are newer than
+ *		what it can handle. Chunks can be nested; the devices
+ *		chunk has one sub-chunk per device with a state hook.
+ *
+ *		The first chunk describes the machine, and a state file
+ *		is only loaded into a machine with the same configured
+ *		machine type, CPU, memory size and list of devices. The
+ *		chunk data itself is stored in host order, as-is.
+ *
+ *		A device without a state hook would come up in its reset
+ *		state after a restore, so the state of a machine that has
+ *		one of those is not saved at all.
+ *
+ *		The guest RAM is stored aligned in the file, so it can be
+ *		mapped copy-on-write when loading. Machines started from
+ *		the same file then share the pages they did not write to,
+ *		and a restore does not have to read all of the RAM.
+ *
+ * Version:	@(#)state.c	1.0.1	2026/10/17
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include "emu.h"
+#include "config.h"
+#include "cpu/cpu.h"
+#include "machines/machine.h"
+#include "plat.h"
+#include "state.h"
+
+
+#define STATE_DEPTH	4			/* max chunk nesting */
+#define STATE_ALIGN	65536			/* alignment of RAM data */
+
+
+typedef struct {
+    char	tag[4];
+    uint32_t	version;
+    uint32_t	length;
+} chunk_t;
+
+struct _state_ {
+    const wchar_t *fn;
+    FILE	*fp;
+    int		saving,
+		error,
+		depth;
+
+    struct {
+	int64_t	start;				/* start of payload */
+	uint32_t length;			/* payload length (load) */
+	uint32_t version;
+    }		chunk[STATE_DEPTH];
+};
+
+
+static void	machine_serialize(state_t *);
+
+
+/* The top-level chunks, in the order they are saved. */
+static const struct {
+    const char	*tag;
+    uint32_t	version;
+    void	(*func)(state_t *);
+} sections[] = {
+    { "MACH", 2, machine_serialize	},
+    { "CPU ", 1, cpu_serialize		},
+    { "MEM ", 2, mem_serialize		},
+    { "PIC ", 1, pic_serialize		},
+    { "PIT ", 1, pit_serialize		},
+    { "DMA ", 1, dma_serialize		},
+    { "DEVS", 1, device_serialize	},
+    { "TIMR", 1, timer_serialize	},
+    { NULL,   0, NULL			}
+};
+
+
+/* Identify the machine, and refuse to load into a different one. */
+static void
+machine_serialize(state_t *s)
+{
+    char temp[64];
+
+    memset(temp, 0x00, sizeof(temp));
+    strncpy(temp, machine_get_internal_name(), sizeof(temp) - 1);
+    state_match(s, temp);
+
+    sprintf(temp, "%i:%i/%iKB",
+	    config.cpu_manuf, config.cpu_type, mem_size);
+    state_match(s, temp);
+
+    /* Older files do not list the devices, so we cannot check. */
+    if (state_version(s) < 2) {
+	state_invalid(s, "state file has no device list");
+	return;
+    }
+
+    device_state_match(s);
+}
+
+
+int
+state_saving(const state_t *s)
+{
+    return(s->saving);
+}
+
+
+/* Return the version of the chunk currently being processed. */
+uint32_t
+state_version(const state_t *s)
+{
+    if (s->depth == 0) return(0);
+
+    return(s->chunk[s->depth - 1].version);
+}
+
+
+/* Mark the state as bad, and stop processing it. */
+void
+state_invalid(state_t *s, const char *why)
+{
+    if (s->error) return;
+
+    ERRLOG("STATE: %s\n", why);
+
+    s->error = 1;
+}
+
+
+/* Save or load a block of data. */
+void
+state_data(state_t *s, void *ptr, size_t len)
+{
+    if (s->error || (len == 0)) return;
+
+    if (s->saving) {
+	if (fwrite(ptr, 1, len, s->fp) != len)
+		state_invalid(s, "write error");
+    } else {
+	if (fread(ptr, 1, len, s->fp) != len)
+		state_invalid(s, "unexpected end of file");
+    }
+}
+
+
+/*
+ * Save or load a block of guest RAM.
+ *
+ * The data is aligned in the file, so that when loading, the
+ * platform can map it copy-on-write instead of reading it. The
+ * block must be all of an area from plat_ram_alloc().
+ */
+void
+state_ram(state_t *s, void *ptr, size_t len)
+{
+    static const uint8_t zero[4096];
+    int64_t pos, pad;
+    int n;
+
+    if (s->error || (len == 0)) return;
+
+    pos = ftello64(s->fp);
+    pad = (STATE_ALIGN - (pos & (STATE_ALIGN - 1))) & (STATE_ALIGN - 1);
+
+    if (s->saving) {
+	while (pad > 0) {
+		n = (pad > (int64_t)sizeof(zero)) ? sizeof(zero) : (int)pad;
+		state_data(s, (void *)zero, n);
+		pad -= n;
+	}
+	state_data(s, ptr, len);
+
+	return;
+    }
+
+    pos += pad;
+    if (plat_ram_map(ptr, len, s->fn, (uint64_t)pos)) {
+	if (fseeko64(s->fp, pos + len, SEEK_SET))
+		state_invalid(s, "seek error");
+
+	return;
+    }
+
+    /* The platform cannot do it, so just read it. */
+    (void)fseeko64(s->fp, pos, SEEK_SET);
+    state_data(s, ptr, len);
+}
+
+
+/*
+ * Save a string, or check that the saved string matches.
+ *
+ * This is used to make sure that we load state into the
+ * same kind of object that it was saved from.
+ */
+int
+state_match(state_t *s, const char *str)
+{
+    char temp[256];
+    uint16_t len;
+
+    len = (uint16_t)strlen(str);
+    if (len >= sizeof(temp))
+	len = sizeof(temp) - 1;
+
+    if (s->saving) {
+	state_var(s, len);
+	state_data(s, (void *)str, len);
+
+	return(! s->error);
+    }
+
+    state_var(s, len);
+    if (len >= sizeof(temp)) {
+	state_invalid(s, "bad string");
+	return(0);
+    }
+    state_data(s, temp, len);
+    if (s->error) return(0);
+
+    temp[len] = '\0';
+    if (strcmp(temp, str)) {
+	ERRLOG("STATE: saved from '%s', not '%s'\n", temp, str);
+	state_invalid(s, "state does not match this machine");
+	return(0);
+    }
+
+    return(1);
+}
+
+
+/*
+ * Start a (sub-)chunk.
+ *
+ * When loading, chunks with other tags are skipped until we
+ * find the one we want, so newer files with extra chunks can
+ * still be loaded.
+ */
+int
+state_begin(state_t *s, const char *tag, uint32_t version)
+{
+    chunk_t hdr;
+
+    if (s->error) return(0);
+
+    if (s->depth == STATE_DEPTH) {
+	state_invalid(s, "chunks nested too deep");
+	return(0);
+    }
+
+    if (s->saving) {
+	memcpy(hdr.tag, tag, sizeof(hdr.tag));
+	hdr.version = version;
+	hdr.length = 0;
+	state_var(s, hdr);
+	s->chunk[s->depth].start = ftello64(s->fp);
+	s->chunk[s->depth].version = version;
+	s->depth++;
+
+	return(! s->error);
+    }
+
+    for (;;) {
+	if (fread(&hdr, sizeof(hdr), 1, s->fp) != 1) {
+		ERRLOG("STATE: chunk '%.4s' not found\n", tag);
+		state_invalid(s, "missing chunk");
+		return(0);
+	}
+
+	if (! memcmp(hdr.tag, tag, sizeof(hdr.tag)))
+		break;
+
+	INFO("STATE: skipping chunk '%.4s' (%lu bytes)\n",
+	     hdr.tag, (unsigned long)hdr.length);
+	(void)fseeko64(s->fp, hdr.length, SEEK_CUR);
+    }
+
+    if (hdr.version > version) {
+	ERRLOG("STATE: chunk '%.4s' is version %lu, we only know %lu\n",
+	       hdr.tag, (unsigned long)hdr.version, (unsigned long)version);
+	state_invalid(s, "unsupported chunk version");
+	return(0);
+    }
+
+    s->chunk[s->depth].start = ftello64(s->fp);
+    s->chunk[s->depth].length = hdr.length;
+    s->chunk[s->depth].version = hdr.version;
+    s->depth++;
+
+    return(1);
+}
+
+
+/*
+ * End a chunk, and fix up (or check) its length.
+ *
+ * Data at the end of a chunk that nobody asked for, such as
+ * sub-chunks we do not know, is skipped.
+ */
+void
+state_end(state_t *s)
+{
+    int64_t start, here, end;
+    uint32_t len;
+
+    if (s->error || (s->depth == 0)) return;
+
+    s->depth--;
+    start = s->chunk[s->depth].start;
+    here = ftello64(s->fp);
+
+    if (s->saving) {
+	len = (uint32_t)(here - start);
+	(void)fseeko64(s->fp, start - sizeof(len), SEEK_SET);
+	state_var(s, len);
+	(void)fseeko64(s->fp, here, SEEK_SET);
+    } else {
+	end = start + s->chunk[s->depth].length;
+	if (here > end) {
+		state_invalid(s, "chunk size mismatch");
+	} else if (here < end) {
+		INFO("STATE: skipping %lu bytes at end of chunk\n",
+		     (unsigned long)(end - here));
+		(void)fseeko64(s->fp, end, SEEK_SET);
+	}
+    }
+}
+
+
+/* Save the state of the machine to a file. */
+int
+state_save(const wchar_t *fn)
+{
+    char magic[8];
+    uint32_t ver;
+    state_t s;
+    int i;
+
+    if (device_state_missing() > 0) {
+	ERRLOG("STATE: not all devices have a state hook, not saving\n");
+	return(0);
+    }
+
+    memset(&s, 0x00, sizeof(s));
+    s.fn = fn;
+    s.fp = plat_fopen64(fn, L"wb");
+    if (s.fp == NULL) {
+	ERRLOG("STATE: unable to create '%ls'\n", fn);
+	return(0);
+    }
+    s.saving = 1;
+
+    INFO("STATE: saving to '%ls'\n", fn);
+
+    memcpy(magic, STATE_MAGIC, sizeof(magic));
+    state_var(&s, magic);
+    ver = STATE_VERSION;
+    state_var(&s, ver);
+
+    for (i = 0; sections[i].tag != NULL; i++) {
+	if (! state_begin(&s, sections[i].tag, sections[i].version))
+		break;
+	sections[i].func(&s);
+	state_end(&s);
+    }
+
+    (void)fclose(s.fp);
+
+    if (s.error) {
+	plat_remove(fn);
+	return(0);
+    }
+
+    return(1);
+}
+
+
+/*
+ * Load the state of the machine from a file.
+ *
+ * This must be done from the emulator thread, in between two
+ * time slices, after the machine was set up and reset. If the
+ * load fails halfway, the machine should be reset again.
+ */
+int
+state_load(const wchar_t *fn)
+{
+    char magic[8];
+    uint32_t ver;
+    state_t s;
+    int i;
+
+    memset(&s, 0x00, sizeof(s));
+    s.fn = fn;
+    s.fp = plat_fopen64(fn, L"rb");
+    if (s.fp == NULL) {
+	ERRLOG("STATE: unable to open '%ls'\n", fn);
+	return(0);
+    }
+
+    INFO("STATE: loading from '%ls'\n", fn);
+
+    state_var(&s, magic);
+    state_var(&s, ver);
+    if (! s.error) {
+	if (memcmp(magic, STATE_MAGIC, sizeof(magic)))
+		state_invalid(&s, "not a state file");
+	else if (ver != STATE_VERSION)
+		state_invalid(&s, "unsupported state file version");
+    }
+
+    for (i = 0; sections[i].tag != NULL; i++) {
+	if (! state_begin(&s, sections[i].tag, sections[i].version))
+		break;
+	sections[i].func(&s);
+	state_end(&s);
+    }
+
+    (void)fclose(s.fp);
+
+    return(! s.error);
+}
@@ -0,0 +1,83 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the machine state save/restore module.
+ *
+ * Version:	@(#)state.h	1.0.1	2026/10/17
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2026 Fred N. van Kempen.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#ifndef EMU_STATE_H
+# define EMU_STATE_H
+
+
+#define STATE_MAGIC	"VARCEMST"		/* file signature */
+#define STATE_VERSION	1			/* file format version */
+
+
+typedef struct _state_ state_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int	state_save(const wchar_t *fn);
+extern int	state_load(const wchar_t *fn);
+
+/* Helpers for the module and device serializers. */
+extern int	state_saving(const state_t *);
+extern uint32_t	state_version(const state_t *);
+extern void	state_data(state_t *, void *ptr, size_t len);
+extern void	state_ram(state_t *, void *ptr, size_t len);
+extern void	state_invalid(state_t *, const char *why);
+extern int	state_match(state_t *, const char *str);
+extern int	state_begin(state_t *, const char *tag, uint32_t version);
+extern void	state_end(state_t *);
+
+/* Serializers for the core modules. */
+extern void	cpu_serialize(state_t *);
+extern void	x86_serialize(state_t *);
+extern void	mem_serialize(state_t *);
+extern void	pic_serialize(state_t *);
+extern void	pit_serialize(state_t *);
+extern void	dma_serialize(state_t *);
+extern void	device_serialize(state_t *);
+extern void	device_state_match(state_t *);
+extern int	device_state_missing(void);
+extern void	timer_serialize(state_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define state_var(s, v)		state_data((s), &(v), sizeof(v))
+
+
+#endif	/*EMU_STATE_H*/
@@ -8,13 +8,18 @@
  *
  *		System timer module.
  *
- * Version:	@(#)timer.c	1.0.5	2019/05/17
+ *		Expired timers are run from a binary heap, in order of
+ *		expiry, and event timers with an absolute deadline are
+ *		kept in a second heap, so neither needs a rescan of all
+ *		timers after each callback.
+ *
+ * Version:	@(#)timer.c	1.0.7	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2019 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -38,13 +43,37 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include "emu.h"
 #include "timer.h"
+#include "state.h"
+
+
+#define TIMERS_INIT	64			/* initial table size */
+#define EVENTS_INIT	32			/* initial event heap size */
+
+#define HEAP_PARENT(x)	(((x) - 1) >> 1)
+#define HEAP_LEFT(x)	(((x) << 1) + 1)
+
+
+/* Legacy (count/enable pointer) timers. */
+typedef struct {
+    int		queued;				/* in the due heap */
+
+    tmrval_t	*count;
+    tmrval_t	*enable;
 
+    void	(*callback)(priv_t);
+    priv_t	priv;
+} tmrlegacy_t;
 
-#define TIMERS_MAX 64
+/* Entry in the heap of expired legacy timers. */
+typedef struct {
+    tmrval_t	key;				/* count when queued */
+    int		idx;				/* index into timers[] */
+} tmrdue_t;
 
 
 tmrval_t		TIMER_USEC;
@@ -53,88 +82,289 @@ tmrval_t		timer_start = 0;
 tmrval_t		timer_count = 0;
 
 
-static struct {
-    int		present;
+static tmrlegacy_t	*timers = NULL;
+static int		timers_max = 0;
+static int		present = 0;
 
-    tmrval_t	*count;
-    tmrval_t	*enable;
+static tmrdue_t		*due = NULL;		/* expired legacy timers */
+static int		due_num = 0;
+
+static tmrevent_t	**evq = NULL;		/* pending event timers */
+static int		evq_max = 0;
+static int		evq_num = 0;
+
+static tmrval_t		timer_time = 0;		/* absolute time at last sync */
+static tmrval_t		latch = 0;
+static int		in_process = 0;
+
+
+/* Grow a table, keeping its current contents. */
+static void *
+grow(void *ptr, int num, int *max, size_t sz, int init)
+{
+    void *tmp;
+    int n;
+
+    n = (*max == 0) ? init : (*max << 1);
+    tmp = mem_alloc(n * sz);
+    memset(tmp, 0x00, n * sz);
+    if (ptr != NULL) {
+	memcpy(tmp, ptr, num * sz);
+	free(ptr);
+    }
+    *max = n;
+
+    return(tmp);
+}
+
+
+static void
+due_up(int i)
+{
+    tmrdue_t d = due[i];
+    int p;
+
+    while (i > 0) {
+	p = HEAP_PARENT(i);
+	if (due[p].key <= d.key)
+		break;
+	due[i] = due[p];
+	i = p;
+    }
+    due[i] = d;
+}
 
-    void	(*callback)(priv_t);
-    priv_t	priv;
-}		timers[TIMERS_MAX];
-static int	present = 0;
-static tmrval_t	latch = 0;
 
+static void
+due_down(int i)
+{
+    tmrdue_t d = due[i];
+    int c;
+
+    while ((c = HEAP_LEFT(i)) < due_num) {
+	if (((c + 1) < due_num) && (due[c + 1].key < due[c].key))
+		c++;
+	if (d.key <= due[c].key)
+		break;
+	due[i] = due[c];
+	i = c;
+    }
+    due[i] = d;
+}
 
+
+/* Queue an expired legacy timer. */
+static void
+due_push(int idx, tmrval_t key)
+{
+    timers[idx].queued = 1;
+    due[due_num].key = key;
+    due[due_num].idx = idx;
+    due_up(due_num++);
+}
+
+
+/* Remove the head of the expired legacy timer heap. */
+static void
+due_pop(void)
+{
+    timers[due[0].idx].queued = 0;
+    if (--due_num > 0) {
+	due[0] = due[due_num];
+	due_down(0);
+    }
+}
+
+
+static void
+evq_up(int i)
+{
+    tmrevent_t *ev = evq[i];
+    int p;
+
+    while (i > 0) {
+	p = HEAP_PARENT(i);
+	if (evq[p]->when <= ev->when)
+		break;
+	evq[i] = evq[p];
+	evq[i]->slot = i;
+	i = p;
+    }
+    evq[i] = ev;
+    ev->slot = i;
+}
+
+
+static void
+evq_down(int i)
+{
+    tmrevent_t *ev = evq[i];
+    int c;
+
+    while ((c = HEAP_LEFT(i)) < evq_num) {
+	if (((c + 1) < evq_num) && (evq[c + 1]->when < evq[c]->when))
+		c++;
+	if (ev->when <= evq[c]->when)
+		break;
+	evq[i] = evq[c];
+	evq[i]->slot = i;
+	i = c;
+    }
+    evq[i] = ev;
+    ev->slot = i;
+}
+
+
+/* Unlink an event from the heap, wherever it is. */
+static void
+evq_remove(tmrevent_t *ev)
+{
+    int i = ev->slot;
+
+    ev->slot = -1;
+    if (--evq_num == i)
+	return;
+
+    evq[i] = evq[evq_num];
+    evq[i]->slot = i;
+    if ((i > 0) && (evq[i]->when < evq[HEAP_PARENT(i)]->when))
+	evq_up(i);
+    else
+	evq_down(i);
+}
+
+
+/*
+ * Run all expired timers, in order of expiry.
+ *
+ * The legacy timers are owned by their devices, which modify
+ * the count and enable values at will, so a queued entry is
+ * re-validated against its live values before it is fired.
+ */
 void
 timer_process(void)
 {
     tmrval_t diff = latch - timer_count;	/* get actual elapsed time */
-    tmrval_t enable[TIMERS_MAX];
-    int c, process = 0;
+    tmrlegacy_t *t;
+    tmrevent_t *ev;
+    tmrval_t cnt;
+    int c, i;
 
-    latch = 0;
+    latch = timer_count;
+    timer_time += diff;
+    in_process = 1;
 
     for (c = 0; c < present; c++) {
+	t = &timers[c];
+
 	/* This is needed to avoid timer crashes on hard reset. */
-	if ((timers[c].enable == NULL) || (timers[c].count == NULL))
+	if ((t->enable == NULL) || (t->count == NULL))
 		continue;
 
-	enable[c] = *timers[c].enable;
-	if (enable[c]) {
-		*timers[c].count = *timers[c].count - diff;
-		if (*timers[c].count <= (tmrval_t)0)
-			process = 1;
+	if (*t->enable) {
+		*t->count = *t->count - diff;
+		if ((*t->count <= (tmrval_t)0) && !t->queued)
+			due_push(c, *t->count);
 	}
     }
 
-    if (! process)
-	return;
-
     for (;;) {
-	tmrval_t lowest = 1LL;
-	int lowest_c;
+	if ((evq_num > 0) && ((evq[0]->when - timer_time) <= 0) &&
+	    ((due_num == 0) || ((evq[0]->when - timer_time) < due[0].key))) {
+		/* Event timer is first in line. */
+		ev = evq[0];
+		evq_remove(ev);
+		ev->callback(ev->priv);
+		continue;
+	}
 
-	for (c = 0; c < present; c++) {
-		if (enable[c]) {
-			if (*timers[c].count < lowest) {
-				lowest = *timers[c].count;
-				lowest_c = c;
-			}
+	if (due_num > 0) {
+		i = due[0].idx;
+		t = &timers[i];
+
+		if ((t->enable == NULL) || !*t->enable) {
+			/* Disabled since it was queued. */
+			due_pop();
+			continue;
+		}
+
+		cnt = *t->count;
+		if (cnt != due[0].key) {
+			/* Re-programmed since it was queued. */
+			due_pop();
+			if (cnt <= (tmrval_t)0)
+				due_push(i, cnt);
+			continue;
 		}
+
+		due_pop();
+		t->callback(t->priv);
+
+		if (*t->enable && (*t->count <= (tmrval_t)0))
+			due_push(i, *t->count);
+		continue;
 	}
 
-	if (lowest > 0)
+	/*
+	 * Both queues are empty. A callback may have expired
+	 * some other device's timer, so check once before we
+	 * leave, and go around again if so.
+	 */
+	for (c = 0; c < present; c++) {
+		t = &timers[c];
+		if ((t->enable == NULL) || (t->count == NULL))
+			continue;
+		if (*t->enable && (*t->count <= (tmrval_t)0))
+			due_push(c, *t->count);
+	}
+	if (due_num == 0)
 		break;
+    }
 
-	timers[lowest_c].callback(timers[lowest_c].priv);
-
-	enable[lowest_c] = *timers[lowest_c].enable;
-    }              
+    in_process = 0;
 }
 
 
 void
 timer_update_outstanding(void)
 {
+    tmrlegacy_t *t;
     int c;
 
-    latch = 0x7fffffffffffffff;
+    latch = INT64_MAX;
 
     for (c = 0; c < present; c++) {
-	if (*timers[c].enable && *timers[c].count < latch)
-		latch = *timers[c].count;
+	t = &timers[c];
+	if ((t->enable == NULL) || (t->count == NULL))
+		continue;
+
+	if (*t->enable && *t->count < latch)
+		latch = *t->count;
     }
 
-    timer_count = latch = (latch + ((1 << TIMER_SHIFT) - 1));
+    if ((evq_num > 0) && ((evq[0]->when - timer_time) < latch))
+	latch = evq[0]->when - timer_time;
+
+    if (latch < (INT64_MAX - ((1 << TIMER_SHIFT) - 1)))
+	latch += ((1 << TIMER_SHIFT) - 1);
+
+    timer_count = latch;
 }
 
 
 void
 timer_reset(void)
 {
+    int c;
+
     present = 0;
+    due_num = 0;
+
+    for (c = 0; c < evq_num; c++)
+	evq[c]->slot = -1;
+    evq_num = 0;
 
+    timer_time = 0;
     latch = timer_count = 0;
 }
 
@@ -142,28 +372,30 @@ timer_reset(void)
 int
 timer_add(void (*func)(priv_t), priv_t priv, tmrval_t *count, tmrval_t *enable)
 {
-    int i = 0;
-
-    /* Can we allocate another one/ */
-    if (present == TIMERS_MAX)
-	return(-1);
+    int i;
+
+    /*
+     * Sanity check:
+     * go through all present timers and make sure
+     * we're not adding a timer that already exists.
+     */
+    for (i = 0; i < present; i++) {
+	if ((timers[i].callback == func) &&
+	    (timers[i].priv == priv) &&
+	    (timers[i].count == count) && (timers[i].enable == enable))
+		return 0;
+    }
 
-    if (present != 0) {
-	/*
-	 * Sanity check:
-	 * go through all present timers and make sure
-	 * we're not adding a timer that already exists.
-	 */
-	for (i = 0; i < present; i++) {
-		if (timers[i].present &&
-		    (timers[i].callback == func) &&
-		    (timers[i].priv == priv) &&
-		    (timers[i].count == count) && (timers[i].enable == enable))
-			return 0;
-	}
+    /* Can we allocate another one? If not, grow the tables. */
+    if (present == timers_max) {
+	i = timers_max;
+	timers = (tmrlegacy_t *)grow(timers, present, &timers_max,
+				     sizeof(tmrlegacy_t), TIMERS_INIT);
+	due = (tmrdue_t *)grow(due, due_num, &i,
+			       sizeof(tmrdue_t), TIMERS_INIT);
     }
 
-    timers[present].present = 1;
+    timers[present].queued = 0;
     timers[present].callback = func;
     timers[present].priv = priv;
     timers[present].count = count;
@@ -172,3 +404,103 @@ timer_add(void (*func)(priv_t), priv_t priv, tmrval_t *count, tmrval_t *enable)
 
     return present - 1;
 }
+
+
+/* Return the current absolute emulated time, in timer units. */
+tmrval_t
+timer_now(void)
+{
+    return(timer_time + (latch - timer_count));
+}
+
+
+void
+timer_event_init(tmrevent_t *ev, void (*func)(priv_t), priv_t priv)
+{
+    memset(ev, 0x00, sizeof(tmrevent_t));
+    ev->callback = func;
+    ev->priv = priv;
+    ev->slot = -1;
+}
+
+
+/* (Re-)arm an event timer for an absolute deadline. */
+void
+timer_event_set(tmrevent_t *ev, tmrval_t when)
+{
+    tmrval_t wake;
+
+    if (ev->slot >= 0)
+	evq_remove(ev);
+
+    if (evq_num == evq_max)
+	evq = (tmrevent_t **)grow(evq, evq_num, &evq_max,
+				  sizeof(tmrevent_t *), EVENTS_INIT);
+
+    ev->when = when;
+    evq[evq_num] = ev;
+    evq_up(evq_num++);
+
+    /*
+     * If we are called from outside the scheduler, and this
+     * deadline comes before the next scheduled wakeup, pull
+     * the wakeup in. Moving latch and timer_count together
+     * keeps the elapsed time since the last sync intact.
+     */
+    if (! in_process) {
+	wake = timer_time + latch;
+	if (when < wake) {
+		latch -= (wake - when);
+		timer_count -= (wake - when);
+	}
+    }
+}
+
+
+/* Arm an event timer relative to the current time. */
+void
+timer_event_delay(tmrevent_t *ev, tmrval_t delay)
+{
+    timer_event_set(ev, timer_now() + delay);
+}
+
+
+void
+timer_event_cancel(tmrevent_t *ev)
+{
+    if (ev->slot >= 0)
+	evq_remove(ev);
+}
+
+
+/*
+ * Save or load the current time.
+ *
+ * The legacy timers count down in the data of their owners,
+ * which restore them. Event timers belong to devices which may
+ * not be restored at all, so we keep them at the same distance
+ * from the new current time. This must be done last, once all
+ * the counts are back in place.
+ */
+void
+timer_serialize(state_t *s)
+{
+    tmrval_t now, old;
+    int c;
+
+    old = now = timer_now();
+    state_var(s, now);
+
+    if (state_saving(s)) return;
+
+    for (c = 0; c < evq_num; c++)
+	evq[c]->when += (now - old);
+
+    for (c = 0; c < present; c++)
+	timers[c].queued = 0;
+    due_num = 0;
+
+    timer_time = now;
+    latch = timer_count = 0;
+    timer_update_outstanding();
+}
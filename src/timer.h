@@ -8,13 +8,13 @@
  *
  *		Definitions for the system timer module.
  *
- * Version:	@(#)timer.h	1.0.6	2021/03/12
+ * Version:	@(#)timer.h	1.0.8	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -47,6 +47,15 @@
 
 typedef int64_t	tmrval_t;
 
+/* Event timer, fires once at an absolute deadline. */
+typedef struct _tmrevent_ {
+    tmrval_t	when;				// absolute deadline
+    int		slot;				// heap slot, -1 if idle
+
+    void	(*callback)(priv_t);
+    priv_t	priv;
+} tmrevent_t;
+
 
 extern tmrval_t	TIMER_USEC;
 extern tmrval_t	timer_one;
@@ -68,6 +77,10 @@ extern tmrval_t	timer_count;
 		}						\
 	} while (0)
 
+/* Ticks left until the next deadline, given the current time base. */
+#define timer_idle_left(now)					\
+	(timer_count - (timer_start - (now)))
+
 #define timer_clock()						\
 	do {							\
                 tmrval_t __diff;					\
@@ -90,5 +103,14 @@ extern void	timer_reset(void);
 extern int	timer_add(void (*callback)(priv_t), priv_t priv,
 			  tmrval_t *count, tmrval_t *enable);
 
+extern tmrval_t	timer_now(void);
+extern void	timer_event_init(tmrevent_t *, void (*callback)(priv_t),
+				 priv_t priv);
+extern void	timer_event_set(tmrevent_t *, tmrval_t when);
+extern void	timer_event_delay(tmrevent_t *, tmrval_t delay);
+extern void	timer_event_cancel(tmrevent_t *);
+
+#define timer_event_pending(ev)	((ev)->slot >= 0)
+
 
 #endif	/*EMU_TIMER_H*/
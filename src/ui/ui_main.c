@@ -11,11 +11,11 @@
  *		This code is called by the UI frontend modules, and, also,
  *		depends on those same modules for lower-level functions.
  *
- * Version:	@(#)ui_main.c	1.0.27	2021/05/15
+ * Version:	@(#)ui_main.c	1.0.28	2026/10/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
- *		Copyright 2018-2021 Fred N. van Kempen.
+ *		Copyright 2018-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -642,7 +642,6 @@ ui_fullscreen(int on)
 
     /* OK, claim the video. */
     plat_blitter(1);
-//    video_blit_wait();
 
     /* Close the current mode, and open the new one. */
     plat_vidapis[config.vid_api]->close();
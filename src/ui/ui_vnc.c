@@ -10,12 +10,12 @@
  *
  * TODO:	Implement screenshots, and Audio Redirection.
  *
- * Version:	@(#)ui_vnc.c	1.0.15	2021/03/24
+ * Version:	@(#)ui_vnc.c	1.0.16	2026/10/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Based on raw code by RichardG, <richardg867@gmail.com>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *
  *		Redistribution and  use  in source  and binary forms, with
  *		or  without modification, are permitted  provided that the
@@ -269,26 +269,45 @@ vnc_display(rfbClientPtr cl)
 static void
 vnc_blit(bitmap_t *scr, int x, int y, int y1, int y2, int w, int h)
 {
+    const video_damage_t *d = video_blit_damage();
+    const video_rect_t *r;
     uint32_t *p;
-    int yy;
+    int i, yy;
 
 //INFO("VNC: blit(%i,%i, %i,%i, %i,%i)\n", x,y, y1,y2, w,h);
 
-    for (yy = y1; yy < y2; yy++) {
-	p = (uint32_t *)&(((uint32_t *)rfb->frameBuffer)[yy*VNC_MAX_X]);
+    /* Only copy what changed. */
+    for (i = 0; i < d->count; i++) {
+	r = &d->rect[i];
 
-	if ((y+yy) >= 0 && (y+yy) < VNC_MAX_Y) {
-		if (config.vid_grayscale || config.invert_display)
-			video_transform_copy(p, &scr->line[y+yy][x], w);
-		  else
-			memcpy(p, &scr->line[y+yy][x], w*4);
+	for (yy = r->y; yy < (r->y + r->h); yy++) {
+		p = (uint32_t *)&(((uint32_t *)rfb->frameBuffer)[yy*VNC_MAX_X + r->x]);
+
+		if ((y+yy) >= 0 && (y+yy) < VNC_MAX_Y) {
+			if (config.vid_grayscale || config.invert_display)
+				video_transform_copy(p, &scr->line[y+yy][x+r->x], r->w);
+			  else
+				memcpy(p, &scr->line[y+yy][x+r->x], r->w*4);
+		}
 	}
     }
- 
+
     video_blit_done();
 
-    if (! updatingSize)
-	FUNC(MarkRectAsModified)(rfb, 0,0, allowedX,allowedY);
+    if (updatingSize)
+	return;
+
+    /* And tell the clients only about that. */
+    for (i = 0; i < d->count; i++) {
+	r = &d->rect[i];
+
+	if ((r->x >= allowedX) || (r->y >= allowedY))
+		continue;
+
+	FUNC(MarkRectAsModified)(rfb, r->x, r->y,
+				 MIN(r->x + r->w, allowedX),
+				 MIN(r->y + r->h, allowedY));
+    }
 }
 
 
@@ -8,13 +8,13 @@
  *
  *		Platform main support module for Windows.
  *
- * Version:	@(#)win.c	1.0.35	2021/02/18
+ * Version:	@(#)win.c	1.0.37	2026/10/17
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
  *
- *		Copyright 2017-2021 Fred N. van Kempen.
+ *		Copyright 2017-2026 Fred N. van Kempen.
  *		Copyright 2016-2018 Miran Grca.
  *		Copyright 2008-2018 Sarah Walker.
  *
@@ -255,6 +255,14 @@ WinMain(HINSTANCE hInst, HINSTANCE hPrev, LPSTR lpszArg, int nCmdShow)
     /* Create a mutex for the video handler. */
     hBlitMutex = CreateMutex(NULL, FALSE, MUTEX_NAME);
 
+    /* If requested, run a headless benchmark instead. */
+    if (bench_secs || bench_port) {
+	plat_console(1);
+	i = pc_bench();
+	plat_console(0);
+	return(i);
+    }
+
     /* Handle our GUI. */
     i = ui_init(nCmdShow);
 
@@ -413,6 +421,81 @@ plat_remove(const wchar_t *path)
 }
 
 
+/*
+ * Allocate memory for the guest RAM.
+ *
+ * We get this straight from the system, so it is page-aligned
+ * and zeroed, and pages the guest never touches do not use any
+ * memory at all.
+ */
+void *
+plat_ram_alloc(size_t size)
+{
+    return(VirtualAlloc(NULL, size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE));
+}
+
+
+void
+plat_ram_free(void *ptr, UNUSED(size_t size))
+{
+    MEMORY_BASIC_INFORMATION mbi;
+
+    if (ptr == NULL) return;
+
+    /* It may have been replaced with a view of a file. */
+    if (VirtualQuery(ptr, &mbi, sizeof(mbi)) && (mbi.Type == MEM_MAPPED))
+	(void)UnmapViewOfFile(ptr);
+    else
+	(void)VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+
+/*
+ * Replace (all of) the guest RAM with a copy-on-write view of
+ * a file, at the same address, so any pointers into it remain
+ * valid. Pages are read from the file when first touched, and
+ * only copied when written to, so many machines started from
+ * the same file share all the pages none of them changed.
+ *
+ * The offset must be a multiple of 64K. While it is mapped, the
+ * file cannot be replaced, so do not save a state over the file
+ * it was loaded from.
+ */
+int
+plat_ram_map(void *ptr, size_t size, const wchar_t *path, uint64_t offset)
+{
+    HANDLE h, m;
+    void *view;
+
+    h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+		    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+	return(0);
+    m = CreateFileMappingW(h, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(h);
+    if (m == NULL)
+	return(0);
+
+    plat_ram_free(ptr, size);
+
+    /* The view keeps the file mapping open. */
+    view = MapViewOfFileEx(m, FILE_MAP_COPY,
+			   (DWORD)(offset >> 32), (DWORD)offset, size, ptr);
+    CloseHandle(m);
+
+    if (view == NULL) {
+	/* Some other thread got there first, get it back. */
+	view = VirtualAlloc(ptr, size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+	if (view != ptr)
+		fatal("PLAT: unable to re-allocate RAM at %p!\n", ptr);
+
+	return(0);
+    }
+
+    return(1);
+}
+
+
 /* Make sure a path ends with a trailing (back)slash. */
 void
 plat_append_slash(wchar_t *path)
@@ -547,6 +630,18 @@ plat_timer_read(void)
 }
 
 
+/* Return the number of plat_timer_read() ticks per second. */
+uint64_t
+plat_timer_freq(void)
+{
+    LARGE_INTEGER li;
+
+    QueryPerformanceFrequency(&li);
+
+    return(li.QuadPart);
+}
+
+
 uint32_t
 plat_timer_ms(void)
 {